@@ -2,6 +2,9 @@
 #include "config/config.hpp"
 #include "stream/avPullStream.hpp"
 #include "stream/avPushStream.hpp"
+#include "stream/nalUtils.hpp"
+#include <map>
+#include <mutex>
 /*
 worker工作流程：
 1.启动拉流进程，拉取rtsp流并在on_track_frame_out回调函数中将frame放入待解码SafeQueue。
@@ -12,31 +15,156 @@ worker工作流程：
 5.在主线程中等待用户输入，按任意键退出后，清理所有线程和资源。
 */
 
-RtspWorker::RtspWorker(std::string stream_name,std::string stream_url, int port, std::string push_path_first, std::string push_path_second, std::string model_root, int thread_num,msgServer *alarm_server)
-    : stream_url(stream_url), port(port), push_path_first(push_path_first), push_path_second(push_path_second)
+// 输出流 app/stream -> 上下文，供播放请求事件查找；start() 注册，stop() 注销
+static std::mutex g_outputs_mutex;
+static std::map<std::string, av_worker_context_t *> g_outputs;
+
+void recordViewerFirstFrame(av_worker_context_t *ctx, bool key)
+{
+    if (!key)
+    {
+        return;
+    }
+    int64_t join_us = ctx->viewer_join_us.load();
+    if (join_us > 0 && ctx->viewer_join_us.compare_exchange_strong(join_us, 0))
+    {
+        ctx->last_join_ms = (VideoFrame::NowUs() - join_us) / 1000;
+        printf("[%s] 新观看者等到首个关键帧 %lld ms\n", ctx->stream_name.c_str(), (long long)ctx->last_join_ms);
+    }
+}
+
+// 释放待解码队列中残留的码流包引用
+static void releasePacketQueue(av_worker_context_t *ctx)
+{
+    if (ctx->packet_queue == nullptr)
+    {
+        return;
+    }
+    queued_packet_t packet;
+    while (ctx->packet_queue->pop_for(packet, 0))
+    {
+        mk_frame_unref(packet.frame);
+    }
+    delete ctx->packet_queue;
+    ctx->packet_queue = nullptr;
+}
+
+RtspWorker::RtspWorker(const StreamConfig &stream, const GlobalConfig &global, int port, std::shared_ptr<InferContext> infer_ctx, msgServer *alarm_server)
+    : stream_url(stream.input_url), port(port), push_path_first(stream.output_app), push_path_second(stream.output_stream),
+      inference_url(stream.inference_url)
 {
     ctx_ = new av_worker_context_t();
-    const char *model_file = model_root.c_str();
-    ctx_->pool = new framePool(model_file, thread_num);
+    // 挂到进程级共享推理上下文上，按权重参与调度
+    ctx_->pool = new framePool(infer_ctx, stream.name, stream.weight, stream.priority, global.infer_queue_size);
     
-    // 初始化Mat内存池
-    ctx_->mat_pool = new MatPool(50, 10); // 最大50个，初始10个
-    
-    // 预分配常见分辨率的Mat对象
-    // ctx_->mat_pool->preallocate(1920, 1080, 5);  // 1080p
-    ctx_->mat_pool->preallocate(1280, 720, 5);   // 720p
-    ctx_->mat_pool->preallocate(640, 480, 5);    // 480p
+    // 初始化Mat内存池：空闲上限覆盖推理队列和在途帧，拉流拿到实际分辨率后再预分配
+    std::shared_ptr<DmaAllocator> allocator;
+    if (global.frame_buffer == "dma") {
+        // 像素内存放在可导出fd的缓冲区里，RGA直接按fd读写，省去虚拟地址导入
+        allocator = std::make_shared<DmaAllocator>(global.dma_heap);
+    }
+    ctx_->mat_pool = new MatPool(global.infer_queue_size + 8, 4, allocator);
     
     // ctx_->frame_queue = new SafeQueue<std::shared_ptr<cv::Mat>>();
-    this->stream_url = stream_url;
     ctx_->alarm_server = alarm_server; // 设置报警服务器
-    ctx_->stream_name = stream_name; // 设置流名称
+    ctx_->stream_name = stream.name; // 设置流名称
+    // 解码放到独立线程，拉流回调只引用码流包入队，不阻塞 ZLMediaKit 的网络线程
+    ctx_->packet_queue = new SafeQueue<queued_packet_t>(global.decode_queue_size > 0 ? global.decode_queue_size : 64);
+    // 摄像头输出的是 MJPEG/原始图像，没有可以直接转发的码流，总是重新编码
+    ctx_->passthrough = stream.output_mode == "passthrough" && !isV4l2SourceUrl(stream.input_url);
+    ctx_->process_decimator.setFps(stream.process_fps);
+    ctx_->shedder.setMaxLevel(shedLevelFromString(stream.overload));
+    // 直通模式输出原始码流，不在解码后抽帧
+    ctx_->output_decimator.setFps(ctx_->passthrough ? 0 : stream.output_fps);
+    ctx_->last_restart_ms = -1;
+    ctx_->file_max_speed = stream.file_pace == "max";
+    ctx_->file_fps = stream.file_fps > 0 ? stream.file_fps : 25;
+    ctx_->file_loops = stream.file_loops;
+    ctx_->v4l2.width = stream.v4l2_width;
+    ctx_->v4l2.height = stream.v4l2_height;
+    ctx_->v4l2.fps = stream.v4l2_fps;
+    ctx_->v4l2.format = stream.v4l2_format;
+    // 推理队列满了会丢最旧的帧，不限速回放时留一个空位，保证每帧都被推理
+    ctx_->infer_backlog = global.infer_queue_size > 1 ? global.infer_queue_size - 1 : 1;
+    if (!stream.record_dir.empty())
+    {
+        // 报警录像缓存的是输出码流，按流 id 区分文件名
+        ctx_->recorder = new ClipRecorder(stream.record_dir, stream.id, stream.record_pre_sec, stream.record_post_sec,
+                                          stream.record_max_sec);
+    }
+    ctx_->output_sei = stream.output_sei;
+    ctx_->on_demand = stream.output_on_demand;
+    ctx_->fast_join = stream.output_fast_join && !ctx_->passthrough; // 直通模式的关键帧由摄像头决定
+    ctx_->last_join_ms = -1;
+    // 直通模式不重新编码，ROI 无从生效
+    ctx_->roi.enable = stream.roi_enable && !ctx_->passthrough;
+    ctx_->roi.max_regions = stream.roi_max_regions;
+    ctx_->roi.qp_delta = stream.roi_qp_delta;
+    ctx_->roi.bg_qp_delta = stream.roi_bg_qp_delta;
+    ctx_->roi.hold_frames = stream.roi_hold_frames;
+    ctx_->rate.bitrate_kbps = stream.output_bitrate_kbps;
+    ctx_->rate.gop = stream.output_gop;
+    ctx_->rate.adaptive = stream.rate_adaptive && !ctx_->passthrough;
+    ctx_->rate.min_kbps = stream.rate_min_kbps;
+    ctx_->rate.min_fps = stream.rate_min_fps;
+    ctx_->rate.max_gop_sec = stream.rate_max_gop_sec;
+    ctx_->output_codec = (stream.output_codec == "h265" || stream.output_codec == "hevc") ? VIDEO_CODEC_H265 : VIDEO_CODEC_H264;
+    // 直通模式下画面不再重新编码，画框没有意义；检测结果走SEI时由播放端画框
+    ctx_->pool->SetDrawDetections(!ctx_->passthrough && !ctx_->output_sei);
+
+    if (!inference_url.empty() && inference_url != stream_url)
+    {
+        // 双码流：子码流解码送推理，主码流直通或解码后叠加子码流的检测结果
+        ctx_->dual_input = true;
+        ctx_->skip_decode = ctx_->passthrough;
+        if (!ctx_->passthrough)
+        {
+            ctx_->display_queue = new SafeQueue<VideoFramePtr>(8);
+        }
+        // 子码流上的框需要映射到主码流分辨率，推理线程不画框，由推流线程画到主码流帧上
+        ctx_->pool->SetDrawDetections(false);
+
+        infer_ctx_ = new av_worker_context_t();
+        infer_ctx_->stream_name = stream.name + "_infer";
+        infer_ctx_->infer_only = true;
+        infer_ctx_->process_decimator.setFps(stream.process_fps);
+        infer_ctx_->shedder.setMaxLevel(shedLevelFromString(stream.overload));
+        infer_ctx_->last_restart_ms = -1;
+        infer_ctx_->file_max_speed = ctx_->file_max_speed;
+        infer_ctx_->file_fps = ctx_->file_fps;
+        infer_ctx_->file_loops = ctx_->file_loops;
+        infer_ctx_->infer_backlog = ctx_->infer_backlog;
+        infer_ctx_->pool = ctx_->pool;
+        infer_ctx_->mat_pool = ctx_->mat_pool;
+        infer_ctx_->alarm_server = alarm_server;
+        infer_ctx_->packet_queue = new SafeQueue<queued_packet_t>(global.decode_queue_size > 0 ? global.decode_queue_size : 64);
+        // 主码流不再送推理
+        ctx_->process_decimator.setFps(0);
+    }
 }
 
 RtspWorker::~RtspWorker()
 {
     stop();
 
+    // 子码流上下文只持有自己的解码器和轨道，推理池和内存池属于 ctx_
+    if (infer_ctx_)
+    {
+        releasePacketQueue(infer_ctx_);
+        if (infer_ctx_->decoder)
+        {
+            delete infer_ctx_->decoder;
+            infer_ctx_->decoder = nullptr;
+        }
+        if (infer_ctx_->tracks)
+        {
+            mk_track_unref(infer_ctx_->tracks);
+            infer_ctx_->tracks = nullptr;
+        }
+        delete infer_ctx_;
+        infer_ctx_ = nullptr;
+    }
+
     // 统一释放所有 ctx 内的资源
     if (ctx_)
     {
@@ -62,6 +190,18 @@ RtspWorker::~RtspWorker()
             delete ctx_->mat_pool;
             ctx_->mat_pool = nullptr;
         }
+        releasePacketQueue(ctx_);
+        if (ctx_->recorder)
+        {
+            // 等写线程把正在录制的片段写完
+            delete ctx_->recorder;
+            ctx_->recorder = nullptr;
+        }
+        if (ctx_->display_queue)
+        {
+            delete ctx_->display_queue;
+            ctx_->display_queue = nullptr;
+        }
         // if (ctx_->frame_queue)
         // {
         //     delete ctx_->frame_queue;
@@ -80,30 +220,63 @@ RtspWorker::~RtspWorker()
 void RtspWorker::start()
 {
     printf("启动 RtspWorker...\n");
+    // 先置运行标志再起线程，拉流线程的解码/重连循环以它为退出条件
+    ctx_->running = true;
+    if (infer_ctx_)
+    {
+        infer_ctx_->running = true;
+    }
     pullStream_ = new AvPullStream(stream_url, ctx_);
     pull_thread_ = std::thread([this]()
                                { pullStream_->start(); });
     printf("拉流线程已启动\n");
+    if (infer_ctx_)
+    {
+        inferPullStream_ = new AvPullStream(inference_url, infer_ctx_);
+        infer_pull_thread_ = std::thread([this]()
+                                         { inferPullStream_->start(); });
+        printf("推理子码流拉流线程已启动: %s\n", inference_url.c_str());
+    }
 
     pushStream_ = new AvPushStream(ctx_, port, push_path_first, push_path_second);
     push_thread_ = std::thread([this]()
                                { pushStream_->pushSteamThread(); });
     printf("推流线程已创建\n");
-    ctx_->running = true; // 设置运行标志为true
+    {
+        std::lock_guard<std::mutex> lock(g_outputs_mutex);
+        g_outputs[push_path_first + "/" + push_path_second] = ctx_;
+    }
+    fps_meter_.reset(new StageFpsMeter(ctx_->stages));
 }
 
 void RtspWorker::stop()
 {
     printf("开始停止 RtspWorker...\n");
 
+    {
+        std::lock_guard<std::mutex> lock(g_outputs_mutex);
+        auto it = g_outputs.find(push_path_first + "/" + push_path_second);
+        if (it != g_outputs.end() && it->second == ctx_)
+        {
+            g_outputs.erase(it);
+        }
+    }
     // 设置停止标志
     ctx_->running = false;
+    if (infer_ctx_)
+    {
+        infer_ctx_->running = false;
+    }
 
     // 停止拉流
     if (pullStream_)
     {
         pullStream_->stop();
     }
+    if (inferPullStream_)
+    {
+        inferPullStream_->stop();
+    }
 
     printf("等待线程结束...\n");
 
@@ -113,11 +286,21 @@ void RtspWorker::stop()
         pull_thread_.join();
         printf("拉流线程已结束\n");
     }
+    if (infer_pull_thread_.joinable())
+    {
+        infer_pull_thread_.join();
+        printf("子码流拉流线程已结束\n");
+    }
     if (push_thread_.joinable())
     {
         push_thread_.join();
         printf("推流线程已结束\n");
     }
+    if (ctx_->mosaic_slot != nullptr)
+    {
+        // 推流线程退出后不会再交帧：拼接画面中这一路的格子涂黑，同时放掉最后一帧的引用
+        ctx_->mosaic_slot->clear();
+    }
     
 
     // 释放对象（但不释放 ctx 内部资源，留给析构函数处理）
@@ -127,6 +310,11 @@ void RtspWorker::stop()
         pullStream_ = nullptr;
         printf("拉流对象已释放\n");
     }
+    if (inferPullStream_)
+    {
+        delete inferPullStream_;
+        inferPullStream_ = nullptr;
+    }
     if (pushStream_)
     {
         delete pushStream_;
@@ -141,3 +329,92 @@ bool RtspWorker::isRunning()
 {
     return ctx_->running;
 }
+
+void RtspWorker::reconnect()
+{
+    // 只重建播放器，解码器、编码器、推理池和推流媒体源保持不变
+    ctx_->reconnect_begin_us = VideoFrame::NowUs();
+    ctx_->need_reconnect = true;
+    if (infer_ctx_)
+    {
+        infer_ctx_->reconnect_begin_us = VideoFrame::NowUs();
+        infer_ctx_->need_reconnect = true;
+    }
+}
+
+uint32_t RtspWorker::reconnectCount()
+{
+    return ctx_->reconnect_count;
+}
+
+int64_t RtspWorker::lastRestartMs()
+{
+    return ctx_->last_restart_ms;
+}
+
+uint32_t RtspWorker::viewerJoins()
+{
+    return ctx_->viewer_joins;
+}
+
+int64_t RtspWorker::lastJoinMs()
+{
+    return ctx_->last_join_ms;
+}
+
+void RtspWorker::notifyViewerJoin(const std::string &app, const std::string &stream)
+{
+    std::lock_guard<std::mutex> lock(g_outputs_mutex);
+    auto it = g_outputs.find(app + "/" + stream);
+    if (it == g_outputs.end())
+    {
+        return;
+    }
+    av_worker_context_t *ctx = it->second;
+    ctx->viewer_joins++;
+    // 已有观看者在等关键帧时保留更早的时间，统计的是最长等待
+    int64_t expected = 0;
+    ctx->viewer_join_us.compare_exchange_strong(expected, VideoFrame::NowUs());
+}
+
+void RtspWorker::reportStageFps()
+{
+    if (fps_meter_)
+    {
+        fps_meter_->report(ctx_->stream_name.c_str());
+    }
+}
+
+void RtspWorker::setMosaicSlot(std::shared_ptr<MosaicSlot> slot)
+{
+    ctx_->mosaic_slot = slot;
+}
+
+void RtspWorker::reportOverload()
+{
+    const av_worker_context_t *ctxs[] = {ctx_, infer_ctx_};
+    for (const av_worker_context_t *ctx : ctxs)
+    {
+        if (ctx != nullptr && ctx->shedder.maxLevel() > SHED_NONE && ctx->shedder.dropped() > 0)
+        {
+            printf("  过载控制(%s): %s, 累计解码前丢弃 %llu 个码流包\n", ctx->stream_name.c_str(),
+                   shedLevelName(ctx->shedder.level()), (unsigned long long)ctx->shedder.dropped());
+        }
+    }
+}
+
+void RtspWorker::reportLatency()
+{
+    ctx_->latency_stats.report();
+}
+
+void RtspWorker::reportRateControl()
+{
+    if (ctx_->rc_bps > 0)
+    {
+        printf("  编码: %dx%d, %d kbps, %d fps, GOP %d%s%s\n", ctx_->width, ctx_->height, ctx_->rc_bps / 1000,
+               ctx_->rc_fps.load(), ctx_->rc_gop.load(),
+               ctx_->rate.adaptive ? (", 自适应调整 " + std::to_string(ctx_->rc_adjustments) + " 次").c_str() : "",
+               ctx_->format_changes > 0 ? (", 分辨率切换 " + std::to_string(ctx_->format_changes) + " 次").c_str() : "");
+    }
+}
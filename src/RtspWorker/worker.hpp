@@ -4,7 +4,10 @@
 #include <iostream>
 #include <thread>
 #include <atomic>
+#include <memory>
 #include <string>
+#include <mutex>
+#include <vector>
 #include <opencv2/opencv.hpp>
 #include "threadPool/safeQueue.hpp"
 #include "threadPool/framePool.hpp"
@@ -12,7 +15,16 @@
 #include "rkmedia/utils/mpp_decoder.h"
 #include "rkmedia/utils/mpp_encoder.h"
 #include "stream/matPool.hpp"
+#include "stream/stageStats.hpp"
+#include "stream/clipRecorder.hpp"
+#include "stream/roiSmoother.hpp"
+#include "stream/rateController.hpp"
+#include "stream/frameDecimator.hpp"
+#include "stream/overloadShedder.hpp"
+#include "stream/v4l2Source.hpp"
+#include "stream/mosaicCompositor.hpp"
 #include "utils/msgServer.hpp"
+#include "config/config.hpp"
 
 // #include "stream/avPullStream.hpp"
 // #include "stream/avDecoder.hpp"
@@ -28,9 +40,16 @@ class AvPushStream;
 */
 
 
+// 待解码的码流包，持有 mk_frame 的引用，不拷贝数据
+typedef struct {
+    mk_frame frame;
+    int64_t arrival_us; // 码流包到达时间
+} queued_packet_t;
+
 typedef struct {
     std::string stream_name; // 流名称
-    int video_type;      // 编码类型
+    int video_type;      // 输入编码类型，264/265
+    int output_codec;    // 重新编码输出的编码类型，264/265
     int video_fps;       // 帧率
     int width;           // 视频宽度
     int height;          // 视频高度
@@ -40,9 +59,56 @@ typedef struct {
     std::atomic<bool> running;
     
     MppDecoder *decoder;// 解码器对象
+    std::atomic<int> pending_codec; // 拉流回调探测到的编码类型，由解码线程创建或重建解码器，0表示没有待处理的请求
     MppEncoder *encoder;// 编码器对象
     mk_pusher pusher;
     mk_track tracks; // 视频轨道
+    uint64_t frame_seq;     // 已解码帧序号
+    int64_t last_packet_us; // 最近一个码流包的到达时间
+    uint64_t mem_dropped;   // 因帧内存预算耗尽而丢弃的帧数
+    bool passthrough;       // 直通模式：原始码流直接转发，不做重编码
+    FrameDecimator output_decimator;  // 输出帧率抽帧（重新编码时），在颜色转换和取 MatPool 缓冲区之前丢帧
+    FrameDecimator process_decimator; // 送推理帧率抽帧，在输出帧中再抽
+    OverloadShedder shedder;          // 下游过载时在解码之前丢包
+    std::atomic<uint32_t> format_changes; // 码流中途分辨率变化次数
+    std::atomic<mk_media> output_media; // 直通模式下由推流线程创建，拉流回调直接写入
+    std::mutex output_mutex;            // 拉流回调持锁写入 output_media，推流线程持锁摘除后才释放媒体源
+    bool output_sei;        // 检测结果以SEI随码流下发
+    std::mutex sei_mutex;
+    std::vector<uint8_t> pending_sei; // 直通模式下待插入的最新一帧检测结果SEI
+    bool dual_input;        // 双码流输入：主码流只用于输出，推理在子码流上进行
+    bool infer_only;        // 子码流上下文：解码后只送推理，不创建编码器、不输出
+    bool skip_decode;       // 主码流直通且推理在子码流上时，主码流不需要解码
+    SafeQueue<VideoFramePtr> *display_queue; // 双码流叠加模式下主码流解码帧，等待与子码流检测结果匹配
+    SafeQueue<queued_packet_t> *packet_queue; // 拉流回调 -> 解码线程
+    bool wait_keyframe;       // 解码队列满丢过包，丢弃后续非关键帧直到下一个关键帧
+    uint64_t packets_dropped; // 解码队列满而丢弃的码流包数
+    std::atomic<bool> need_reconnect;        // 播放失败或中断，等待拉流线程原地重连
+    std::atomic<int64_t> reconnect_begin_us; // 本次断流开始时间，恢复出帧后清零
+    std::atomic<uint32_t> reconnect_count;   // 累计重连次数
+    std::atomic<int64_t> last_restart_ms;    // 最近一次断流到恢复出帧的耗时，没有时为 -1
+    StageCounters stages;   // 各阶段累计帧数，用于统计分阶段帧率
+    std::atomic<bool> file_source; // 输入为本地裸流文件或 V4L2 摄像头，没有 mk_track
+    bool file_max_speed;    // 文件输入不限速回放：下游满时等待，不丢帧
+    int file_fps;           // 文件输入生成时间戳用的帧率
+    int file_loops;         // 文件回放次数，0表示循环
+    V4l2Params v4l2;        // V4L2 摄像头采集参数
+    int infer_backlog;      // 不限速回放时允许堆积的待推理帧数
+    ClipRecorder *recorder; // 报警录像，未配置时为 nullptr
+    bool on_demand;         // 无人观看时暂停编码
+    std::atomic<bool> output_registered; // 输出媒体源已注册(rtsp)，播放器可以找到它
+    bool fast_join;                        // 新观看者到来时请求 IDR
+    std::atomic<int64_t> viewer_join_us;   // 最早一个还没等到关键帧的观看者的播放请求时间，0表示没有
+    std::atomic<uint32_t> viewer_joins;    // 累计播放请求次数
+    std::atomic<int64_t> last_join_ms;     // 最近一次播放请求到输出关键帧的耗时，没有时为 -1
+    RoiParams roi;          // 按检测框设置编码 ROI
+    RateControlParams rate; // 输出码率控制
+    std::atomic<int> rc_bps;  // 编码器当前的目标码率/帧率/GOP，编码器创建前为 0
+    std::atomic<int> rc_fps;
+    std::atomic<int> rc_gop;
+    std::atomic<uint32_t> rc_adjustments; // 自适应调整次数
+    FrameLatencyStats latency_stats;      // 推流线程逐帧累计，状态报告时打印并清零
+    std::shared_ptr<MosaicSlot> mosaic_slot; // 参与拼接输出时，推流线程把最新一帧交给拼接线程，否则为空
 
     // SafeQueue<std::shared_ptr<cv::Mat>> *frame_queue; // 帧队列，用于存储待处理的帧
 
@@ -53,14 +119,29 @@ typedef struct {
 
 
 
+// 输出了一帧，是关键帧时结算等待中的新观看者的首帧耗时
+void recordViewerFirstFrame(av_worker_context_t *ctx, bool key);
+
 class RtspWorker {
 public:
-    RtspWorker(std::string stream_name,std::string stream_url,int port, std::string push_path_first, std::string push_path_second,std::string model_root,int thread_num,msgServer *alarm_server = nullptr);
+    RtspWorker(const StreamConfig &stream, const GlobalConfig &global, int port, std::shared_ptr<InferContext> infer_ctx, msgServer *alarm_server = nullptr);
     ~RtspWorker();
 
     void start();    // 启动所有线程
     void stop();     // 停止线程并释放资源
     bool isRunning();
+    void reconnect();          // 原地重连拉流，保留解码器、编码器和推理上下文
+    uint32_t reconnectCount();
+    int64_t lastRestartMs();
+    void reportStageFps();     // 打印上次调用以来各阶段的帧率
+    void reportRateControl();  // 打印编码器当前的码率、帧率和 GOP
+    void reportOverload();     // 打印过载丢包的级别和累计丢弃数
+    void reportLatency();      // 打印上次调用以来的逐帧平均延迟
+    void setMosaicSlot(std::shared_ptr<MosaicSlot> slot); // 参与拼接输出，需在 start() 之前调用
+    uint32_t viewerJoins();
+    int64_t lastJoinMs();
+    // 播放请求事件（ZLMediaKit 事件线程）按 app/stream 找到对应的流
+    static void notifyViewerJoin(const std::string &app, const std::string &stream);
     std::atomic<bool> running_;
 
 private:
@@ -71,13 +152,18 @@ private:
     std::string push_path_second;
 
     AvPullStream *pullStream_; // 拉流对象
+    AvPullStream *inferPullStream_ = nullptr; // 子码流拉流对象（双码流输入时）
     AvPushStream *pushStream_; // 推流对象
 
     std::thread pull_thread_;
+    std::thread infer_pull_thread_;
     std::thread push_thread_;
     
 
     av_worker_context_t *ctx_; // 新增：保存视频流相关信息
+    av_worker_context_t *infer_ctx_ = nullptr; // 子码流上下文，与 ctx_ 共用推理池和内存池
+    std::unique_ptr<StageFpsMeter> fps_meter_;
+    std::string inference_url;
 };
 
 #endif // RTSP_WORKER_HPP
\ No newline at end of file
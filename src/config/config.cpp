@@ -28,6 +28,12 @@ Config::Config(const char *file) : file(file)
                 const Json::Value& globalObj = root["global"];
                 global.model_root = globalObj.get("model_root", "").asString();
                 global.thread_num = globalObj.get("thread_num", 4).asInt();
+                global.infer_queue_size = globalObj.get("infer_queue_size", 8).asInt();
+                global.decode_queue_size = globalObj.get("decode_queue_size", 64).asInt();
+                global.frame_memory_mb = globalObj.get("frame_memory_mb", 0).asInt();
+                global.frame_pool_idle_sec = globalObj.get("frame_pool_idle_sec", 30).asInt();
+                global.frame_buffer = globalObj.get("frame_buffer", "heap").asString();
+                global.dma_heap = globalObj.get("dma_heap", "/dev/dma_heap/system-dma32").asString();
             }
             
             // 解析RTSP服务器配置
@@ -37,6 +43,47 @@ Config::Config(const char *file) : file(file)
                 rtsp_server.port = rtspObj.get("port", 3554).asInt();
             }
             
+            // 解析拼接输出配置
+            if (root.isMember("mosaic") && root["mosaic"].isObject())
+            {
+                const Json::Value& mosaicObj = root["mosaic"];
+                mosaic.enable = mosaicObj.get("enable", false).asBool();
+                mosaic.app = mosaicObj.get("app", "live").asString();
+                mosaic.stream = mosaicObj.get("stream", "mosaic").asString();
+                mosaic.width = mosaicObj.get("width", 1920).asInt();
+                mosaic.height = mosaicObj.get("height", 1080).asInt();
+                mosaic.grid = mosaicObj.get("grid", 0).asInt();
+                mosaic.fps = mosaicObj.get("fps", 25).asInt();
+                mosaic.codec = mosaicObj.get("codec", "h264").asString();
+                mosaic.bitrate_kbps = mosaicObj.get("bitrate_kbps", 0).asInt();
+                if (mosaicObj.isMember("streams") && mosaicObj["streams"].isArray())
+                {
+                    for (const auto& id : mosaicObj["streams"])
+                    {
+                        mosaic.streams.push_back(id.asString());
+                    }
+                }
+            }
+
+            // 解析线程拓扑配置
+            if (root.isMember("thread_topology") && root["thread_topology"].isObject())
+            {
+                const Json::Value& topoObj = root["thread_topology"];
+                thread_topology.poller_num = topoObj.get("poller_num", 4).asInt();
+                auto parsePlacement = [&topoObj](const char *key, ThreadPlacementConfig &placement) {
+                    if (topoObj.isMember(key) && topoObj[key].isObject())
+                    {
+                        placement.cpus = topoObj[key].get("cpus", "").asString();
+                        placement.fifo_priority = topoObj[key].get("fifo_priority", 0).asInt();
+                    }
+                };
+                parsePlacement("poller", thread_topology.poller);
+                parsePlacement("decode", thread_topology.decode);
+                parsePlacement("infer", thread_topology.infer);
+                parsePlacement("encode", thread_topology.encode);
+                parsePlacement("msg", thread_topology.msg);
+            }
+
             // 解析流配置
             if (root.isMember("streams") && root["streams"].isArray())
             {
@@ -49,7 +96,37 @@ Config::Config(const char *file) : file(file)
                     stream.id = streamObj.get("id", "").asString();
                     stream.name = streamObj.get("name", "").asString();
                     stream.input_url = streamObj.get("input_url", "").asString();
+                    stream.inference_url = streamObj.get("inference_url", "").asString();
                     stream.enable = streamObj.get("enable", true).asBool();
+                    stream.weight = streamObj.get("weight", 1).asInt();
+                    stream.priority = streamObj.get("priority", 0).asInt();
+                    stream.process_fps = streamObj.get("process_fps", 0).asInt();
+                    stream.output_fps = streamObj.get("output_fps", 0).asInt();
+                    stream.overload = streamObj.get("overload", "off").asString();
+                    stream.copies = streamObj.get("copies", 1).asInt();
+                    if (streamObj.isMember("record") && streamObj["record"].isObject())
+                    {
+                        const Json::Value& recordObj = streamObj["record"];
+                        stream.record_dir = recordObj.get("dir", "").asString();
+                        stream.record_pre_sec = recordObj.get("pre_sec", 5).asInt();
+                        stream.record_post_sec = recordObj.get("post_sec", 10).asInt();
+                        stream.record_max_sec = recordObj.get("max_sec", 60).asInt();
+                    }
+                    if (streamObj.isMember("file") && streamObj["file"].isObject())
+                    {
+                        const Json::Value& fileObj = streamObj["file"];
+                        stream.file_pace = fileObj.get("pace", "realtime").asString();
+                        stream.file_fps = fileObj.get("fps", 25).asInt();
+                        stream.file_loops = fileObj.get("loops", 0).asInt();
+                    }
+                    if (streamObj.isMember("v4l2") && streamObj["v4l2"].isObject())
+                    {
+                        const Json::Value& v4l2Obj = streamObj["v4l2"];
+                        stream.v4l2_width = v4l2Obj.get("width", 1280).asInt();
+                        stream.v4l2_height = v4l2Obj.get("height", 720).asInt();
+                        stream.v4l2_fps = v4l2Obj.get("fps", 30).asInt();
+                        stream.v4l2_format = v4l2Obj.get("format", "auto").asString();
+                    }
                     
                     // 解析输出配置
                     if (streamObj.isMember("output") && streamObj["output"].isObject())
@@ -57,6 +134,30 @@ Config::Config(const char *file) : file(file)
                         const Json::Value& outputObj = streamObj["output"];
                         stream.output_app = outputObj.get("app", "live").asString();
                         stream.output_stream = outputObj.get("stream", "test").asString();
+                        stream.output_mode = outputObj.get("mode", "overlay").asString();
+                        stream.output_sei = outputObj.get("sei", false).asBool();
+                        stream.output_on_demand = outputObj.get("on_demand", false).asBool();
+                        stream.output_fast_join = outputObj.get("fast_join", true).asBool();
+                        stream.output_codec = outputObj.get("codec", "h264").asString();
+                        if (outputObj.isMember("roi") && outputObj["roi"].isObject())
+                        {
+                            const Json::Value& roiObj = outputObj["roi"];
+                            stream.roi_enable = roiObj.get("enable", true).asBool();
+                            stream.roi_max_regions = roiObj.get("max_regions", 6).asInt();
+                            stream.roi_qp_delta = roiObj.get("qp_delta", -6).asInt();
+                            stream.roi_bg_qp_delta = roiObj.get("bg_qp_delta", 4).asInt();
+                            stream.roi_hold_frames = roiObj.get("hold_frames", 5).asInt();
+                        }
+                        if (outputObj.isMember("rate") && outputObj["rate"].isObject())
+                        {
+                            const Json::Value& rateObj = outputObj["rate"];
+                            stream.output_bitrate_kbps = rateObj.get("bitrate_kbps", 0).asInt();
+                            stream.output_gop = rateObj.get("gop", 0).asInt();
+                            stream.rate_adaptive = rateObj.get("adaptive", false).asBool();
+                            stream.rate_min_kbps = rateObj.get("min_kbps", 0).asInt();
+                            stream.rate_min_fps = rateObj.get("min_fps", 0).asInt();
+                            stream.rate_max_gop_sec = rateObj.get("max_gop_sec", 4).asInt();
+                        }
                     }
                     else
                     {
@@ -65,7 +166,20 @@ Config::Config(const char *file) : file(file)
                         stream.output_stream = "test";
                     }
                     
-                    streams.push_back(stream);
+                    if (stream.copies <= 1)
+                    {
+                        streams.push_back(stream);
+                        continue;
+                    }
+                    // 压测：同一输入并行展开成多路，各自独立解码、推理和输出
+                    for (int k = 1; k <= stream.copies; ++k)
+                    {
+                        StreamConfig copy = stream;
+                        copy.id = stream.id + "_" + std::to_string(k);
+                        copy.name = stream.name + "_" + std::to_string(k);
+                        copy.output_stream = stream.output_stream + "_" + std::to_string(k);
+                        streams.push_back(copy);
+                    }
                 }
             }
             
@@ -125,10 +239,30 @@ void Config::show()
     printf("全局配置:\n");
     printf("  模型路径: %s\n", global.model_root.c_str());
     printf("  线程数: %d\n", global.thread_num);
+    printf("  推理队列长度: %d, 解码队列长度: %d\n", global.infer_queue_size, global.decode_queue_size);
+    printf("  帧内存上限: %dMB (0为不限制), 空闲回收: %ds\n", global.frame_memory_mb, global.frame_pool_idle_sec);
+    printf("  帧缓冲区: %s (%s)\n", global.frame_buffer.c_str(), global.dma_heap.c_str());
     
     printf("RTSP服务器:\n");
     printf("  端口: %d\n", rtsp_server.port);
     
+    if (mosaic.enable)
+    {
+        printf("拼接输出:\n");
+        printf("  输出: rtsp://localhost:%d/%s/%s, %dx%d@%d, %s, 网格: %s, 流: %s\n", rtsp_server.port,
+               mosaic.app.c_str(), mosaic.stream.c_str(), mosaic.width, mosaic.height, mosaic.fps, mosaic.codec.c_str(),
+               mosaic.grid > 0 ? (std::to_string(mosaic.grid) + "x" + std::to_string(mosaic.grid)).c_str() : "自动",
+               mosaic.streams.empty() ? "所有启用的流" : std::to_string(mosaic.streams.size()).c_str());
+    }
+
+    printf("线程拓扑:\n");
+    printf("  轮询线程数: %d\n", thread_topology.poller_num);
+    printf("  poller: cpus=[%s] fifo=%d\n", thread_topology.poller.cpus.c_str(), thread_topology.poller.fifo_priority);
+    printf("  decode: cpus=[%s] fifo=%d\n", thread_topology.decode.cpus.c_str(), thread_topology.decode.fifo_priority);
+    printf("  infer:  cpus=[%s] fifo=%d\n", thread_topology.infer.cpus.c_str(), thread_topology.infer.fifo_priority);
+    printf("  encode: cpus=[%s] fifo=%d\n", thread_topology.encode.cpus.c_str(), thread_topology.encode.fifo_priority);
+    printf("  msg:    cpus=[%s] fifo=%d\n", thread_topology.msg.cpus.c_str(), thread_topology.msg.fifo_priority);
+
     printf("流配置 (%zu 路流):\n", streams.size());
     for (size_t i = 0; i < streams.size(); ++i)
     {
@@ -136,9 +270,48 @@ void Config::show()
         printf("  [%zu] 流ID: %s\n", i + 1, stream.id.c_str());
         printf("      名称: %s\n", stream.name.c_str());
         printf("      输入: %s\n", stream.input_url.c_str());
+        if (!stream.inference_url.empty())
+        {
+            printf("      推理输入: %s\n", stream.inference_url.c_str());
+        }
         printf("      输出: rtsp://localhost:%d/%s/%s\n", 
                rtsp_server.port, stream.output_app.c_str(), stream.output_stream.c_str());
         printf("      启用: %s\n", stream.enable ? "是" : "否");
+        printf("      调度: weight=%d priority=%d\n", stream.weight, stream.priority);
+        printf("      输出模式: %s%s%s, 输出编码: %s, 输出帧率: %s, 推理帧率: %s\n", stream.output_mode.c_str(),
+               stream.output_sei ? "+SEI" : "", stream.output_on_demand ? "(按需编码)" : "", stream.output_codec.c_str(),
+               stream.output_fps > 0 ? std::to_string(stream.output_fps).c_str() : "不限",
+               stream.process_fps > 0 ? std::to_string(stream.process_fps).c_str() : "不限");
+        if (stream.overload != "off")
+        {
+            printf("      过载控制: %s\n", stream.overload.c_str());
+        }
+        if (stream.roi_enable)
+        {
+            printf("      编码ROI: 区域上限 %d, 目标QP %+d, 背景QP %+d, 保留 %d 帧\n", stream.roi_max_regions,
+                   stream.roi_qp_delta, stream.roi_bg_qp_delta, stream.roi_hold_frames);
+        }
+        if (stream.output_bitrate_kbps > 0 || stream.output_gop > 0 || stream.rate_adaptive)
+        {
+            printf("      码率控制: %skbps, GOP %s%s\n",
+                   stream.output_bitrate_kbps > 0 ? std::to_string(stream.output_bitrate_kbps).c_str() : "自动",
+                   stream.output_gop > 0 ? std::to_string(stream.output_gop).c_str() : "2秒",
+                   stream.rate_adaptive ? ", 自适应" : "");
+        }
+        if (!stream.record_dir.empty())
+        {
+            printf("      报警录像: %s, 事前 %ds, 事后 %ds, 最长 %ds\n", stream.record_dir.c_str(), stream.record_pre_sec,
+                   stream.record_post_sec, stream.record_max_sec);
+        }
+        if (stream.input_url.compare(0, 7, "file://") == 0)
+        {
+            printf("      文件回放: pace=%s fps=%d loops=%d\n", stream.file_pace.c_str(), stream.file_fps, stream.file_loops);
+        }
+        if (stream.input_url.compare(0, 7, "v4l2://") == 0)
+        {
+            printf("      摄像头采集: %dx%d@%d format=%s\n", stream.v4l2_width, stream.v4l2_height, stream.v4l2_fps,
+                   stream.v4l2_format.c_str());
+        }
         if (i < streams.size() - 1) printf("      ------\n");
     }
     
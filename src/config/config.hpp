@@ -9,15 +9,85 @@ struct StreamConfig {
     std::string id;
     std::string name;
     std::string input_url;
+    std::string inference_url; // 推理用的子码流地址，为空时在 input_url 上推理
     std::string output_app;
     std::string output_stream;
+    std::string output_mode = "overlay"; // "overlay" 解码画框后重新编码推流; "passthrough" 原始码流直接转发，解码只用于推理
+    std::string output_codec = "h264"; // 重新编码输出的编码类型: "h264" 或 "h265"，直通模式沿用输入编码
+    bool output_sei = false; // 检测结果写入SEI随码流下发，由播放端画框，服务端不再画框
+    bool output_on_demand = false; // 无人观看时暂停重新编码，推理和报警照常；开启后不再创建转推的 pusher
+    bool output_fast_join = true;  // 有新观看者时让编码器立即出 IDR，不用等到下一个 GOP
+    bool roi_enable = false;  // 按检测框设置编码 ROI：目标区域降低 QP，背景提高 QP（VBR/AVBR 下降低总码率）
+    int roi_max_regions = 6;  // 目标区域个数上限（含背景不超过硬件的 8 个）
+    int roi_qp_delta = -6;    // 目标区域相对 QP
+    int roi_bg_qp_delta = 4;  // 背景相对 QP，0 表示背景不变
+    int roi_hold_frames = 5;  // 目标漏检后区域继续保留的帧数，避免画质逐帧跳变
+    int output_bitrate_kbps = 0; // 重新编码的目标码率，0 表示按分辨率估算
+    int output_gop = 0;          // 重新编码的 GOP 帧数，0 表示 2 秒
+    bool rate_adaptive = false;  // 输出拥塞时自动降码率/帧率，静止画面延长 GOP
+    int rate_min_kbps = 0;       // 自动降码率的下限，0 表示目标码率的 1/4
+    int rate_min_fps = 0;        // 自动降帧率的下限，0 表示源帧率的一半
+    int rate_max_gop_sec = 4;    // 静止画面可延长到的 GOP 时长(秒)，0 表示不调整 GOP
+    int process_fps = 0;  // 送推理的帧率上限，0表示输出的每帧都推理
+    int output_fps = 0;   // 重新编码输出的帧率上限，0表示与源帧率相同；多出的帧解码后直接丢弃
+    std::string overload = "off"; // 过载时在解码前丢包的最高级别: "off" 不丢; "nonref" 丢非参考帧; "keyframes" 进一步只解码关键帧
+    std::string file_pace = "realtime"; // 裸流文件输入的回放节奏: "realtime" 按 file_fps 送帧; "max" 不限速且不丢帧
+    int file_fps = 25;    // 裸流文件没有时间戳，按该帧率生成时间戳
+    int file_loops = 0;   // 文件回放次数，0表示循环回放
+    int v4l2_width = 1280;  // V4L2 摄像头采集分辨率，驱动取最接近的档位
+    int v4l2_height = 720;
+    int v4l2_fps = 30;
+    std::string v4l2_format = "auto"; // 采集格式: "auto" 优先 MJPEG; "mjpeg"/"nv12"/"yuyv"
+    int copies = 1;       // 同一配置并行启动的路数，用于压测，第 k 路的 id/输出流名加后缀 _k
+    std::string record_dir; // 报警录像目录，为空表示不录像
+    int record_pre_sec = 5;   // 报警前缓存的时长(秒)，按GOP对齐，实际会略长
+    int record_post_sec = 10; // 最后一次报警之后继续录制的时长(秒)
+    int record_max_sec = 60;  // 单个录像片段的最长时长(秒)
     bool enable = true;
+    int weight = 1;     // 推理调度权重，每轮可连续推理的帧数
+    int priority = 0;   // 推理调度优先级，越大越优先获得空闲的推理上下文
 };
 
 // 全局配置结构
 struct GlobalConfig {
     std::string model_root;
-    int thread_num = 4;
+    int thread_num = 4;         // 共享推理上下文数量（模型实例数）
+    int infer_queue_size = 8;   // 每路流待推理队列长度，超出后丢弃最旧的帧
+    int decode_queue_size = 64; // 每路流待解码码流包队列长度，满了之后丢包直到下一个关键帧
+    int frame_memory_mb = 0;    // 所有流Mat内存池的总内存上限(MB)，0表示不限制
+    int frame_pool_idle_sec = 30; // 尺寸类空闲超过该时间后回收其空闲Mat，0表示不回收
+    std::string frame_buffer = "heap"; // 帧像素内存: "heap" 普通堆内存, "dma" dma_heap（不可用时退回memfd）
+    std::string dma_heap = "/dev/dma_heap/system-dma32"; // frame_buffer 为 dma 时使用的 dma_heap 设备
+};
+
+// 单类线程的放置配置
+struct ThreadPlacementConfig {
+    std::string cpus;       // 核心列表，如 "4-7" 或 "0,2-3"，为空表示不绑核
+    int fifo_priority = 0;  // SCHED_FIFO 优先级(1-99)，0 表示保持普通调度
+};
+
+// 线程拓扑配置，按线程类别绑核（如 RK3576 的 A72 大核为 4-7，A53 小核为 0-3）
+struct ThreadTopologyConfig {
+    int poller_num = 4;             // ZLMediaKit 事件轮询线程数
+    ThreadPlacementConfig poller;   // 事件轮询线程（网络收发）
+    ThreadPlacementConfig decode;   // 解码线程（MPP解码、颜色转换）
+    ThreadPlacementConfig infer;    // 推理调度线程
+    ThreadPlacementConfig encode;   // 推流线程（颜色转换、编码）
+    ThreadPlacementConfig msg;      // ZeroMQ 消息线程
+};
+
+// 多路拼接输出配置：各路带检测框的画面拼成一路，只占一个编码会话
+struct MosaicConfig {
+    bool enable = false;
+    std::string app = "live";
+    std::string stream = "mosaic";
+    int width = 1920;           // 拼接画面分辨率
+    int height = 1080;
+    int grid = 0;               // 每行/每列的格数，0 表示按路数自动选择（不超过 4 路为 2x2，否则 3x3）
+    int fps = 25;
+    std::string codec = "h264"; // "h264" 或 "h265"
+    int bitrate_kbps = 0;       // 0 表示按分辨率估算
+    std::vector<std::string> streams; // 参与拼接的流 id，按格子顺序；为空表示所有启用的流
 };
 
 // RTSP服务器配置结构
@@ -42,6 +112,8 @@ class Config {
         // 新的配置结构
         GlobalConfig global;
         RtspServerConfig rtsp_server;
+        MosaicConfig mosaic;
+        ThreadTopologyConfig thread_topology;
         std::vector<StreamConfig> streams;
         
         // 向后兼容的成员变量
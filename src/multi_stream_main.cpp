@@ -18,6 +18,7 @@ void printHelp() {
     printf("  status             - 查看流状态\n");
     printf("  list               - 列出所有流配置\n");
     printf("  health             - 健康检查\n");
+    printf("  threads            - 查看线程CPU占用\n");
     printf("  startall           - 启动所有启用的流\n");
     printf("  stopall            - 停止所有流\n");
     printf("  restartall         - 重启所有流\n");
@@ -142,6 +143,9 @@ int main(int argc, char *argv[]) {
         else if (command == "health" || command == "hc") {
             stream_manager.healthCheck();
         }
+        else if (command == "threads" || command == "th") {
+            stream_manager.showThreads();
+        }
         else if (command == "startall") {
             printf("启动所有启用的流\n");
             stream_manager.start();
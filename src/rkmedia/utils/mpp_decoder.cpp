@@ -37,6 +37,7 @@ MppDecoder::~MppDecoder()
         mpp_destroy(mpp_ctx);
         mpp_ctx = NULL;
     }
+    ReleaseImports();
 
     if (loop_data.frm_grp)
     {
@@ -60,6 +61,12 @@ int MppDecoder::Init(int video_type, int fps, void *userdata)
     {
         mpp_type = MPP_VIDEO_CodingHEVC;
     }
+    else if (video_type == 1)
+    {
+        // MJPEG（USB 摄像头），每个包就是完整的一帧，不需要分帧
+        mpp_type = MPP_VIDEO_CodingMJPEG;
+        need_split = 0;
+    }
     else
     {
         LOGD("unsupport video_type %d", video_type);
@@ -86,6 +93,17 @@ int MppDecoder::Init(int video_type, int fps, void *userdata)
         return -1;
     }
 
+    if (mpp_type == MPP_VIDEO_CodingMJPEG)
+    {
+        // 摄像头 MJPEG 多为 YUV422，让解码器直接输出 NV12，与 H.264/H.265 的后续处理一致
+        MppFrameFormat out_fmt = MPP_FMT_YUV420SP;
+        ret = mpp_mpi->control(mpp_ctx, MPP_DEC_SET_OUTPUT_FORMAT, &out_fmt);
+        if (ret)
+        {
+            LOGD("%p set output format failed ret %d ", mpp_ctx, ret);
+        }
+    }
+
     mpp_dec_cfg_init(&cfg);
 
     /* get default config from decoder context */
@@ -116,6 +134,17 @@ int MppDecoder::Init(int video_type, int fps, void *userdata)
 
     mpp_dec_cfg_deinit(cfg);
 
+    if (output_timeout_ms > 0)
+    {
+        // 输入队列满时阻塞等待空位，代替 put_packet 失败后的 usleep 重试
+        RK_S64 input_timeout = output_timeout_ms;
+        ret = mpp_mpi->control(mpp_ctx, MPP_SET_INPUT_TIMEOUT, &input_timeout);
+        if (ret)
+        {
+            LOGD("%p set input timeout failed ret %d ", mpp_ctx, ret);
+        }
+    }
+
     loop_data.ctx = mpp_ctx;
     loop_data.mpi = mpp_mpi;
     loop_data.eos = 0;
@@ -134,23 +163,25 @@ int MppDecoder::Reset()
     return 0;
 }
 
-int MppDecoder::Decode(uint8_t *pkt_data, int pkt_size, int pkt_eos)
+int MppDecoder::Decode(uint8_t *pkt_data, int pkt_size, int pkt_eos, int64_t pts, int64_t dts)
 {
-    MpiDecLoopData *data = &loop_data;
-    RK_U32 pkt_done = 0;
-    RK_U32 err_info = 0;
-    MPP_RET ret = MPP_OK;
-    MppCtx ctx = data->ctx;
-    MppApi *mpi = data->mpi;
-
-    size_t read_size = 0;
-    size_t packet_size = data->packet_size;
-
     //LOGD("receive packet size=%d ", pkt_size);
 
+    if (packet != NULL && mpp_packet_get_buffer(packet) != NULL)
+    {
+        // 上一个包来自 DecodeDmaBuf，绑定着导入的缓冲区，不能再按地址送包
+        mpp_packet_deinit(&packet);
+        packet = NULL;
+    }
     if (packet == NULL)
     {
-        ret = mpp_packet_init(&packet, NULL, 0);
+        MPP_RET ret = mpp_packet_init(&packet, NULL, 0);
+        if (ret != MPP_OK)
+        {
+            LOGD("mpp_packet_init failed ret %d ", ret);
+            packet = NULL;
+            return ret;
+        }
     }
 
     ///////////////////////////////////////////////
@@ -159,9 +190,86 @@ int MppDecoder::Decode(uint8_t *pkt_data, int pkt_size, int pkt_eos)
     mpp_packet_set_size(packet, pkt_size);
     mpp_packet_set_pos(packet, pkt_data);
     mpp_packet_set_length(packet, pkt_size);
+    if (pts >= 0)
+    {
+        mpp_packet_set_pts(packet, pts);
+    }
+    if (dts >= 0)
+    {
+        mpp_packet_set_dts(packet, dts);
+    }
     // setup eos flag
     if (pkt_eos)
         mpp_packet_set_eos(packet);
+    return DecodePacket(pkt_eos);
+}
+
+int MppDecoder::DecodeDmaBuf(int fd, size_t buf_size, int pkt_size, int64_t pts)
+{
+    // 按 fd 导入一次后反复使用，外部缓冲区轮转使用，个数有限
+    MppBuffer buffer = NULL;
+    auto it = imported_bufs.find(fd);
+    if (it != imported_bufs.end())
+    {
+        buffer = it->second;
+    }
+    else
+    {
+        MppBufferInfo info;
+        memset(&info, 0, sizeof(info));
+        info.type = MPP_BUFFER_TYPE_EXT_DMA;
+        info.fd = fd;
+        info.size = buf_size;
+        info.index = (RK_S32)imported_bufs.size();
+        MPP_RET ret = mpp_buffer_import(&buffer, &info);
+        if (ret != MPP_OK)
+        {
+            LOGD("import dma-buf fd %d failed ret %d ", fd, ret);
+            return ret;
+        }
+        imported_bufs[fd] = buffer;
+    }
+    if (packet != NULL)
+    {
+        mpp_packet_deinit(&packet);
+    }
+    mpp_packet_init_with_buffer(&packet, buffer);
+    mpp_packet_set_length(packet, pkt_size);
+    if (pts >= 0)
+    {
+        mpp_packet_set_pts(packet, pts);
+        mpp_packet_set_dts(packet, pts);
+    }
+    return DecodePacket(0);
+}
+
+void MppDecoder::ReleaseImports()
+{
+    if (imported_bufs.empty())
+    {
+        return;
+    }
+    // 当前 packet 可能引用着导入的缓冲区，一起释放，下次送包时重新创建
+    if (packet != NULL)
+    {
+        mpp_packet_deinit(&packet);
+        packet = NULL;
+    }
+    for (auto &imported : imported_bufs)
+    {
+        mpp_buffer_put(imported.second);
+    }
+    imported_bufs.clear();
+}
+
+int MppDecoder::DecodePacket(int pkt_eos)
+{
+    MpiDecLoopData *data = &loop_data;
+    RK_U32 pkt_done = 0;
+    RK_U32 err_info = 0;
+    MPP_RET ret = MPP_OK;
+    MppCtx ctx = data->ctx;
+    MppApi *mpi = data->mpi;
     do
     {
 
@@ -174,15 +282,28 @@ int MppDecoder::Decode(uint8_t *pkt_data, int pkt_size, int pkt_eos)
                 pkt_done = 1;
         }
         // then get all available frame and release
+        RK_U32 waited = 0;
         do
         {
             RK_S32 get_frm = 0;
             RK_U32 frm_eos = 0;
 
         try_again:
+            if (output_timeout_ms > 0)
+            {
+                // 每个包只阻塞等待一次输出帧，之后不等待地取完已解码的帧
+                ApplyOutputTimeout(waited ? MPP_POLL_NON_BLOCK : output_timeout_ms);
+                waited = 1;
+            }
             ret = mpi->decode_get_frame(ctx, &frame);
             if (MPP_ERR_TIMEOUT == ret)
             {
+                if (output_timeout_ms > 0)
+                {
+                    // 本包暂时没有输出帧（参数集、参考帧重排等），留到下一个包再取
+                    ret = MPP_OK;
+                    break;
+                }
                 if (times > 0)
                 {
                     times--;
@@ -294,14 +415,32 @@ int MppDecoder::Decode(uint8_t *pkt_data, int pkt_size, int pkt_eos)
                         // LOGD("data_vir=%p fd=%d ", data_vir, fd);
                         callback(this->userdata, hor_stride, ver_stride, hor_width, ver_height, format, fd, data_vir);
                     }
-                    unsigned long cur_time_ms = GetCurrentTimeMS();
-                    long time_gap = 1000 / this->fps - (cur_time_ms - this->last_frame_time_ms);
-                    // LOGD("time_gap=%ld", time_gap);
-                    if (time_gap > 0)
+                    if (info_callback != nullptr)
                     {
-                        usleep(time_gap * 1000);
+                        MppDecoderFrameInfo info;
+                        info.width_stride = hor_stride;
+                        info.height_stride = ver_stride;
+                        info.width = hor_width;
+                        info.height = ver_height;
+                        info.format = mpp_frame_get_fmt(frame);
+                        info.fd = mpp_buffer_get_fd(mpp_frame_get_buffer(frame));
+                        info.data = mpp_buffer_get_ptr(mpp_frame_get_buffer(frame));
+                        info.pts = mpp_frame_get_pts(frame);
+                        info.dts = mpp_frame_get_dts(frame);
+                        info_callback(this->userdata, &info);
+                    }
+                    // fps <= 0 时不按帧率限速，节奏由输入决定
+                    if (this->fps > 0)
+                    {
+                        unsigned long cur_time_ms = GetCurrentTimeMS();
+                        long time_gap = 1000 / this->fps - (cur_time_ms - this->last_frame_time_ms);
+                        // LOGD("time_gap=%ld", time_gap);
+                        if (time_gap > 0)
+                        {
+                            usleep(time_gap * 1000);
+                        }
+                        this->last_frame_time_ms = GetCurrentTimeMS();
                     }
-                    this->last_frame_time_ms = GetCurrentTimeMS();
                 }
                 frm_eos = mpp_frame_get_eos(frame);
 
@@ -373,8 +512,32 @@ int MppDecoder::Decode(uint8_t *pkt_data, int pkt_size, int pkt_eos)
     return ret;
 }
 
+int MppDecoder::SetOutputTimeout(int timeout_ms)
+{
+    this->output_timeout_ms = timeout_ms > 0 ? timeout_ms : 0;
+    return 0;
+}
+
+void MppDecoder::ApplyOutputTimeout(RK_S64 timeout_ms)
+{
+    if (timeout_ms == cur_output_timeout || mpp_mpi == NULL)
+    {
+        return;
+    }
+    if (mpp_mpi->control(loop_data.ctx, MPP_SET_OUTPUT_TIMEOUT, &timeout_ms) == MPP_OK)
+    {
+        cur_output_timeout = timeout_ms;
+    }
+}
+
 int MppDecoder::SetCallback(MppDecoderFrameCallback callback)
 {
     this->callback = callback;
     return 0;
-}
\ No newline at end of file
+}
+
+int MppDecoder::SetFrameInfoCallback(MppDecoderFrameInfoCallback callback)
+{
+    this->info_callback = callback;
+    return 0;
+}
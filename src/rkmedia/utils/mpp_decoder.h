@@ -6,6 +6,7 @@
 #include "mpp_frame.h"
 #include <string.h>
 #include <pthread.h>
+#include <map>
 
 #define MPI_DEC_STREAM_SIZE         (SZ_4K)
 #define MPI_DEC_LOOP_COUNT          4
@@ -13,6 +14,22 @@
 
 typedef void (*MppDecoderFrameCallback)(void* userdata, int width_stride, int height_stride, int width, int height, int format, int fd, void* data);
 
+// 解码输出帧信息，比 MppDecoderFrameCallback 多带出时间戳
+typedef struct
+{
+    int width_stride;
+    int height_stride;
+    int width;
+    int height;
+    int format;
+    int fd;
+    void *data;
+    int64_t pts;        // 毫秒，来自输入码流包
+    int64_t dts;
+} MppDecoderFrameInfo;
+
+typedef void (*MppDecoderFrameInfoCallback)(void* userdata, const MppDecoderFrameInfo* info);
+
 typedef struct
 {
     MppCtx          ctx;
@@ -38,11 +55,22 @@ public:
     MppApi *mpp_mpi         = NULL;
     MppDecoder();
     ~MppDecoder();
+    // fps 为解码输出的限速帧率，<= 0 时不限速
     int Init(int video_type, int fps, void* userdata);
     int SetCallback(MppDecoderFrameCallback callback);
-    int Decode(uint8_t* pkt_data, int pkt_size, int pkt_eos);
+    int SetFrameInfoCallback(MppDecoderFrameInfoCallback callback);
+    // pts/dts 单位毫秒，随码流包送入MPP，解码输出帧时通过 MppDecoderFrameInfo 带回；小于0表示未知
+    int Decode(uint8_t* pkt_data, int pkt_size, int pkt_eos, int64_t pts = -1, int64_t dts = -1);
+    // 码流在外部 dma-buf 中（V4L2 摄像头缓冲区），按 fd 导入给MPP，硬件直接读取，不经过用户态拷贝
+    int DecodeDmaBuf(int fd, size_t buf_size, int pkt_size, int64_t pts = -1);
+    // 释放 DecodeDmaBuf 导入的全部外部缓冲区，外部缓冲区关闭（fd 可能被复用）之前调用
+    void ReleaseImports();
     int Reset();
+    // 设置后送包/取帧改为阻塞等待（单位毫秒），代替 usleep 轮询；需在 Init 之前调用，0 表示沿用轮询
+    int SetOutputTimeout(int timeout_ms);
 private:
+    void ApplyOutputTimeout(RK_S64 timeout_ms);
+    int DecodePacket(int pkt_eos); // 送入已准备好的 packet 并取出所有输出帧
     // base flow context
     MpiCmd mpi_cmd      = MPP_CMD_BASE;
     MppParam mpp_param1      = NULL;
@@ -56,9 +84,13 @@ private:
     MppPacket packet = NULL;
     MppFrame  frame  = NULL;
     pthread_t th=NULL;
-    MppDecoderFrameCallback callback;
+    MppDecoderFrameCallback callback = nullptr;
+    MppDecoderFrameInfoCallback info_callback = nullptr;
     int fps = -1;
     unsigned long last_frame_time_ms = 0;
+    int output_timeout_ms = 0;
+    RK_S64 cur_output_timeout = -2; // 当前设置给MPP的取帧超时，避免重复control
+    std::map<int, MppBuffer> imported_bufs; // DecodeDmaBuf 导入的外部缓冲区，fd -> MppBuffer
 
     void* userdata = NULL;
 };
@@ -102,6 +102,41 @@ int MppEncoder::InitParams(MppEncoderParams &params)
     return 0;
 }
 
+void MppEncoder::SetBitrateBounds()
+{
+    mpp_enc_cfg_set_s32(cfg, "rc:bps_target", enc_params.bps);
+    switch (enc_params.rc_mode)
+    {
+    case MPP_ENC_RC_MODE_FIXQP:
+    {
+        /* do not setup bitrate on FIXQP mode */
+    }
+    break;
+    case MPP_ENC_RC_MODE_CBR:
+    {
+        /* CBR mode has narrow bound */
+        mpp_enc_cfg_set_s32(cfg, "rc:bps_max", enc_params.bps_max ? enc_params.bps_max : enc_params.bps * 17 / 16);
+        mpp_enc_cfg_set_s32(cfg, "rc:bps_min", enc_params.bps_min ? enc_params.bps_min : enc_params.bps * 15 / 16);
+    }
+    break;
+    case MPP_ENC_RC_MODE_VBR:
+    case MPP_ENC_RC_MODE_AVBR:
+    {
+        /* VBR mode has wide bound */
+        mpp_enc_cfg_set_s32(cfg, "rc:bps_max", enc_params.bps_max ? enc_params.bps_max : enc_params.bps * 17 / 16);
+        mpp_enc_cfg_set_s32(cfg, "rc:bps_min", enc_params.bps_min ? enc_params.bps_min : enc_params.bps * 1 / 16);
+    }
+    break;
+    default:
+    {
+        /* default use CBR mode */
+        mpp_enc_cfg_set_s32(cfg, "rc:bps_max", enc_params.bps_max ? enc_params.bps_max : enc_params.bps * 17 / 16);
+        mpp_enc_cfg_set_s32(cfg, "rc:bps_min", enc_params.bps_min ? enc_params.bps_min : enc_params.bps * 15 / 16);
+    }
+    break;
+    }
+}
+
 int MppEncoder::SetupEncCfg()
 {
     MPP_RET ret;
@@ -149,37 +184,7 @@ int MppEncoder::SetupEncCfg()
     mpp_enc_cfg_set_u32(cfg, "rc:drop_gap", 1);  /* Do not continuous drop frame */
 
     /* setup bitrate for different rc_mode */
-    mpp_enc_cfg_set_s32(cfg, "rc:bps_target", enc_params.bps);
-    switch (enc_params.rc_mode)
-    {
-    case MPP_ENC_RC_MODE_FIXQP:
-    {
-        /* do not setup bitrate on FIXQP mode */
-    }
-    break;
-    case MPP_ENC_RC_MODE_CBR:
-    {
-        /* CBR mode has narrow bound */
-        mpp_enc_cfg_set_s32(cfg, "rc:bps_max", enc_params.bps_max ? enc_params.bps_max : enc_params.bps * 17 / 16);
-        mpp_enc_cfg_set_s32(cfg, "rc:bps_min", enc_params.bps_min ? enc_params.bps_min : enc_params.bps * 15 / 16);
-    }
-    break;
-    case MPP_ENC_RC_MODE_VBR:
-    case MPP_ENC_RC_MODE_AVBR:
-    {
-        /* VBR mode has wide bound */
-        mpp_enc_cfg_set_s32(cfg, "rc:bps_max", enc_params.bps_max ? enc_params.bps_max : enc_params.bps * 17 / 16);
-        mpp_enc_cfg_set_s32(cfg, "rc:bps_min", enc_params.bps_min ? enc_params.bps_min : enc_params.bps * 1 / 16);
-    }
-    break;
-    default:
-    {
-        /* default use CBR mode */
-        mpp_enc_cfg_set_s32(cfg, "rc:bps_max", enc_params.bps_max ? enc_params.bps_max : enc_params.bps * 17 / 16);
-        mpp_enc_cfg_set_s32(cfg, "rc:bps_min", enc_params.bps_min ? enc_params.bps_min : enc_params.bps * 15 / 16);
-    }
-    break;
-    }
+    SetBitrateBounds();
 
     /* setup qp for different codec and rc_mode */
     switch (enc_params.type)
@@ -369,6 +374,8 @@ MppEncoder::MppEncoder()
     this->mpp_ctx = NULL;
     this->mpp_mpi = NULL;
     memset(&osd_data, 0, sizeof(MppEncOSDData));
+    memset(&roi_cfg, 0, sizeof(MppEncROICfg));
+    memset(roi_regions, 0, sizeof(roi_regions));
 }
 
 MppEncoder::~MppEncoder()
@@ -564,6 +571,12 @@ int MppEncoder::GetHeader(char *enc_buf, int max_size)
 
             void *ptr = mpp_packet_get_pos(packet);
             size_t len = mpp_packet_get_length(packet);
+            if (len > (size_t)max_size)
+            {
+                LOGE("header buffer too small, need %zu\n", len);
+                mpp_packet_deinit(&packet);
+                return -1;
+            }
 
             memcpy(out_ptr, ptr, len);
             out_ptr = (char *)(out_ptr) + len;
@@ -575,11 +588,10 @@ int MppEncoder::GetHeader(char *enc_buf, int max_size)
     return out_len;
 }
 
-int MppEncoder::Encode(void *mpp_buf, char *enc_buf, int max_size)
+// 送入一帧待编码数据，输出包写入 pkt_buf
+int MppEncoder::PutFrame(void *mpp_buf)
 {
     MPP_RET ret;
-    void *out_ptr = enc_buf;
-    size_t out_len = 0;
 
     MppMeta meta = NULL;
     MppFrame frame = NULL;
@@ -587,7 +599,6 @@ int MppEncoder::Encode(void *mpp_buf, char *enc_buf, int max_size)
     // void *buf = mpp_buffer_get_ptr(this->frm_buf);
     // RK_S32 cam_frm_idx = -1;
     // MppBuffer cam_buf = NULL;
-    RK_U32 eoi = 1;
     RK_U32 frm_eos = 0;
 
     ret = mpp_frame_init(&frame);
@@ -611,6 +622,11 @@ int MppEncoder::Encode(void *mpp_buf, char *enc_buf, int max_size)
     mpp_packet_set_length(packet, 0);
     mpp_meta_set_packet(meta, KEY_OUTPUT_PACKET, packet);
     mpp_meta_set_buffer(meta, KEY_MOTION_INFO, this->md_info);
+    if (roi_cfg.number > 0)
+    {
+        // ROI 按帧生效，编码器根据区域生成宏块级 QP 表
+        mpp_meta_set_ptr(meta, KEY_ROI_DATA, (void *)&roi_cfg);
+    }
 
 #if 0
     if (enc_params.osd_enable || enc_params.user_data_enable || enc_params.roi_enable) {
@@ -711,6 +727,24 @@ int MppEncoder::Encode(void *mpp_buf, char *enc_buf, int max_size)
         LOGD("chn %d encode put frame failed\n", chn);
         return -1;
     }
+    return 0;
+}
+
+int MppEncoder::Encode(void *mpp_buf, char *enc_buf, int max_size)
+{
+    MPP_RET ret;
+    void *out_ptr = enc_buf;
+    size_t out_len = 0;
+    bool overflow = false;
+    MppMeta meta = NULL;
+    MppPacket packet = NULL;
+    RK_U32 eoi = 1;
+
+    if (PutFrame(mpp_buf) != 0)
+    {
+        return -1;
+    }
+    last_packet_intra = false;
 
     do
     {
@@ -744,7 +778,8 @@ int MppEncoder::Encode(void *mpp_buf, char *enc_buf, int max_size)
             }
             if (enc_buf != nullptr && max_size > 0)
             {
-                if (out_len + log_len < max_size)
+                size_t needed = out_len + len;
+                if (!overflow && needed <= (size_t)max_size)
                 {
                     memcpy(out_ptr, ptr, len);
                     out_len += len;
@@ -752,8 +787,11 @@ int MppEncoder::Encode(void *mpp_buf, char *enc_buf, int max_size)
                 }
                 else
                 {
-                    LOGE("error enc_buf no enought");
+                    // 缓冲区不够时丢弃整帧，调用方按 GetLastPacketSize() 扩容
+                    LOGE("error enc_buf no enought, need %zu\n", needed);
+                    overflow = true;
                 }
+                this->last_packet_size = needed;
             }
 
             // log_len += snprintf(log_buf + log_len, log_size - log_len,
@@ -790,6 +828,10 @@ int MppEncoder::Encode(void *mpp_buf, char *enc_buf, int max_size)
                 if (MPP_OK == mpp_meta_get_s32(meta, KEY_ENC_AVERAGE_QP, &avg_qp))
                     log_len += snprintf(log_buf + log_len, log_size - log_len,
                                         " qp %d", avg_qp);
+
+                RK_S32 intra = 0;
+                if (MPP_OK == mpp_meta_get_s32(meta, KEY_OUTPUT_INTRA, &intra) && intra)
+                    last_packet_intra = true;
             }
 
             // LOGD("chn %d %s\n", chn, log_buf);
@@ -808,7 +850,249 @@ int MppEncoder::Encode(void *mpp_buf, char *enc_buf, int max_size)
 
     // if (enc_params.frm_eos && enc_params.pkt_eos)
     //     break;
-    return out_len;
+    return overflow ? -1 : out_len;
+}
+
+int MppEncoder::Encode(void *mpp_buf, const char **out_data)
+{
+    MppPacket packet = NULL;
+
+    *out_data = NULL;
+    if (enc_params.split_mode != 0)
+    {
+        LOGE("zero copy encode does not support slice split output\n");
+        return -1;
+    }
+    if (PutFrame(mpp_buf) != 0)
+    {
+        return -1;
+    }
+
+    // 未开启切片时一帧只输出一个包，数据就在 pkt_buf 中，直接把地址交给调用方
+    MPP_RET ret = mpp_mpi->encode_get_packet(mpp_ctx, &packet);
+    if (ret || packet == NULL)
+    {
+        LOGD("chn %d encode get packet failed\n", chn);
+        return -1;
+    }
+    void *ptr = mpp_packet_get_pos(packet);
+    size_t len = mpp_packet_get_length(packet);
+    if (this->callback != nullptr)
+    {
+        this->callback(this->userdata, (const char *)ptr, len);
+    }
+    RK_S32 intra = 0;
+    last_packet_intra = mpp_packet_has_meta(packet) &&
+                        mpp_meta_get_s32(mpp_packet_get_meta(packet), KEY_OUTPUT_INTRA, &intra) == MPP_OK && intra;
+    mpp_packet_deinit(&packet);
+
+    this->last_packet_size = len;
+    *out_data = (const char *)ptr;
+    return len;
+}
+
+int MppEncoder::RequestIdr()
+{
+    if (mpp_mpi == NULL)
+    {
+        return -1;
+    }
+    MPP_RET ret = mpp_mpi->control(mpp_ctx, MPP_ENC_SET_IDR_FRAME, NULL);
+    if (ret)
+    {
+        LOGE("chn %d request idr failed ret %d\n", chn, ret);
+        return -1;
+    }
+    return 0;
+}
+
+int MppEncoder::SetRoi(const MppEncoderRoi *regions, int count, int bg_qp_delta)
+{
+    RK_U32 n = 0;
+    int width = (int)enc_params.width;
+    int height = (int)enc_params.height;
+    if (count > 0 && width > 0 && height > 0)
+    {
+        if (bg_qp_delta != 0)
+        {
+            // 背景区域放在最前面，后面的区域覆盖它
+            MppEncROIRegion *bg = &roi_regions[n++];
+            memset(bg, 0, sizeof(MppEncROIRegion));
+            bg->w = MPP_ALIGN(width, 16);
+            bg->h = MPP_ALIGN(height, 16);
+            bg->quality = MppEncoderClampRoiQp(bg_qp_delta);
+            bg->area_map_en = 1;
+        }
+        for (int i = 0; i < count && n < MPP_ENCODER_MAX_ROI; ++i)
+        {
+            MppEncoderRoi aligned;
+            if (!MppEncoderAlignRoi(regions[i], width, height, &aligned))
+            {
+                continue;
+            }
+            MppEncROIRegion *region = &roi_regions[n++];
+            memset(region, 0, sizeof(MppEncROIRegion));
+            region->x = aligned.x;
+            region->y = aligned.y;
+            region->w = aligned.w;
+            region->h = aligned.h;
+            region->quality = aligned.qp_delta;
+            region->area_map_en = 1;
+        }
+        if (n == 1 && bg_qp_delta != 0)
+        {
+            // 所有目标区域都无效时不单独压低整帧画质
+            n = 0;
+        }
+    }
+    roi_cfg.number = n;
+    roi_cfg.regions = n > 0 ? roi_regions : NULL;
+    return (int)n;
+}
+
+int MppEncoder::SetRateControl(int bps, int fps, int gop)
+{
+    if (mpp_mpi == NULL || cfg == NULL)
+    {
+        return -1;
+    }
+    if (bps > 0)
+    {
+        // 上下限跟随目标码率按比例变化，初始化时显式指定的上下限不再适用
+        enc_params.bps = bps;
+        enc_params.bps_max = 0;
+        enc_params.bps_min = 0;
+        SetBitrateBounds();
+    }
+    if (fps > 0)
+    {
+        enc_params.fps_in_num = fps;
+        enc_params.fps_in_den = 1;
+        enc_params.fps_out_num = fps;
+        enc_params.fps_out_den = 1;
+        mpp_enc_cfg_set_s32(cfg, "rc:fps_in_num", fps);
+        mpp_enc_cfg_set_s32(cfg, "rc:fps_in_denorm", 1);
+        mpp_enc_cfg_set_s32(cfg, "rc:fps_out_num", fps);
+        mpp_enc_cfg_set_s32(cfg, "rc:fps_out_denorm", 1);
+    }
+    if (gop > 0)
+    {
+        enc_params.gop_len = gop;
+    }
+    mpp_enc_cfg_set_s32(cfg, "rc:gop", GetGop());
+
+    MPP_RET ret = mpp_mpi->control(mpp_ctx, MPP_ENC_SET_CFG, cfg);
+    if (ret)
+    {
+        LOGE("chn %d set rate control failed ret %d\n", chn, ret);
+        return -1;
+    }
+    return 0;
+}
+
+int MppEncoder::SetPrepConfig(const MppEncoderParams &params)
+{
+    mpp_enc_cfg_set_s32(cfg, "prep:width", params.width);
+    mpp_enc_cfg_set_s32(cfg, "prep:height", params.height);
+    mpp_enc_cfg_set_s32(cfg, "prep:hor_stride", params.hor_stride);
+    mpp_enc_cfg_set_s32(cfg, "prep:ver_stride", params.ver_stride);
+    return mpp_mpi->control(mpp_ctx, MPP_ENC_SET_CFG, cfg);
+}
+
+int MppEncoder::AllocBuffers(size_t pkt_size, size_t md_size)
+{
+    if (this->frm_buf)
+    {
+        mpp_buffer_put(this->frm_buf);
+        this->frm_buf = NULL;
+    }
+    if (this->pkt_buf)
+    {
+        mpp_buffer_put(this->pkt_buf);
+        this->pkt_buf = NULL;
+    }
+    if (this->md_info)
+    {
+        mpp_buffer_put(this->md_info);
+        this->md_info = NULL;
+    }
+    // 归还后的缓冲区仍缓存在内部缓冲组里，清掉才真正释放旧尺寸的内存；输入帧缓冲区在下次取用时按新大小申请
+    mpp_buffer_group_clear(this->buf_grp);
+
+    MPP_RET ret = mpp_buffer_get(this->buf_grp, &this->pkt_buf, pkt_size);
+    if (ret)
+    {
+        LOGE("chn %d get packet buffer failed ret %d\n", chn, ret);
+        return -1;
+    }
+    ret = mpp_buffer_get(this->buf_grp, &this->md_info, md_size);
+    if (ret)
+    {
+        LOGE("chn %d get motion info buffer failed ret %d\n", chn, ret);
+        mpp_buffer_put(this->pkt_buf);
+        this->pkt_buf = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int MppEncoder::Reconfigure(int width, int height, int hor_stride, int ver_stride)
+{
+    if (mpp_mpi == NULL || cfg == NULL)
+    {
+        return -1;
+    }
+    // 新参数和缓冲区大小先算到局部变量里，全部成功后才生效；失败时编码器保持原分辨率，调用方下一帧重试
+    MppEncoderParams old_params;
+    memcpy(&old_params, &enc_params, sizeof(MppEncoderParams));
+    size_t old_frame_size = this->frame_size;
+    size_t old_mdinfo_size = this->mdinfo_size;
+    size_t old_header_size = this->header_size;
+
+    MppEncoderParams params;
+    memcpy(&params, &enc_params, sizeof(MppEncoderParams));
+    params.width = width;
+    params.height = height;
+    params.hor_stride = hor_stride;
+    params.ver_stride = ver_stride;
+    InitParams(params);
+    MppEncoderParams new_params;
+    memcpy(&new_params, &enc_params, sizeof(MppEncoderParams));
+    size_t new_frame_size = this->frame_size;
+    size_t new_mdinfo_size = this->mdinfo_size;
+    size_t new_header_size = this->header_size;
+    memcpy(&enc_params, &old_params, sizeof(MppEncoderParams));
+    this->frame_size = old_frame_size;
+    this->mdinfo_size = old_mdinfo_size;
+    this->header_size = old_header_size;
+
+    MPP_RET ret = (MPP_RET)SetPrepConfig(new_params);
+    if (ret)
+    {
+        LOGE("chn %d reconfigure %dx%d failed ret %d\n", chn, width, height, ret);
+        // cfg 中已写入新尺寸，恢复成旧值，之后的码率等设置不会把新尺寸带进去
+        SetPrepConfig(old_params);
+        return -1;
+    }
+    if (AllocBuffers(new_frame_size, new_mdinfo_size) != 0)
+    {
+        LOGE("chn %d reconfigure %dx%d buffers failed, keep %dx%d\n", chn, width, height, old_params.width,
+             old_params.height);
+        SetPrepConfig(old_params);
+        AllocBuffers(old_frame_size, old_mdinfo_size);
+        return -1;
+    }
+
+    memcpy(&enc_params, &new_params, sizeof(MppEncoderParams));
+    this->frame_size = new_frame_size;
+    this->mdinfo_size = new_mdinfo_size;
+    this->header_size = new_header_size;
+    // 旧分辨率下的 ROI 坐标不再有效
+    roi_cfg.number = 0;
+    roi_cfg.regions = NULL;
+    LOGD("chn %d encoder reconfigured to %dx%d stride %dx%d\n", chn, enc_params.width, enc_params.height,
+         enc_params.hor_stride, enc_params.ver_stride);
+    return RequestIdr();
 }
 
 int MppEncoder::Reset()
@@ -825,6 +1109,11 @@ size_t MppEncoder::GetFrameSize()
     return this->frame_size;
 }
 
+size_t MppEncoder::GetLastPacketSize()
+{
+    return this->last_packet_size;
+}
+
 void *MppEncoder::ImportBuffer(int index, size_t size, int fd, int type)
 {
     MppBuffer buf;
@@ -8,6 +8,51 @@
 
 typedef void (*MppEncoderFrameCallback)(void* userdata, const char* data, int size);
 
+// 硬件编码器支持的 ROI 区域个数上限（vepu541/580/510）
+#define MPP_ENCODER_MAX_ROI 8
+
+// ROI 区域，像素坐标，qp_delta 为相对码率控制 QP 的偏移，负数表示提高画质
+typedef struct
+{
+    int x;
+    int y;
+    int w;
+    int h;
+    int qp_delta;
+} MppEncoderRoi;
+
+// ROI 相对 QP 限制在硬件支持的 [-31, 31]
+static inline int MppEncoderClampRoiQp(int qp_delta)
+{
+    return qp_delta < -31 ? -31 : (qp_delta > 31 ? 31 : qp_delta);
+}
+
+// 左上角向下、右下角向上取整到宏块(16)边界，保证目标完整落在区域内，再裁剪到按 16 对齐的画面内；
+// 裁剪后为空时返回 false
+static inline bool MppEncoderAlignRoi(const MppEncoderRoi& roi, int width, int height, MppEncoderRoi* aligned)
+{
+    int frame_w = (width + 15) & ~15;
+    int frame_h = (height + 15) & ~15;
+    int x0 = roi.x < 0 ? 0 : roi.x & ~15;
+    int y0 = roi.y < 0 ? 0 : roi.y & ~15;
+    int x1 = (roi.x + roi.w + 15) & ~15;
+    int y1 = (roi.y + roi.h + 15) & ~15;
+    if (x1 > frame_w)
+        x1 = frame_w;
+    if (y1 > frame_h)
+        y1 = frame_h;
+    if (x1 <= x0 || y1 <= y0)
+    {
+        return false;
+    }
+    aligned->x = x0;
+    aligned->y = y0;
+    aligned->w = x1 - x0;
+    aligned->h = y1 - y0;
+    aligned->qp_delta = MppEncoderClampRoiQp(roi.qp_delta);
+    return true;
+}
+
 typedef struct
 {
     RK_U32 width;
@@ -67,16 +112,52 @@ class MppEncoder {
     int Init(MppEncoderParams& params, void* userdata);
     int SetCallback(MppEncoderFrameCallback callback);
     int Encode(void* mpp_buf, char* enc_buf, int max_size);
+    // 零拷贝编码：out_data 指向编码器内部的 pkt_buf，下一次 Encode/GetHeader 前有效；不支持切片输出
+    int Encode(void* mpp_buf, const char** out_data);
     int GetHeader(char* enc_buf, int max_size);
     int Reset();
+    int RequestIdr(); // 下一帧编码为 IDR
+    /**
+     * 设置之后每一帧使用的 ROI，count 为 0 时取消
+     * bg_qp_delta 不为 0 时先写入一个覆盖整帧的背景区域，regions 依次覆盖在它上面
+     * 坐标按 16 像素宏块对齐并裁剪到画面内，超出硬件上限的区域被忽略
+     */
+    int SetRoi(const MppEncoderRoi* regions, int count, int bg_qp_delta);
+    /**
+     * 运行时调整码率控制，从下一帧开始生效，不重建编码器
+     * @param bps 目标码率，<=0 保持不变；码率上下限按当前 rc_mode 的比例重新计算
+     * @param fps 送入编码器的帧率，<=0 保持不变；输入输出帧率同时修改，降帧由调用方跳帧完成
+     * @param gop GOP 帧数，<=0 保持不变
+     */
+    int SetRateControl(int bps, int fps, int gop);
+    /**
+     * 分辨率变化时原地重配编码器：按新尺寸重新申请输入/输出缓冲区，旧尺寸的缓冲区全部归还，
+     * 码率控制参数保持不变，下一帧编码为带参数集的 IDR。调用方需保证没有正在编码的帧
+     * @param hor_stride/ver_stride 为 0 时按 16 对齐
+     */
+    int Reconfigure(int width, int height, int hor_stride, int ver_stride);
+    int GetWidth() { return enc_params.width; }
+    int GetHeight() { return enc_params.height; }
+    int GetHorStride() { return enc_params.hor_stride; }
+    int GetVerStride() { return enc_params.ver_stride; }
+    int GetBps() { return enc_params.bps; }
+    int GetFps() { return enc_params.fps_out_num / (enc_params.fps_out_den ? enc_params.fps_out_den : 1); }
+    int GetGop() { return enc_params.gop_len ? enc_params.gop_len : GetFps() * 2; }
     void* ImportBuffer(int index, size_t size, int fd, int type);
     size_t GetFrameSize();
+    size_t GetLastPacketSize(); // 最近一帧编码输出的实际长度（缓冲区不足时为需要的长度）
+    bool LastPacketIsIntra() { return last_packet_intra; } // 最近一帧是否为 I 帧（IDR）
+    bool SupportZeroCopy() { return enc_params.split_mode == 0; }
     void* GetInputFrameBuffer();
     int GetInputFrameBufferFd(void* mpp_buffer);
     void* GetInputFrameBufferAddr(void* mpp_buffer);
   private:
     int InitParams(MppEncoderParams& params);
+    int PutFrame(void* mpp_buf);
     int SetupEncCfg();
+    void SetBitrateBounds(); // 按 rc_mode 把 bps 及上下限写入 cfg
+    int SetPrepConfig(const MppEncoderParams &params); // 把分辨率和跨距写入 cfg 并提交
+    int AllocBuffers(size_t pkt_size, size_t md_size);  // 释放旧缓冲区后按给定大小重新申请包和运动信息缓冲区
 
     MppCtx mpp_ctx = NULL;
     MppApi* mpp_mpi = NULL;
@@ -103,6 +184,7 @@ class MppEncoder {
     MppEncOSDData osd_data;
     // RoiRegionCfg    roi_region;
     MppEncROICfg roi_cfg;
+    MppEncROIRegion roi_regions[MPP_ENCODER_MAX_ROI]; // 编码期间必须保持有效，随帧元数据送入
 
     // input / output
     MppBufferGroup buf_grp = NULL;
@@ -118,6 +200,8 @@ class MppEncoder {
     size_t mdinfo_size;
     /* NOTE: packet buffer may overflow */
     size_t packet_size;
+    size_t last_packet_size = 0;
+    bool last_packet_intra = false;
 
     MppEncoderParams enc_params;
 
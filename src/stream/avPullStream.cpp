@@ -1,14 +1,52 @@
+#include <algorithm>
 #include "avPullStream.hpp"
 #include "matPool.hpp"
+#include "nalUtils.hpp"
+#include "fileSource.hpp"
+#include "v4l2Source.hpp"
+#include "utils/threadAffinity.hpp"
+
+// 解码线程每个码流包等待解码输出的最长时间
+static const int kDecodeOutputTimeoutMs = 20;
+// 断流重连的退避时间：首次 500ms，每次翻倍，最长 30s
+static const int kReconnectInitialMs = 500;
+static const int kReconnectMaxMs = 30000;
 
 void API_CALL on_mk_play_event_func(void *user_data, int err_code, const char *err_msg, mk_track tracks[], int track_count);
 void API_CALL on_mk_shutdown_func(void *user_data, int err_code, const char *err_msg, mk_track tracks[], int track_count);
 void API_CALL on_track_frame_out(void *user_data, mk_frame frame);
-void mpp_decoder_frame_callback(void *userdata, int width_stride, int height_stride, int width, int height, int format, int fd, void *data);
+void mpp_decoder_frame_callback(void *userdata, const MppDecoderFrameInfo *info);
 
 AvPullStream::AvPullStream(std::string url, av_worker_context_t *ctx)
-    : url_(url), ctx_(ctx), video_type_(264), video_fps_(30), player_(nullptr)
+    : url_(url), ctx_(ctx), video_type_(264), video_fps_(30), player_(nullptr), backoff_ms_(kReconnectInitialMs),
+      decoder_codec_(0)
+{
+}
+
+// 创建解码器，dedicated_thread 为 true 时解码在独立线程中进行，可以阻塞等待解码输出。
+// 独立解码线程的节奏由输入决定（RTSP 包到达、文件按 file_fps 或不限速回放、摄像头采集），
+// 解码器内部不再按帧率 sleep，否则不限速回放被压到 30fps，实时流每帧白白多等一段
+static void createDecoder(av_worker_context_t *ctx, int video_type, bool dedicated_thread)
+{
+    MppDecoder *decoder = new MppDecoder(); // 创建解码器
+    /*!目前写死30帧，后续应该从on_mk_play_event_func中通过mk_track_get_fps获取fps传入*/
+    printf("当前type：%d，fps：%d\n", video_type, ctx->video_fps);
+    // decoder->Init(ctx->video_type, ctx->video_fps, ctx); // 初始化解码器
+    if (dedicated_thread)
+    {
+        decoder->SetOutputTimeout(kDecodeOutputTimeoutMs);
+    }
+    decoder->Init(video_type, dedicated_thread ? 0 : 30, ctx); // 初始化解码器，0 表示不限速
+    decoder->SetFrameInfoCallback(mpp_decoder_frame_callback); // 设置回调函数，用来处理解码后的数据
+    ctx->decoder = decoder;                              // 将解码器赋值给上下文
+}
+
+// 标记需要重连，由拉流线程释放播放器后重新拉流；断流时间只记第一次，重连失败不刷新
+static void requestReconnect(av_worker_context_t *ctx)
 {
+    int64_t expected = 0;
+    ctx->reconnect_begin_us.compare_exchange_strong(expected, VideoFrame::NowUs());
+    ctx->need_reconnect = true;
 }
 // 拉流回调
 void API_CALL on_mk_play_event_func(void *user_data, int err_code, const char *err_msg, mk_track tracks[],
@@ -25,10 +63,25 @@ void API_CALL on_mk_play_event_func(void *user_data, int err_code, const char *e
             if (mk_track_is_video(tracks[i]))
             {
                 printf("got video track: %s\n", mk_track_codec_name(tracks[i]));
-                // 将track信息保存到ctx，供推流使用
+                int codec_id = mk_track_codec_id(tracks[i]);
+                if (codec_id != MKCodecH264 && codec_id != MKCodecH265)
+                {
+                    printf("不支持的视频编码: %s\n", mk_track_codec_name(tracks[i]));
+                    continue;
+                }
+                int video_type = codec_id == MKCodecH265 ? VIDEO_CODEC_H265 : VIDEO_CODEC_H264;
+                int old_width = ctx->width;
+                int old_height = ctx->height;
+                // 推流线程看到 tracks 后会读取编码类型，先写编码类型
+                ctx->video_type = video_type;
+                // 将track信息保存到ctx，供推流使用；重连时替换上一次会话的轨道
+                mk_track old_tracks = ctx->tracks;
                 ctx->tracks = mk_track_ref(tracks[i]);
+                if (old_tracks != nullptr)
+                {
+                    mk_track_unref(old_tracks);
+                }
                 printf("get video track\n");
-                ctx->video_type = 264;
                 ctx->video_fps = mk_track_video_fps(tracks[i]);
                 if (ctx->video_fps == 0)
                 {
@@ -36,17 +89,29 @@ void API_CALL on_mk_play_event_func(void *user_data, int err_code, const char *e
                 }
                 ctx->width = mk_track_video_width(tracks[i]);
                 ctx->height = mk_track_video_height(tracks[i]);
-                printf("video type: %d, fps: %d, width: %d, height: %d\n",
-                       ctx->video_type, ctx->video_fps, ctx->width, ctx->height);
-                if (ctx->decoder == NULL)
+                printf("video type: %s, fps: %d, width: %d, height: %d\n",
+                       codecName(ctx->video_type), ctx->video_fps, ctx->width, ctx->height);
+                if (old_width > 0 && (old_width != ctx->width || old_height != ctx->height))
+                {
+                    printf("[%s] 重连后分辨率变化 %dx%d -> %dx%d\n", ctx->stream_name.c_str(), old_width, old_height,
+                           ctx->width, ctx->height);
+                }
+                // 按探测到的实际分辨率预分配，避免预分配用不上的尺寸
+                if (ctx->mat_pool != nullptr && ctx->width > 0 && ctx->height > 0 && ctx->mat_pool->getInitialPoolSize() > 0)
+                {
+                    ctx->mat_pool->preallocate(ctx->width, ctx->height, ctx->mat_pool->getInitialPoolSize());
+                }
+                if (!ctx->skip_decode)
                 {
-                    MppDecoder *decoder = new MppDecoder(); // 创建解码器
-                    /*!目前写死30帧，后续应该从on_mk_play_event_func中通过mk_track_get_fps获取fps传入*/
-                    printf("当前type：%d，fps：%d\n", ctx->video_type, ctx->video_fps);
-                    // decoder->Init(ctx->video_type, ctx->video_fps, ctx); // 初始化解码器
-                    decoder->Init(ctx->video_type, 30, ctx); // 初始化解码器
-                    decoder->SetCallback(mpp_decoder_frame_callback);    // 设置回调函数，用来处理解码后的数据
-                    ctx->decoder = decoder;                              // 将解码器赋值给上下文
+                    if (ctx->packet_queue != nullptr)
+                    {
+                        // 解码器归解码线程所有，这里只通知编码类型，由解码线程在取出新会话的第一个包之前创建或重建
+                        ctx->pending_codec = video_type;
+                    }
+                    else if (ctx->decoder == NULL)
+                    {
+                        createDecoder(ctx, video_type, false);
+                    }
                 }
                 // 监听track数据回调
                 mk_track_add_delegate(tracks[i], on_track_frame_out, user_data);
@@ -55,61 +120,227 @@ void API_CALL on_mk_play_event_func(void *user_data, int err_code, const char *e
     }
     else
     {
-        printf("play failed: %d %s", err_code, err_msg);
+        printf("play failed: %d %s\n", err_code, err_msg);
+        requestReconnect(ctx);
     }
 }
 // 播放器中断回调
 void API_CALL on_mk_shutdown_func(void *user_data, int err_code, const char *err_msg, mk_track tracks[], int track_count)
 {
-    printf("play interrupted: %d %s", err_code, err_msg);
+    printf("play interrupted: %d %s\n", err_code, err_msg);
+    requestReconnect((av_worker_context_t *)user_data);
+}
+// 解码下游的负载(0~1)：待解码队列，以及待推理队列或双码流的待叠加队列，取占用比例最高的
+static double downstreamLoad(av_worker_context_t *ctx)
+{
+    double load = 0;
+    if (ctx->packet_queue != nullptr && ctx->packet_queue->max_size() > 0)
+    {
+        load = (double)ctx->packet_queue->size() / ctx->packet_queue->max_size();
+    }
+    if (ctx->display_queue != nullptr && ctx->display_queue->max_size() > 0)
+    {
+        load = std::max(load, (double)ctx->display_queue->size() / ctx->display_queue->max_size());
+    }
+    else if (ctx->pool != nullptr)
+    {
+        load = std::max(load, (double)ctx->pool->GetTasksSize() / (ctx->infer_backlog + 1));
+    }
+    return load;
 }
+
 // track中的帧数据回调
 void API_CALL on_track_frame_out(void *user_data, mk_frame frame)
 {
     av_worker_context_t *ctx = (av_worker_context_t *)user_data;
     const char *data = mk_frame_get_data(frame);
     size_t size = mk_frame_get_data_size(frame);
-    ctx->decoder->Decode((uint8_t *)data, size, 0);
+    ctx->stages.demuxed++;
+    if (ctx->passthrough)
+    {
+        // 直通模式：原始码流包原样转发到输出媒体源，解码只服务于推理；持锁期间推流线程不会释放媒体源
+        std::lock_guard<std::mutex> output_lock(ctx->output_mutex);
+        mk_media media = ctx->output_media.load(std::memory_order_acquire);
+        if (media != nullptr)
+        {
+            if (ctx->output_sei)
+            {
+                // 推理结果晚于码流到达，把最新一次的检测结果SEI插在当前帧前面，SEI中带有所描述帧的pts
+                std::vector<uint8_t> sei;
+                {
+                    std::lock_guard<std::mutex> lock(ctx->sei_mutex);
+                    sei.swap(ctx->pending_sei);
+                }
+                if (!sei.empty())
+                {
+                    if (ctx->video_type == VIDEO_CODEC_H265)
+                    {
+                        mk_media_input_h265(media, sei.data(), (int)sei.size(), mk_frame_get_dts(frame), mk_frame_get_pts(frame));
+                    }
+                    else
+                    {
+                        mk_media_input_h264(media, sei.data(), (int)sei.size(), mk_frame_get_dts(frame), mk_frame_get_pts(frame));
+                    }
+                }
+            }
+            mk_media_input_frame(media, frame);
+            ctx->stages.output++;
+            uint32_t flags = mk_frame_get_flags(frame);
+            recordViewerFirstFrame(ctx, (flags & MK_FRAME_FLAG_IS_KEY) != 0);
+            if (ctx->recorder != nullptr)
+            {
+                ctx->recorder->addPacket((const uint8_t *)data, size, mk_frame_get_dts(frame), mk_frame_get_pts(frame),
+                                         (flags & MK_FRAME_FLAG_IS_KEY) != 0, (flags & MK_FRAME_FLAG_IS_CONFIG) != 0);
+            }
+        }
+    }
+    if (ctx->skip_decode)
+    {
+        return;
+    }
+    if (ctx->shedder.maxLevel() > SHED_NONE)
+    {
+        // 过载时在解码之前按 NAL 类型丢包，比解码后再丢省掉解码和颜色转换
+        if (ctx->shedder.update(VideoFrame::NowUs(), downstreamLoad(ctx)))
+        {
+            printf("[%s] 过载控制: %s，累计丢弃 %llu 个码流包\n", ctx->stream_name.c_str(),
+                   shedLevelName(ctx->shedder.level()), (unsigned long long)ctx->shedder.dropped());
+        }
+        uint32_t flags = mk_frame_get_flags(frame);
+        if (ctx->shedder.shouldDrop(ctx->video_type, (const uint8_t *)data, size, (flags & MK_FRAME_FLAG_IS_KEY) != 0,
+                                    (flags & MK_FRAME_FLAG_IS_CONFIG) != 0))
+        {
+            return;
+        }
+    }
+    if (ctx->packet_queue != nullptr)
+    {
+        // 只增加引用计数后入队，由解码线程解码，不占用网络线程
+        uint32_t flags = mk_frame_get_flags(frame);
+        bool key = (flags & MK_FRAME_FLAG_IS_KEY) != 0;
+        if (ctx->wait_keyframe && !key && (flags & MK_FRAME_FLAG_IS_CONFIG) == 0)
+        {
+            ctx->packets_dropped++;
+            return;
+        }
+        queued_packet_t packet;
+        packet.frame = mk_frame_ref(frame);
+        packet.arrival_us = VideoFrame::NowUs();
+        if (!ctx->packet_queue->push(packet))
+        {
+            // 丢了一个包，后续帧的参考关系已经不完整，一直丢到下一个关键帧
+            mk_frame_unref(packet.frame);
+            if (!ctx->wait_keyframe)
+            {
+                printf("[%s] 解码队列已满，丢包至下一个关键帧，累计丢弃 %llu 个\n", ctx->stream_name.c_str(),
+                       (unsigned long long)ctx->packets_dropped + 1);
+            }
+            ctx->wait_keyframe = true;
+            ctx->packets_dropped++;
+            return;
+        }
+        if (key)
+        {
+            ctx->wait_keyframe = false;
+        }
+        return;
+    }
+    // 解码在当前线程同步完成，解码回调里用它作为帧的到达时间
+    ctx->last_packet_us = VideoFrame::NowUs();
+    // 源端时间戳随码流包送入解码器，解码输出的帧带回同一个pts
+    ctx->decoder->Decode((uint8_t *)data, size, 0, (int64_t)mk_frame_get_pts(frame), (int64_t)mk_frame_get_dts(frame));
 }
 
-void mpp_decoder_frame_callback(void *userdata, int width_stride, int height_stride, int width, int height, int format, int fd, void *data)
+void mpp_decoder_frame_callback(void *userdata, const MppDecoderFrameInfo *info)
 {
 
     av_worker_context_t *ctx = (av_worker_context_t *)userdata;
     int ret = 0;
+    int64_t decode_us = VideoFrame::NowUs();
+    int width = info->width;
+    int height = info->height;
+    int width_stride = info->width_stride;
+    int height_stride = info->height_stride;
+    int fd = info->fd;
+    ctx->stages.decoded++;
+    int64_t restart_begin_us = ctx->reconnect_begin_us.load();
+    if (restart_begin_us > 0 && ctx->reconnect_begin_us.compare_exchange_strong(restart_begin_us, 0))
+    {
+        // 重连后解出第一帧，记录断流到恢复出帧的耗时
+        ctx->last_restart_ms = (decode_us - restart_begin_us) / 1000;
+        printf("[%s] 重连恢复，断流到首帧 %lld ms，累计重连 %u 次\n", ctx->stream_name.c_str(),
+               (long long)ctx->last_restart_ms, ctx->reconnect_count.load());
+    }
+    // 抽帧在颜色转换和取 MatPool 缓冲区之前完成，丢掉的帧只花了解码的开销
+    int64_t frame_ms = info->pts >= 0 ? info->pts : decode_us / 1000;
+    if (!ctx->output_decimator.accept(frame_ms))
+    {
+        return;
+    }
+    bool run_model = ctx->process_decimator.accept(frame_ms);
+    if (!run_model && (ctx->passthrough || ctx->infer_only))
+    {
+        // 不重新编码时，不推理的帧没有别的用处
+        return;
+    }
     // rga原始数据
     rga_buffer_t origin;
     // rga_buffer_t src;
+    if (ctx->width > 0 && (ctx->width != width || ctx->height != height))
+    {
+        // 码流中途切换分辨率：解码器已在 info change 中重配缓冲组，这里停用旧尺寸的 Mat，
+        // 推流线程按帧尺寸重配编码器，旧尺寸的帧在此之前已按顺序编码输出
+        printf("[%s] 解码输出分辨率变化 %dx%d -> %dx%d\n", ctx->stream_name.c_str(), ctx->width, ctx->height, width, height);
+        if (ctx->mat_pool != nullptr)
+        {
+            ctx->mat_pool->retirePool(ctx->width, ctx->height);
+        }
+        ctx->format_changes++;
+    }
     ctx->width = width;
     ctx->height = height;
     ctx->width_stride = width_stride;
     ctx->height_stride = height_stride;
 
-    // 编码器准备
-    if (ctx->encoder == NULL)
+    // 编码器准备，直通模式和推理子码流不需要编码器
+    if (ctx->encoder == NULL && !ctx->passthrough && !ctx->infer_only)
     {
         MppEncoder *mpp_encoder = new MppEncoder();
         MppEncoderParams enc_params;
         memset(&enc_params, 0, sizeof(MppEncoderParams));
         enc_params.width = width;
         enc_params.height = height;
-        enc_params.hor_stride = width_stride;
-        enc_params.ver_stride = height_stride;
+        // 摄像头输入的跨距不一定按 16 对齐，编码器缓冲区自己对齐，推流线程按编码器跨距转换
+        enc_params.hor_stride = (width_stride + 15) & ~15;
+        enc_params.ver_stride = (height_stride + 15) & ~15;
         enc_params.fmt = MPP_FMT_YUV420SP;
-        enc_params.type = MPP_VIDEO_CodingAVC;
+        enc_params.type = ctx->output_codec == VIDEO_CODEC_H265 ? MPP_VIDEO_CodingHEVC : MPP_VIDEO_CodingAVC;
+        // 码率控制按实际送进编码器的帧率（output_fps 抽帧后）分配每帧的码率，0 时编码器按 30fps 估算
+        int output_fps = ctx->output_decimator.outputFps(ctx->video_fps);
+        enc_params.fps_in_num = output_fps;
+        enc_params.fps_out_num = output_fps;
+        enc_params.bps = ctx->rate.bitrate_kbps * 1000;
+        enc_params.gop_len = ctx->rate.gop;
         mpp_encoder->Init(enc_params, NULL);
+        ctx->rc_bps = mpp_encoder->GetBps();
+        ctx->rc_fps = mpp_encoder->GetFps();
+        ctx->rc_gop = mpp_encoder->GetGop();
         ctx->encoder = mpp_encoder;
     }
 
     // 复制到另一个缓冲区，避免修改mpp解码器缓冲区
-    // 使用的是RK RGA的格式转换：YUV420SP -> RGB888
-    origin = wrapbuffer_fd(fd, width, height, RK_FORMAT_YCbCr_420_SP, width_stride, height_stride);
+    // 使用的是RK RGA的格式转换：YUV420SP(摄像头 YUYV) -> RGB888
+    // 摄像头驱动不支持导出 dma-buf 时 fd 为 -1，按虚拟地址交给RGA
+    int src_format = info->format == MPP_FMT_YUV422_YUYV ? RK_FORMAT_YUYV_422 : RK_FORMAT_YCbCr_420_SP;
+    origin = fd >= 0 ? wrapbuffer_fd(fd, width, height, src_format, width_stride, height_stride)
+                     : wrapbuffer_virtualaddr(info->data, width, height, src_format, width_stride, height_stride);
     
     // 从内存池获取Mat对象，而不是每次都创建新的
     std::shared_ptr<cv::Mat> origin_mat;
+    const DmaBuffer *mat_buffer = nullptr;
     if (ctx->mat_pool != nullptr) {
         try {
-            origin_mat = ctx->mat_pool->getMat(width, height, CV_8UC3);
+            origin_mat = ctx->mat_pool->getMat(width, height, CV_8UC3, false, &mat_buffer);
         } catch (const std::exception& e) {
             printf("Failed to get Mat from pool: %s\n", e.what());
             // 降级到直接创建Mat
@@ -119,9 +350,21 @@ void mpp_decoder_frame_callback(void *userdata, int width_stride, int height_str
         // 如果没有内存池，直接创建（保持向后兼容）
         origin_mat = std::make_shared<cv::Mat>(height, width, CV_8UC3);
     }
+    if (origin_mat == nullptr)
+    {
+        // 帧内存预算耗尽，丢弃本帧，等下游归还内存
+        if (ctx->mem_dropped++ % 100 == 0)
+        {
+            printf("[%s] 帧内存预算耗尽，已丢弃 %llu 帧\n", ctx->stream_name.c_str(), (unsigned long long)ctx->mem_dropped);
+        }
+        return;
+    }
     
-    // 将这块内存包装成 RGA 目标图像
-    rga_buffer_t rgb_img = wrapbuffer_virtualaddr((void *)origin_mat->data, width, height, RK_FORMAT_RGB_888);
+    // 将这块内存包装成 RGA 目标图像，dma-buf 直接按fd交给RGA，避免导入虚拟地址
+    bool dst_dmabuf = mat_buffer != nullptr && mat_buffer->isDmaBuf();
+    rga_buffer_t rgb_img = dst_dmabuf
+                               ? wrapbuffer_fd(mat_buffer->fd(), width, height, RK_FORMAT_RGB_888)
+                               : wrapbuffer_virtualaddr((void *)origin_mat->data, width, height, RK_FORMAT_RGB_888);
     // 填充 RGA 目标图像
     ret = imcopy(origin, rgb_img);
     if (ret != IM_STATUS_SUCCESS)
@@ -129,16 +372,51 @@ void mpp_decoder_frame_callback(void *userdata, int width_stride, int height_str
         printf("imcopy failed! ret: %d, error: %s\n", ret, imStrError((IM_STATUS)ret));
         return;
     }
+    // RGA写完，后续推理和画框由CPU访问；窗口随帧流转，交给硬件读之前或帧被丢弃时结束
+    std::shared_ptr<DmaCpuAccess> cpu_access =
+        dst_dmabuf ? std::make_shared<DmaCpuAccess>(mat_buffer->fd(), origin_mat) : nullptr;
     /*直接将图片推入推理线程池，避免额外的队列和线程管理*/
-    if (ctx->pool == nullptr)
+    if (ctx->pool == nullptr && ctx->display_queue == nullptr)
     {
         printf("ctx->pool is nullptr!\n");
         return;
     }
+    // 组装帧描述符，时间戳、序号随帧一起流转到推流线程
+    auto video_frame = std::make_shared<VideoFrame>();
+    video_frame->mat = origin_mat;
+    video_frame->fd = mat_buffer != nullptr ? mat_buffer->fd() : -1;
+    video_frame->fd_is_dmabuf = dst_dmabuf;
+    video_frame->cpu_access = cpu_access;
+    video_frame->format = VIDEO_FRAME_FMT_RGB888;
+    video_frame->width = width;
+    video_frame->height = height;
+    video_frame->width_stride = origin_mat->step / origin_mat->elemSize();
+    video_frame->height_stride = height;
+    video_frame->pts = info->pts;
+    video_frame->dts = info->dts;
+    video_frame->seq = ++ctx->frame_seq;
+    video_frame->stream_id = ctx->stream_name;
+    video_frame->capture_us = ctx->last_packet_us > 0 ? ctx->last_packet_us : decode_us;
+    video_frame->decode_us = decode_us;
+    if (ctx->display_queue != nullptr)
+    {
+        // 双码流叠加模式：主码流帧不推理，交给推流线程匹配子码流的检测结果
+        ctx->display_queue->push(video_frame);
+        return;
+    }
+    if (ctx->file_max_speed && ctx->pool != nullptr)
+    {
+        // 不限速回放：等推理队列留出空位再送，避免推理队列丢帧，每次测量处理的帧完全相同
+        while (ctx->pool->GetTasksSize() >= ctx->infer_backlog && ctx->running)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
     // printf("Pushing image to inference thread pool...\n");
     try
     {
-        ctx->pool->inferenceThread(origin_mat);
+        // 输出帧率高于推理帧率时，没轮到推理的帧沿用最近一次检测结果，保证输出流畅
+        ctx->pool->inferenceThread(video_frame, run_model);
     }
     catch (const std::bad_alloc &e)
     {
@@ -160,8 +438,9 @@ AvPullStream::~AvPullStream()
     }
 }
 
-bool AvPullStream::start()
+bool AvPullStream::openPlayer()
 {
+    std::lock_guard<std::mutex> lock(player_mutex_);
     // 初始化播放器
     player_ = mk_player_create();
     if (!player_)
@@ -172,24 +451,344 @@ bool AvPullStream::start()
     // 设置回调函数
     mk_player_set_on_result(player_, on_mk_play_event_func, ctx_);
     mk_player_set_on_shutdown(player_, on_mk_shutdown_func, ctx_);
-    // 初始化解码器
-
-    if (!player_)
-    {
-        log_error("Player not initialized");
-        return false;
-    }
     // 启动播放器
     char *stream_url = const_cast<char *>(url_.c_str());
     mk_player_play(player_, stream_url);
     printf("Player started with URL: %s\n", stream_url);
+    return true;
+}
+
+void AvPullStream::reconnect()
+{
+    {
+        std::lock_guard<std::mutex> lock(player_mutex_);
+        if (player_)
+        {
+            mk_player_release(player_);
+            player_ = nullptr;
+        }
+    }
+    // 旧会话残留的码流包不再解码，解码器清空内部状态后从新会话的关键帧开始
+    if (ctx_->packet_queue != nullptr)
+    {
+        queued_packet_t packet;
+        while (ctx_->packet_queue->pop_for(packet, 0))
+        {
+            mk_frame_unref(packet.frame);
+        }
+        ctx_->wait_keyframe = true;
+    }
+    if (ctx_->decoder != nullptr)
+    {
+        ctx_->decoder->Reset();
+    }
+    printf("[%s] 拉流中断，%d ms 后第 %u 次重连\n", ctx_->stream_name.c_str(), backoff_ms_, ctx_->reconnect_count.load() + 1);
+    for (int waited = 0; waited < backoff_ms_ && ctx_->running; waited += 100)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    backoff_ms_ = std::min(backoff_ms_ * 2, kReconnectMaxMs);
+    if (!ctx_->running)
+    {
+        return;
+    }
+    ctx_->reconnect_count++;
+    // 解码器、编码器、推理池和输出媒体源都保留，只重建播放器
+    openPlayer();
+}
 
+bool AvPullStream::runFileSource(const std::string &path)
+{
+    AnnexBFileReader reader;
+    if (!reader.open(path))
+    {
+        return false;
+    }
+    ThreadTopology::instance().placeCurrentThread(ThreadClass::Decode, "decode_" + ctx_->stream_name);
+    // 裸流没有轨道信息，编码类型从参数集推断，时间戳按配置的帧率生成；分辨率由解码输出给出
+    ctx_->video_type = reader.codec();
+    ctx_->video_fps = ctx_->file_fps;
+    ctx_->file_source = true;
+    if (!ctx_->skip_decode)
+    {
+        createDecoder(ctx_, ctx_->video_type, true);
+    }
+    if (ctx_->passthrough)
+    {
+        // 等推流线程建好输出媒体源再开始回放，开头的帧不丢
+        while (ctx_->output_media.load(std::memory_order_acquire) == nullptr && ctx_->running)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    printf("[%s] 文件回放: %s, %s, %d fps, 回放 %s 次\n", ctx_->stream_name.c_str(), path.c_str(),
+           ctx_->file_max_speed ? "不限速" : "实时", ctx_->file_fps,
+           ctx_->file_loops > 0 ? std::to_string(ctx_->file_loops).c_str() : "无限");
+
+    const int64_t interval_us = 1000000 / ctx_->file_fps;
+    StageFpsMeter meter(ctx_->stages);
+    int64_t start_us = VideoFrame::NowUs();
+    int64_t last_report_us = start_us;
+    uint64_t index = 0;
+    int loop = 0;
+    AccessUnit unit;
+    while (ctx_->running)
+    {
+        if (!reader.next(unit))
+        {
+            if (ctx_->file_loops > 0 && ++loop >= ctx_->file_loops)
+            {
+                break;
+            }
+            reader.rewind();
+            continue;
+        }
+        // 时间戳跨循环连续递增，推流端不会把回绕当成断流
+        int64_t pts = (int64_t)(index * 1000 / ctx_->file_fps);
+        if (!ctx_->file_max_speed)
+        {
+            int64_t wait_us = start_us + (int64_t)index * interval_us - VideoFrame::NowUs();
+            if (wait_us > 0)
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(wait_us));
+            }
+        }
+        ++index;
+        ctx_->stages.demuxed++;
+        if (ctx_->passthrough)
+        {
+            std::lock_guard<std::mutex> output_lock(ctx_->output_mutex);
+            mk_media media = ctx_->output_media.load(std::memory_order_acquire);
+            if (media != nullptr)
+            {
+                if (ctx_->video_type == VIDEO_CODEC_H265)
+                {
+                    mk_media_input_h265(media, unit.data, (int)unit.size, pts, pts);
+                }
+                else
+                {
+                    mk_media_input_h264(media, unit.data, (int)unit.size, pts, pts);
+                }
+                ctx_->stages.output++;
+                recordViewerFirstFrame(ctx_, unit.key);
+                if (ctx_->recorder != nullptr)
+                {
+                    ctx_->recorder->addPacket(unit.data, unit.size, pts, pts, unit.key);
+                }
+            }
+        }
+        if (ctx_->decoder != nullptr)
+        {
+            ctx_->last_packet_us = VideoFrame::NowUs();
+            ctx_->decoder->Decode((uint8_t *)unit.data, (int)unit.size, 0, pts, pts);
+        }
+        int64_t now_us = VideoFrame::NowUs();
+        if (now_us - last_report_us >= 5000000)
+        {
+            meter.report(ctx_->stream_name.c_str());
+            last_report_us = now_us;
+        }
+    }
+    printf("[%s] 文件回放结束，共 %llu 帧，耗时 %.2fs\n", ctx_->stream_name.c_str(), (unsigned long long)index,
+           (VideoFrame::NowUs() - start_us) / 1e6);
+    meter.summary(ctx_->stream_name.c_str());
+    // 回放结束后保持运行，推流线程继续输出已在途的帧，等待外部停止
     while (ctx_->running)
     {
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
     return true;
 }
+
+bool AvPullStream::runV4l2Source(const std::string &device)
+{
+    V4l2Capture capture;
+    if (!capture.open(device, ctx_->v4l2))
+    {
+        return false;
+    }
+    ThreadTopology::instance().placeCurrentThread(ThreadClass::Decode, "decode_" + ctx_->stream_name);
+    ctx_->video_fps = capture.fps();
+    ctx_->file_source = true;
+    bool mjpeg = capture.isMjpeg();
+    if (mjpeg)
+    {
+        ctx_->video_type = VIDEO_CODEC_MJPEG;
+        createDecoder(ctx_, ctx_->video_type, true);
+    }
+    printf("[%s] 摄像头采集: %s, %s %dx%d@%d, %s\n", ctx_->stream_name.c_str(), device.c_str(), capture.formatName(),
+           capture.width(), capture.height(), capture.fps(),
+           capture.dmabufExported() ? "dma-buf 直通" : "驱动不支持导出 dma-buf，按虚拟地址访问");
+
+    StageFpsMeter meter(ctx_->stages);
+    int64_t start_us = VideoFrame::NowUs();
+    int64_t last_report_us = start_us;
+    int64_t first_pts_us = -1;
+    uint64_t count = 0;
+    while (ctx_->running)
+    {
+        V4l2Frame frame;
+        // 外部请求重连时与设备出错同样处理，重新打开失败时保持重连标记，下一轮继续退避重试
+        int ret = ctx_->need_reconnect.exchange(false) ? -1 : capture.dequeue(frame, 200);
+        if (ret < 0)
+        {
+            // 摄像头拔出或驱动出错：关闭设备，按退避时间重新打开，解码器、编码器和推理上下文都保留
+            printf("[%s] 摄像头采集出错，%d ms 后重新打开 %s\n", ctx_->stream_name.c_str(), backoff_ms_, device.c_str());
+            if (mjpeg)
+            {
+                // 重新打开后导出的 fd 编号会被复用，旧的导入必须先释放
+                ctx_->decoder->ReleaseImports();
+            }
+            capture.close();
+            requestReconnect(ctx_);
+            for (int waited = 0; waited < backoff_ms_ && ctx_->running; waited += 100)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+            backoff_ms_ = std::min(backoff_ms_ * 2, kReconnectMaxMs);
+            if (ctx_->running && capture.open(device, ctx_->v4l2))
+            {
+                ctx_->need_reconnect = false;
+                ctx_->reconnect_count++;
+                backoff_ms_ = kReconnectInitialMs;
+            }
+            continue;
+        }
+        if (ret == 0)
+        {
+            continue;
+        }
+        // 驱动时间戳是采集时刻，按第一帧对齐成从 0 开始的毫秒时间戳
+        if (first_pts_us < 0)
+        {
+            first_pts_us = frame.pts_us;
+        }
+        int64_t pts = (frame.pts_us - first_pts_us) / 1000;
+        ++count;
+        ctx_->stages.demuxed++;
+        ctx_->last_packet_us = VideoFrame::NowUs();
+        if (mjpeg)
+        {
+            // MJPEG 帧在驱动缓冲区里，优先按 dma-buf 交给MPP；导入失败时退回普通送包，由MPP拷贝
+            if (frame.fd < 0 || ctx_->decoder->DecodeDmaBuf(frame.fd, frame.length, (int)frame.size, pts) != MPP_OK)
+            {
+                ctx_->decoder->Decode((uint8_t *)frame.data, (int)frame.size, 0, pts, pts);
+            }
+        }
+        else
+        {
+            // 原始图像不需要解码，直接当作解码输出交给后续处理，RGA 从驱动缓冲区转换到 RGB
+            bool yuyv = capture.isYuyv();
+            MppDecoderFrameInfo info;
+            info.width = capture.width();
+            info.height = capture.height();
+            info.width_stride = yuyv ? capture.bytesPerLine() / 2 : capture.bytesPerLine();
+            info.height_stride = capture.height();
+            info.format = yuyv ? MPP_FMT_YUV422_YUYV : MPP_FMT_YUV420SP;
+            info.fd = frame.fd;
+            info.data = (void *)frame.data;
+            info.pts = pts;
+            info.dts = pts;
+            mpp_decoder_frame_callback(ctx_, &info);
+        }
+        // RGA 转换是同步的；MJPEG 每个包独立成帧，送包后等到输出帧才返回，此时都已读完，立即归还给驱动
+        capture.release(frame);
+        int64_t now_us = VideoFrame::NowUs();
+        if (now_us - last_report_us >= 5000000)
+        {
+            meter.report(ctx_->stream_name.c_str());
+            last_report_us = now_us;
+        }
+    }
+    if (mjpeg)
+    {
+        ctx_->decoder->ReleaseImports();
+    }
+    printf("[%s] 摄像头采集结束，共 %llu 帧\n", ctx_->stream_name.c_str(), (unsigned long long)count);
+    meter.summary(ctx_->stream_name.c_str());
+    return true;
+}
+
+void AvPullStream::updateDecoder(int video_type)
+{
+    if (ctx_->decoder != nullptr && decoder_codec_ == video_type)
+    {
+        // 重连后编码类型没变，保留解码器，省去重新初始化
+        return;
+    }
+    if (ctx_->decoder != nullptr)
+    {
+        // 重连后编码类型变了，旧解码器不能再用
+        printf("[%s] 重连后编码类型变化 %s -> %s，重建解码器\n", ctx_->stream_name.c_str(), codecName(decoder_codec_),
+               codecName(video_type));
+        delete ctx_->decoder;
+        ctx_->decoder = nullptr;
+    }
+    createDecoder(ctx_, video_type, true);
+    decoder_codec_ = video_type;
+}
+
+bool AvPullStream::start()
+{
+    std::string file_path;
+    if (isFileSourceUrl(url_, &file_path))
+    {
+        return runFileSource(file_path);
+    }
+    std::string device;
+    if (isV4l2SourceUrl(url_, &device))
+    {
+        return runV4l2Source(device);
+    }
+    if (!openPlayer())
+    {
+        return false;
+    }
+    bool decode_thread = ctx_->packet_queue != nullptr;
+    if (decode_thread)
+    {
+        // 当前线程作为本路流的解码线程
+        ThreadTopology::instance().placeCurrentThread(ThreadClass::Decode, "decode_" + ctx_->stream_name);
+    }
+    while (ctx_->running)
+    {
+        if (ctx_->need_reconnect.exchange(false))
+        {
+            reconnect();
+            continue;
+        }
+        if (ctx_->reconnect_begin_us.load() == 0)
+        {
+            // 已恢复出帧，下次断流重新从最短退避开始
+            backoff_ms_ = kReconnectInitialMs;
+        }
+        if (!decode_thread)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            continue;
+        }
+        queued_packet_t packet;
+        if (!ctx_->packet_queue->pop_for(packet, 100))
+        {
+            continue;
+        }
+        // 拉流回调先发出编码类型再挂数据回调，新会话的包出队时一定能看到它
+        int codec = ctx_->pending_codec.exchange(0);
+        if (codec != 0)
+        {
+            updateDecoder(codec);
+        }
+        if (ctx_->decoder != nullptr)
+        {
+            // 解码回调里用它作为帧的到达时间
+            ctx_->last_packet_us = packet.arrival_us;
+            ctx_->decoder->Decode((uint8_t *)mk_frame_get_data(packet.frame), mk_frame_get_data_size(packet.frame), 0,
+                                  (int64_t)mk_frame_get_pts(packet.frame), (int64_t)mk_frame_get_dts(packet.frame));
+        }
+        mk_frame_unref(packet.frame);
+    }
+    return true;
+}
 void AvPullStream::stop()
 {
 
@@ -198,6 +797,7 @@ void AvPullStream::stop()
         ctx_->running = false;
     }
 
+    std::lock_guard<std::mutex> lock(player_mutex_);
     if (player_)
     {
         log_info("Stopping player...");
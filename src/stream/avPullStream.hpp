@@ -1,6 +1,7 @@
 #ifndef _AVPULLSTREAM_HPP_
 #define _AVPULLSTREAM_HPP_
 
+#include <mutex>
 #include "mk_mediakit.h"
 #include "threadPool/safeQueue.hpp"
 #include "RtspWorker/worker.hpp"
@@ -16,10 +17,19 @@ public:
     bool start();
     void stop();
 private:
+    bool openPlayer();
+    bool runFileSource(const std::string &path); // 本地裸流文件输入：读帧、按节奏送解码，在当前线程完成
+    bool runV4l2Source(const std::string &device); // V4L2 摄像头输入：MJPEG 送硬件解码，原始图像直接进入解码后的处理
+    void reconnect(); // 释放旧播放器，按指数退避等待后重新拉流
+    void updateDecoder(int video_type); // 解码线程中按拉流回调通知的编码类型创建或重建解码器
+
     std::string url_;
     int video_type_;
     int video_fps_;
     mk_player player_;
+    std::mutex player_mutex_; // 拉流线程重连与 stop() 都会操作 player_
+    int backoff_ms_;          // 下一次重连前的等待时间
+    int decoder_codec_;       // 当前解码器的编码类型，只在解码线程中访问
     av_worker_context_t* ctx_; // 新增：指向外部ctx
 };
 
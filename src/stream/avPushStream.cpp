@@ -1,4 +1,10 @@
 #include "avPushStream.hpp"
+#include "packetRing.hpp"
+#include "detectionSei.hpp"
+#include "nalUtils.hpp"
+#include "draw/cv_draw.h"
+#include "timestampRebaser.hpp"
+#include "utils/threadAffinity.hpp"
 
 void API_CALL on_mk_media_source_regist_func(void *user_data, mk_media_source sender, int regist);
 
@@ -59,8 +65,14 @@ void API_CALL on_mk_media_source_regist_func(void *user_data, mk_media_source se
     // 只处理 rtsp schema 的媒体源
     if (strcmp(schema, "rtsp") == 0)
     {
+        ctx->output_registered = regist != 0;
         release_pusher(&(ctx->pusher));
-        if (regist)
+        if (regist && ctx->on_demand)
+        {
+            // 转推的 pusher 本身就是一个观看者，按需编码时不创建，否则编码永远不会暂停
+            printf("按需编码，不创建转推\n");
+        }
+        else if (regist)
         {
             ctx->pusher = mk_pusher_create_src(sender);
             mk_pusher_set_on_result(ctx->pusher, on_mk_push_event_func, ctx);
@@ -78,6 +90,271 @@ void API_CALL on_mk_media_source_regist_func(void *user_data, mk_media_source se
     // 对于其他 schema（fmp4, rtmp, ts 等），直接忽略，不输出警告
 }
 
+// 把一帧的检测结果序列化为SEI NAL
+static void buildFrameSei(const VideoFrame &frame, const std::vector<Detection> &objects, bool hevc, std::vector<uint8_t> &out)
+{
+    SeiFrameMeta meta;
+    meta.width = frame.width;
+    meta.height = frame.height;
+    meta.pts = frame.pts;
+    meta.boxes.reserve(objects.size());
+    for (const auto &obj : objects)
+    {
+        cv::Rect box = obj.box & cv::Rect(0, 0, frame.width, frame.height);
+        if (box.width <= 0 || box.height <= 0)
+        {
+            continue;
+        }
+        SeiBox sei_box;
+        sei_box.x = (uint16_t)box.x;
+        sei_box.y = (uint16_t)box.y;
+        sei_box.w = (uint16_t)box.width;
+        sei_box.h = (uint16_t)box.height;
+        sei_box.class_id = (uint8_t)obj.class_id;
+        sei_box.score = (uint8_t)std::min(255.0f, std::max(0.0f, obj.confidence * 255.0f + 0.5f));
+        meta.boxes.push_back(sei_box);
+    }
+    buildDetectionSei(meta, hevc, out);
+}
+
+void AvPushStream::createMedia(int codec)
+{
+    printf("当前video width:%d\n", ctx_->tracks != nullptr ? mk_track_video_width(ctx_->tracks) : ctx_->width);
+    printf("当前push url：%s, push_path_first:%s, push_path_second:%s\n", ctx_->push_url, push_path_first.c_str(), push_path_second.c_str());
+    output_codec_ = codec;
+    media = mk_media_create("__defaultVhost__", push_path_first.c_str(), push_path_second.c_str(), 0, 0, 0);
+    if (codec == ctx_->video_type && ctx_->tracks != nullptr)
+    {
+        mk_media_init_track(media, ctx_->tracks);
+    }
+    else
+    {
+        // 输出编码与输入不同或输入没有轨道信息（文件输入），按编码器参数新建视频轨道，参数集由编码器在码流中给出
+        int fps = ctx_->output_decimator.outputFps(ctx_->video_fps);
+        fps = fps > 0 ? fps : 30;
+        mk_media_init_video(media, codec == VIDEO_CODEC_H265 ? MKCodecH265 : MKCodecH264, ctx_->width, ctx_->height,
+                            (float)fps, ctx_->width * ctx_->height / 8 * fps);
+    }
+    printf("[%s] 输出编码: %s\n", push_path_second.c_str(), codecName(codec));
+    if (ctx_->recorder != nullptr)
+    {
+        ctx_->recorder->setCodec(codec);
+    }
+    mk_media_init_complete(media);
+    mk_media_set_on_regist(media, on_mk_media_source_regist_func, ctx_);
+}
+
+int AvPushStream::inputVideo(const void *data, int len, uint64_t dts, uint64_t pts)
+{
+    if (output_codec_ == VIDEO_CODEC_H265)
+    {
+        return mk_media_input_h265(media, data, len, dts, pts);
+    }
+    return mk_media_input_h264(media, data, len, dts, pts);
+}
+
+void AvPushStream::passthroughLoop()
+{
+    // 等待拉流拿到视频轨道，文件输入没有轨道，编码类型由文件读取器给出
+    while (ctx_->tracks == nullptr && !ctx_->file_source && ctx_->running)
+    {
+        printf("Waiting for video track...\n");
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    }
+    if (ctx_->tracks == nullptr && !ctx_->file_source)
+    {
+        return;
+    }
+    // 直通模式沿用输入编码
+    createMedia(ctx_->video_type);
+    ctx_->output_media.store(media, std::memory_order_release);
+    printf("[%s] 直通模式，原始码流直接转发\n", push_path_second.c_str());
+
+    while (ctx_->running)
+    {
+        detection_t result = ctx_->pool->GetImageResultFromQueue();
+        if (result.frame == nullptr || result.objects == nullptr)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+        ctx_->stages.inferred++;
+        if (ctx_->mosaic_slot != nullptr)
+        {
+            // 直通模式不重新编码，推理帧上没有画框，拼接画面中这一路不带检测框
+            ctx_->mosaic_slot->publish(result.frame);
+        }
+        if (ctx_->dual_input && ctx_->width > 0 && ctx_->height > 0)
+        {
+            // 子码流上的检测框映射到主码流分辨率；两路会话的pts不在同一时间轴，SEI中不带pts
+            result.objects = DetectionMatcher::scale(*result.objects, result.frame->width, result.frame->height,
+                                                     ctx_->width, ctx_->height);
+        }
+        if (result.objects->size() > 0 && result.objects->size() < 1000)
+        {
+            ctx_->alarm_server->sendAlarm(result.objects, ctx_->stream_name);
+            if (ctx_->recorder != nullptr)
+            {
+                ctx_->recorder->trigger();
+            }
+        }
+        if (ctx_->output_sei)
+        {
+            // 交给拉流回调插入到下一个转发的码流包之前
+            std::vector<uint8_t> sei;
+            VideoFrame sei_frame;
+            sei_frame.width = ctx_->dual_input ? ctx_->width : result.frame->width;
+            sei_frame.height = ctx_->dual_input ? ctx_->height : result.frame->height;
+            sei_frame.pts = ctx_->dual_input ? -1 : result.frame->pts;
+            buildFrameSei(sei_frame, *result.objects, ctx_->video_type == VIDEO_CODEC_H265, sei);
+            std::lock_guard<std::mutex> lock(ctx_->sei_mutex);
+            ctx_->pending_sei.swap(sei);
+        }
+        ctx_->latency_stats.add(*result.frame, VideoFrame::NowUs());
+    }
+    // 先摘掉媒体源，持锁等正在写入的拉流回调结束，之后不再写入
+    {
+        std::lock_guard<std::mutex> lock(ctx_->output_mutex);
+        ctx_->output_media.store(nullptr, std::memory_order_release);
+    }
+    printf("推流线程已退出\n");
+}
+
+struct PublishLagProbe
+{
+    std::atomic<int64_t> pending_since_us{0}; // 未执行的探测任务的投递时间，0表示没有
+    std::atomic<int64_t> last_lag_us{0};
+};
+
+// 探测任务的参数，任务执行或被丢弃时释放
+struct LagProbeTask
+{
+    std::shared_ptr<PublishLagProbe> probe;
+    int64_t sent_us;
+};
+
+static void API_CALL on_lag_probe(void *user_data)
+{
+    LagProbeTask *task = (LagProbeTask *)user_data;
+    task->probe->last_lag_us = VideoFrame::NowUs() - task->sent_us;
+    task->probe->pending_since_us = 0;
+}
+
+static void API_CALL free_lag_probe(void *user_data)
+{
+    delete (LagProbeTask *)user_data;
+}
+
+int64_t AvPushStream::publishLagMs()
+{
+    if (media == nullptr)
+    {
+        return 0;
+    }
+    if (lag_probe_ == nullptr)
+    {
+        lag_probe_ = std::make_shared<PublishLagProbe>();
+    }
+    int64_t now = VideoFrame::NowUs();
+    int64_t pending = lag_probe_->pending_since_us;
+    if (pending == 0)
+    {
+        // 上一次探测已经返回，投递下一次；输出线程堵住时不重复投递
+        lag_probe_->pending_since_us = now;
+        mk_async_do2(mk_media_get_owner_thread(media), on_lag_probe, new LagProbeTask{lag_probe_, now}, free_lag_probe);
+        return lag_probe_->last_lag_us / 1000;
+    }
+    // 还没执行的探测任务已等待的时间也是延迟的下限
+    return std::max<int64_t>(lag_probe_->last_lag_us, now - pending) / 1000;
+}
+
+bool AvPushStream::encodeSuspended()
+{
+    // 报警录像需要连续的编码输出，开启录像时不暂停；媒体源注册之前要先送帧让它注册
+    if (!ctx_->on_demand || ctx_->recorder != nullptr || !ctx_->output_registered)
+    {
+        return false;
+    }
+    int64_t now = VideoFrame::NowUs();
+    if (now - last_reader_check_us_ >= 200000)
+    {
+        reader_count_ = mk_media_total_reader_count(media);
+        last_reader_check_us_ = now;
+    }
+    if (reader_count_ <= 0)
+    {
+        if (!encode_suspended_)
+        {
+            encode_suspended_ = true;
+            suspend_begin_us_ = now;
+            printf("[%s] 无人观看，暂停编码\n", push_path_second.c_str());
+        }
+        return true;
+    }
+    if (encode_suspended_)
+    {
+        // 新观看者不用等到下一个 GOP，恢复后的第一帧就是 IDR
+        encode_suspended_ = false;
+        suspended_us_ += now - suspend_begin_us_;
+        ctx_->encoder->RequestIdr();
+        printf("[%s] %d 个观看者，恢复编码\n", push_path_second.c_str(), reader_count_);
+    }
+    return false;
+}
+
+detection_t AvPushStream::nextDisplayFrame(DetectionMatcher &matcher, VideoFramePtr &pending)
+{
+    // 收集子码流的推理结果，报警按推理结果逐个发送
+    for (;;)
+    {
+        detection_t result = ctx_->pool->GetImageResultFromQueue();
+        if (result.frame == nullptr)
+        {
+            break;
+        }
+        if (result.objects == nullptr)
+        {
+            continue;
+        }
+        ctx_->stages.inferred++;
+        if (result.objects->size() > 0 && result.objects->size() < 1000)
+        {
+            ctx_->alarm_server->sendAlarm(DetectionMatcher::scale(*result.objects, result.frame->width, result.frame->height,
+                                                                  ctx_->width, ctx_->height),
+                                          ctx_->stream_name);
+            if (ctx_->recorder != nullptr)
+            {
+                ctx_->recorder->trigger();
+            }
+        }
+        matcher.add(*result.frame, result.objects);
+    }
+
+    if (pending == nullptr)
+    {
+        if (ctx_->display_queue->empty())
+        {
+            return detection_t{};
+        }
+        ctx_->display_queue->pop(pending);
+    }
+    // 子码流推理有延迟，主码流帧稍等与之同时刻的检测结果，最多等 200ms
+    if (matcher.latestCaptureUs() < pending->capture_us && VideoFrame::NowUs() - pending->decode_us < 200000)
+    {
+        return detection_t{};
+    }
+    detection_t out;
+    out.frame = pending;
+    pending.reset();
+    // 主码流帧不经过推理，等待匹配的时间计入排队
+    out.frame->infer_begin_us = out.frame->infer_end_us = VideoFrame::NowUs();
+    const DetectionMatcher::Entry *entry = matcher.match(out.frame->capture_us);
+    out.objects = entry != nullptr
+                      ? DetectionMatcher::scale(*entry->objects, entry->width, entry->height, out.frame->width, out.frame->height)
+                      : std::make_shared<std::vector<Detection>>();
+    return out;
+}
+
 void AvPushStream::pushSteamThread()
 {
     void *mpp_frame = NULL;
@@ -85,6 +362,14 @@ void AvPushStream::pushSteamThread()
     void *mpp_frame_addr = NULL;
     int enc_data_size;
     int frame_index = 0;
+    uint64_t last_seq = 0;
+
+    ThreadTopology::instance().placeCurrentThread(ThreadClass::Encode, "push_" + push_path_second);
+    if (ctx_->passthrough)
+    {
+        passthroughLoop();
+        return;
+    }
 
     // 等待编码器初始化完成,encoder已经在解码回调中初始化
     while (ctx_->encoder == NULL && ctx_->running && ctx_->tracks == nullptr)
@@ -101,42 +386,167 @@ void AvPushStream::pushSteamThread()
 
     printf("Encoder initialized, starting encoding loop\n");
 
-    printf("当前video width:%d\n", mk_track_video_width(ctx_->tracks));
-    printf("当前push url：%s, push_path_first:%s, push_path_second:%s\n", ctx_->push_url, push_path_first.c_str(), push_path_second.c_str());
-    media = mk_media_create("__defaultVhost__", push_path_first.c_str(), push_path_second.c_str(), 0, 0, 0);
-    mk_media_init_track(media, ctx_->tracks);
-    mk_media_init_complete(media);
-    mk_media_set_on_regist(media, on_mk_media_source_regist_func, ctx_);
+    createMedia(ctx_->output_codec);
+
+    // 编码输出优先零拷贝（直接使用编码器的 pkt_buf），开启切片输出时拷贝到预分配的包缓冲环
+    bool zero_copy = ctx_->encoder->SupportZeroCopy();
+    PacketRing packet_ring(4, ctx_->encoder->GetFrameSize() / 8);
+    // 输出时间戳沿用源端pts，平移到从0开始的输出时间轴；默认帧间隔按抽帧后的输出帧率
+    int output_fps = ctx_->output_decimator.outputFps(ctx_->video_fps);
+    TimestampRebaser rebaser(5000, output_fps > 0 ? 1000 / output_fps : 40);
+    std::vector<uint8_t> sei;
+    DetectionMatcher matcher;
+    VideoFramePtr pending_display;
+    // 背景区域也占一个硬件 ROI
+    RoiParams roi_params = ctx_->roi;
+    int roi_limit = MPP_ENCODER_MAX_ROI - (roi_params.bg_qp_delta != 0 ? 1 : 0);
+    roi_params.max_regions = std::min(roi_params.max_regions, roi_limit);
+    RoiSmoother roi_smoother(roi_params);
+    std::vector<MppEncoderRoi> roi_regions;
+    // 降帧以抽帧后送进编码器的帧率为基准，帧率未知时取编码器的默认值
+    int source_fps = output_fps > 0 ? output_fps : ctx_->encoder->GetFps();
+    std::unique_ptr<RateController> rate_ctrl;
+    if (ctx_->rate.adaptive)
+    {
+        rate_ctrl.reset(new RateController(ctx_->rate, ctx_->encoder->GetBps(), source_fps));
+    }
+    double fps_credit = 0; // 降帧时按 目标帧率/源帧率 累加，满 1 编码一帧，跳帧间隔均匀
+    printf("编码输出模式: %s\n", zero_copy ? "零拷贝" : "包缓冲环");
+    if (roi_params.enable)
+    {
+        printf("编码ROI: 最多 %d 个目标区域, 目标QP %+d, 背景QP %+d\n", roi_params.max_regions, roi_params.qp_delta,
+               roi_params.bg_qp_delta);
+    }
     while (ctx_->running)
     {
         int ret = 0;
-        detection_t result = ctx_->pool->GetImageResultFromQueue();
+        detection_t result = ctx_->display_queue != nullptr ? nextDisplayFrame(matcher, pending_display)
+                                                            : ctx_->pool->GetImageResultFromQueue();
 
-        if (result.src == nullptr || result.src->data == nullptr) // 检查结果图像是否有效
+        if (result.frame == nullptr || !result.frame->valid()) // 检查结果图像是否有效
         {
-            // printf("result.src is nullptr or data is nullptr!\n");
+            // printf("result.frame is nullptr or data is nullptr!\n");
             std::this_thread::sleep_for(std::chrono::milliseconds(10));
             continue;
         }
+        if (ctx_->display_queue == nullptr && result.inferred)
+        {
+            ctx_->stages.inferred++; // 双码流时在收集子码流推理结果时计数
+        }
+        const VideoFrame &frame = *result.frame;
+        // 多个推理上下文并行时结果可能乱序，晚到的旧帧直接丢弃，保证推流时间戳单调
+        if (frame.seq <= last_seq)
+        {
+            ctx_->latency_stats.addReordered();
+            continue;
+        }
+        last_seq = frame.seq;
+        // 检查检测结果是否有效，双码流的报警在收集推理结果时已发送；沿用上次结果的帧不重复报警
+        if (ctx_->display_queue == nullptr && result.inferred && result.objects->size() > 0 && result.objects->size() < 1000)
+        {
+            ctx_->alarm_server->sendAlarm(result.objects, ctx_->stream_name);
+            if (ctx_->recorder != nullptr)
+            {
+                ctx_->recorder->trigger();
+            }
+        }
+        // 双码流时子码流的检测结果已映射到主码流分辨率，由这里画到主码流帧上
+        bool draw_here = ctx_->display_queue != nullptr && !ctx_->output_sei && !result.objects->empty();
+        if (ctx_->mosaic_slot != nullptr)
+        {
+            // 拼接画面不受本路暂停编码和降帧的影响，先画好框再交出去
+            if (draw_here)
+            {
+                DrawDetections(*frame.mat, *result.objects);
+                draw_here = false;
+            }
+            ctx_->mosaic_slot->publish(result.frame);
+        }
+        if (encodeSuspended())
+        {
+            // 推理和报警已完成，画面没人看，不做 RGB->NV12 转换和编码
+            continue;
+        }
+        if (rate_ctrl != nullptr)
+        {
+            int backlog = ctx_->display_queue != nullptr ? (int)ctx_->display_queue->size() : ctx_->pool->GetResultQueueSize();
+            RateController::Decision decision;
+            if (rate_ctrl->evaluate(VideoFrame::NowUs(), publishLagMs(), backlog, decision))
+            {
+                ctx_->encoder->SetRateControl(decision.bps, decision.fps, decision.gop);
+                ctx_->rc_bps = decision.bps;
+                ctx_->rc_fps = decision.fps;
+                ctx_->rc_gop = decision.gop;
+                ctx_->rc_adjustments = rate_ctrl->adjustments();
+                printf("[%s] 码率控制调整: %d kbps, %d fps, GOP %d\n", push_path_second.c_str(), decision.bps / 1000,
+                       decision.fps, decision.gop);
+            }
+            if (rate_ctrl->fps() < source_fps)
+            {
+                fps_credit += (double)rate_ctrl->fps() / source_fps;
+                if (fps_credit < 1.0)
+                {
+                    continue;
+                }
+                fps_credit -= 1.0;
+            }
+        }
+        if (draw_here)
+        {
+            DrawDetections(*frame.mat, *result.objects);
+        }
         // printf("queue size: %d\n", ctx_->pool->GetResultQueueSize());
         // printf("Pool task size: %d\n", ctx_->pool->GetTasksSize());
-        rga_buffer_t result_img = wrapbuffer_virtualaddr((void *)result.src->data, result.src->cols, result.src->rows, RK_FORMAT_RGB_888);
-        if (result_img.vir_addr == nullptr) // 检查结果图像是否有效
+        rga_buffer_t result_img;
+        if (frame.fd_is_dmabuf)
+        {
+            // 画框是CPU写入的，交给RGA读之前结束CPU访问窗口，刷cache
+            if (frame.cpu_access != nullptr)
+            {
+                frame.cpu_access->end();
+            }
+            result_img = wrapbuffer_fd(frame.fd, frame.width, frame.height, RK_FORMAT_RGB_888,
+                                       frame.width_stride, frame.height_stride);
+        }
+        else
+        {
+            result_img = wrapbuffer_virtualaddr((void *)frame.mat->data, frame.width, frame.height, RK_FORMAT_RGB_888,
+                                                frame.width_stride, frame.height_stride);
+        }
+        if (result_img.vir_addr == nullptr && result_img.fd < 0) // 检查结果图像是否有效
         {
             // printf("result_img is nullptr!\n");
             continue;
         }
-        if (result.objects->size() > 0 && result.objects->size() < 1000) // 检查检测结果是否有效
+
+        if (ctx_->fast_join && ctx_->viewer_join_us.load() > 0)
         {
-            ctx_->alarm_server->sendAlarm(result.objects, ctx_->stream_name);
+            // 有新观看者在等关键帧，这一帧直接编成 IDR；多人同时进入时每秒最多请求一次
+            int64_t now = VideoFrame::NowUs();
+            if (now - last_join_idr_us_ >= 1000000)
+            {
+                ctx_->encoder->RequestIdr();
+                last_join_idr_us_ = now;
+            }
+        }
+
+        if (frame.width != ctx_->encoder->GetWidth() || frame.height != ctx_->encoder->GetHeight())
+        {
+            // 分辨率变化：帧按序号单调输出，旧尺寸的帧都已编码完，编码器是同步的，没有在途的帧，可以直接重配
+            printf("[%s] 输出分辨率变化 %dx%d -> %dx%d，重配编码器\n", push_path_second.c_str(), ctx_->encoder->GetWidth(),
+                   ctx_->encoder->GetHeight(), frame.width, frame.height);
+            if (ctx_->encoder->Reconfigure(frame.width, frame.height, 0, 0) != 0)
+            {
+                continue;
+            }
+            mpp_frame = NULL;
+            // 新尺寸的编码输出可能更大，包缓冲环按新的帧大小扩容；旧的检测框平滑状态作废
+            packet_ring.reserve(ctx_->encoder->GetFrameSize() / 8);
+            roi_smoother = RoiSmoother(roi_params);
         }
 
         // printf("result_img vir_addr:%p\n", result_img.vir_addr);
         // 编码
-        int enc_buf_size = ctx_->encoder->GetFrameSize();
-        // 使用posix_memalign分配对齐内存，不要使用malloc
-        char *enc_data = (char *)malloc(enc_buf_size);
-
         // 获取解码后的帧
         mpp_frame = ctx_->encoder->GetInputFrameBuffer();
         // 获取解码后的帧fd
@@ -144,41 +554,101 @@ void AvPushStream::pushSteamThread()
         // 获取解码后的帧地址
         mpp_frame_addr = ctx_->encoder->GetInputFrameBufferAddr(mpp_frame);
         // 这个是写入解码器的对象和颜色转换没有关系
-        rga_buffer_t src = wrapbuffer_fd(mpp_frame_fd, ctx_->width, ctx_->height, RK_FORMAT_YCbCr_420_SP, ctx_->width_stride, ctx_->height_stride);
+        // 按编码器当前的尺寸包装，ctx 中的宽高由解码线程随时更新，不能在这里用
+        rga_buffer_t src = wrapbuffer_fd(mpp_frame_fd, ctx_->encoder->GetWidth(), ctx_->encoder->GetHeight(), RK_FORMAT_YCbCr_420_SP,
+                                         ctx_->encoder->GetHorStride(), ctx_->encoder->GetVerStride());
         frame_index++;
-        // 结束计时
-        auto now = std::chrono::steady_clock::now();
-        auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+        // 使用源端pts作为推流时间戳，不受推理耗时抖动影响；源端没有pts时退回码流到达时间
+        int64_t millis = rebaser.rebase(frame.pts, frame.capture_us / 1000);
         imcopy(result_img, src);
+        if (roi_params.enable)
+        {
+            // 检测框坐标在结果帧上，与编码分辨率一致
+            const std::vector<cv::Rect> &rects = roi_smoother.update(*result.objects, frame.width, frame.height);
+            roi_regions.clear();
+            for (const auto &rect : rects)
+            {
+                roi_regions.push_back({rect.x, rect.y, rect.width, rect.height, roi_params.qp_delta});
+            }
+            ctx_->encoder->SetRoi(roi_regions.data(), (int)roi_regions.size(), roi_params.bg_qp_delta);
+        }
         if (frame_index == 1)
         {
-            enc_data_size = ctx_->encoder->GetHeader(enc_data, enc_buf_size);
+            // SPS/PPS 单独送入，先于第一帧
+            size_t hdr_cap = 0;
+            char *hdr = packet_ring.acquire(hdr_cap);
+            int hdr_size = ctx_->encoder->GetHeader(hdr, hdr_cap);
+            if (hdr_size > 0)
+            {
+                inputVideo(hdr, hdr_size, millis, millis);
+            }
+        }
+        const char *enc_data = nullptr;
+        if (zero_copy)
+        {
+            enc_data_size = ctx_->encoder->Encode(mpp_frame, &enc_data);
+        }
+        else
+        {
+            size_t enc_cap = 0;
+            char *slot = packet_ring.acquire(enc_cap);
+            enc_data_size = ctx_->encoder->Encode(mpp_frame, slot, enc_cap);
+            enc_data = slot;
+            if (enc_data_size < 0)
+            {
+                // 槽位不够，按实际需要的长度扩容，下一帧生效；这一帧被丢弃，后续帧的参考链断了，
+                // 请求一个 IDR 让解码端尽快恢复
+                packet_ring.reserve(ctx_->encoder->GetLastPacketSize());
+                ctx_->encoder->RequestIdr();
+            }
         }
-        enc_data_size = ctx_->encoder->Encode(mpp_frame, enc_data, enc_buf_size);
         // 推流
         //  printf("enc_data_size:%d\n", enc_data_size);
         if (enc_data_size <= 0)
         {
             printf("encode frame failed, enc_data_size:%d\n", enc_data_size);
-            if (enc_data != nullptr)
-            {
-                free(enc_data);
-                enc_data = nullptr;
-            }
             continue;
         }
-        ret = mk_media_input_h264(media, enc_data, enc_data_size, millis, millis);
+        packet_ring.record(enc_data_size);
+        if (ctx_->output_sei)
+        {
+            // SEI与编码帧使用相同时间戳，合并到同一个访问单元
+            buildFrameSei(frame, *result.objects, output_codec_ == VIDEO_CODEC_H265, sei);
+            inputVideo(sei.data(), (int)sei.size(), millis, millis);
+        }
+        // mk_media_input_h264/h265 在返回前完成分包/拷贝，之后 pkt_buf 可以被下一帧覆盖
+        ret = inputVideo(enc_data, enc_data_size, millis, millis);
         if (ret != 1)
         {
             printf("mk_media_input_frame failed\n");
         }
-        // 确保内存被正确释放
-        if (enc_data != nullptr)
+        else
         {
-            free(enc_data);
-            enc_data = nullptr;
+            ctx_->stages.output++;
+            if (rate_ctrl != nullptr)
+            {
+                rate_ctrl->addFrame(enc_data_size, ctx_->encoder->LastPacketIsIntra());
+            }
+            recordViewerFirstFrame(ctx_, ctx_->encoder->LastPacketIsIntra());
+            if (ctx_->recorder != nullptr)
+            {
+                // 录像缓存直接用编码输出，不重新编码
+                ctx_->recorder->addPacket((const uint8_t *)enc_data, enc_data_size, millis, millis,
+                                          ctx_->encoder->LastPacketIsIntra());
+            }
+        }
+        ctx_->latency_stats.add(frame, VideoFrame::NowUs());
+    }
+    packet_ring.printStats(push_path_second.c_str());
+    if (ctx_->on_demand)
+    {
+        if (encode_suspended_)
+        {
+            suspended_us_ += VideoFrame::NowUs() - suspend_begin_us_;
         }
+        printf("[%s] 无人观看暂停编码共 %.1fs\n", push_path_second.c_str(), suspended_us_ / 1e6);
     }
+    printf("[%s] 输出时间轴重建 %llu 次\n", push_path_second.c_str(), (unsigned long long)rebaser.discontinuities());
 
     // 清理工作
     if (mpp_frame != NULL)
@@ -198,6 +668,14 @@ AvPushStream::~AvPushStream()
     }
     if (media)
     {
+        {
+            // 推流线程没有走到摘除（提前退出）时在这里摘除，保证释放时没有拉流回调在用
+            std::lock_guard<std::mutex> lock(ctx_->output_mutex);
+            if (ctx_->output_media.load(std::memory_order_acquire) == media)
+            {
+                ctx_->output_media.store(nullptr, std::memory_order_release);
+            }
+        }
         mk_media_release(media);
         media = nullptr;
     }
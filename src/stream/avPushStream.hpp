@@ -4,8 +4,10 @@
 #include "mk_mediakit.h"
 #include "threadPool/safeQueue.hpp"
 #include "RtspWorker/worker.hpp"
+#include "detectionMatcher.hpp"
 #include <opencv2/opencv.hpp>
 
+struct PublishLagProbe;
 
 class AvPushStream
 {
@@ -16,10 +18,29 @@ public:
     // void inferenceThread();
 
 private:
+    void createMedia(int codec);
+    // 按输出编码类型送入一帧（或单个NAL）
+    int inputVideo(const void *data, int len, uint64_t dts, uint64_t pts);
+    void passthroughLoop(); // 直通模式：只处理推理结果（报警），码流由拉流回调直接转发
+    // 双码流叠加模式：取一帧主码流画面并附上时间匹配的子码流检测结果，没有可输出的帧时返回空
+    detection_t nextDisplayFrame(DetectionMatcher &matcher, VideoFramePtr &pending);
+    // 按需编码：没有观看者时返回 true，跳过颜色转换和编码；有观看者重新出现时请求 IDR
+    bool encodeSuspended();
+    // 输出媒体源所属的 ZLMediaKit 线程处理任务的排队延迟(ms)，每秒投递一次探测任务
+    int64_t publishLagMs();
+
     av_worker_context_t *ctx_; // 指向外部ctx
     std::string push_path_first;
     std::string push_path_second;
-    mk_media media;
+    mk_media media = nullptr;
+    int output_codec_ = 264;
+    bool encode_suspended_ = false;
+    int64_t last_reader_check_us_ = 0;
+    int reader_count_ = 0;
+    int64_t suspend_begin_us_ = 0;
+    int64_t suspended_us_ = 0; // 累计暂停编码时长
+    int64_t last_join_idr_us_ = 0; // 上次因新观看者请求 IDR 的时间，限制请求频率
+    std::shared_ptr<PublishLagProbe> lag_probe_; // 探测任务可能晚于推流对象执行，共享所有权
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,388 @@
+#include "clipRecorder.hpp"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <filesystem>
+#include "nalUtils.hpp"
+#include "utils/threadAffinity.hpp"
+
+// 环形缓冲的内存上限，GOP 很长时按它淘汰
+static const size_t kMaxRingBytes = 64 * 1024 * 1024;
+// 写线程攒满这么多再写一次盘
+static const size_t kWriteChunkBytes = 1024 * 1024;
+
+static const uint16_t kPmtPid = 0x1000;
+static const uint16_t kVideoPid = 0x100;
+static const int kTsPacketSize = 188;
+
+static uint32_t crc32Mpeg(const uint8_t *data, size_t len)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < len; ++i)
+    {
+        crc ^= (uint32_t)data[i] << 24;
+        for (int k = 0; k < 8; ++k)
+        {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+// 最小 MPEG-TS 封装：单节目单视频流，关键帧前重复 PAT/PMT，每帧一个 PES 并带 PCR
+class TsMuxer {
+public:
+    TsMuxer(int codec, std::vector<uint8_t> &out) : codec_(codec), out_(out) {}
+
+    void writeFrame(const uint8_t *data, size_t size, int64_t dts_ms, int64_t pts_ms, bool key)
+    {
+        if (key || first_)
+        {
+            writeTables();
+            first_ = false;
+        }
+        // 时间戳统一换算到 90kHz，加 1 秒偏移让 PCR 始终小于 DTS
+        uint64_t dts = (uint64_t)(dts_ms * 90 + 90000) & 0x1FFFFFFFFULL;
+        uint64_t pts = (uint64_t)(pts_ms * 90 + 90000) & 0x1FFFFFFFFULL;
+        uint8_t pes[19] = {0, 0, 1, 0xE0, 0, 0, 0x80, 0xC0, 10};
+        writeTimestamp(pes + 9, 0x3, pts);
+        writeTimestamp(pes + 14, 0x1, dts);
+
+        size_t total = sizeof(pes) + size;
+        size_t pos = 0;
+        bool start = true;
+        while (pos < total)
+        {
+            uint8_t pkt[kTsPacketSize];
+            pkt[0] = 0x47;
+            pkt[1] = (start ? 0x40 : 0x00) | (kVideoPid >> 8);
+            pkt[2] = kVideoPid & 0xFF;
+            size_t af = start ? 8 : 0; // 长度 + 标志 + PCR
+            size_t remaining = total - pos;
+            if (remaining < (size_t)(kTsPacketSize - 4) - af)
+            {
+                af = kTsPacketSize - 4 - remaining; // 最后一个包用调整字段填充
+            }
+            pkt[3] = (af > 0 ? 0x30 : 0x10) | (video_cc_++ & 0x0F);
+            uint8_t *p = pkt + 4;
+            if (af > 0)
+            {
+                p[0] = (uint8_t)(af - 1);
+                if (af > 1)
+                {
+                    p[1] = 0x00;
+                    size_t used = 2;
+                    if (start)
+                    {
+                        p[1] = 0x10 | (key ? 0x40 : 0x00); // PCR + 随机访问点
+                        uint64_t pcr = dts >= 9000 ? dts - 9000 : 0;
+                        p[2] = (uint8_t)(pcr >> 25);
+                        p[3] = (uint8_t)(pcr >> 17);
+                        p[4] = (uint8_t)(pcr >> 9);
+                        p[5] = (uint8_t)(pcr >> 1);
+                        p[6] = (uint8_t)(((pcr & 1) << 7) | 0x7E);
+                        p[7] = 0x00;
+                        used = 8;
+                    }
+                    memset(p + used, 0xFF, af - used);
+                }
+                p += af;
+            }
+            size_t payload = kTsPacketSize - (p - pkt);
+            for (size_t i = 0; i < payload; ++i, ++pos)
+            {
+                p[i] = pos < sizeof(pes) ? pes[pos] : data[pos - sizeof(pes)];
+            }
+            out_.insert(out_.end(), pkt, pkt + kTsPacketSize);
+            start = false;
+        }
+    }
+
+private:
+    static void writeTimestamp(uint8_t *p, uint8_t prefix, uint64_t ts)
+    {
+        p[0] = (uint8_t)((prefix << 4) | (((ts >> 30) & 0x07) << 1) | 1);
+        p[1] = (uint8_t)(ts >> 22);
+        p[2] = (uint8_t)((((ts >> 15) & 0x7F) << 1) | 1);
+        p[3] = (uint8_t)(ts >> 7);
+        p[4] = (uint8_t)(((ts & 0x7F) << 1) | 1);
+    }
+
+    void writeSection(uint16_t pid, uint8_t &cc, uint8_t *section, size_t len)
+    {
+        uint32_t crc = crc32Mpeg(section, len - 4);
+        section[len - 4] = (uint8_t)(crc >> 24);
+        section[len - 3] = (uint8_t)(crc >> 16);
+        section[len - 2] = (uint8_t)(crc >> 8);
+        section[len - 1] = (uint8_t)crc;
+        uint8_t pkt[kTsPacketSize];
+        memset(pkt, 0xFF, sizeof(pkt));
+        pkt[0] = 0x47;
+        pkt[1] = 0x40 | (pid >> 8);
+        pkt[2] = pid & 0xFF;
+        pkt[3] = 0x10 | (cc++ & 0x0F);
+        pkt[4] = 0x00; // pointer_field
+        memcpy(pkt + 5, section, len);
+        out_.insert(out_.end(), pkt, pkt + kTsPacketSize);
+    }
+
+    void writeTables()
+    {
+        uint8_t pat[] = {0x00, 0xB0, 0x0D, 0x00, 0x01, 0xC1, 0x00, 0x00,
+                         0x00, 0x01, (uint8_t)(0xE0 | (kPmtPid >> 8)), (uint8_t)(kPmtPid & 0xFF), 0, 0, 0, 0};
+        writeSection(0, pat_cc_, pat, sizeof(pat));
+        uint8_t stream_type = codec_ == VIDEO_CODEC_H265 ? 0x24 : 0x1B;
+        uint8_t pmt[] = {0x02, 0xB0, 0x12, 0x00, 0x01, 0xC1, 0x00, 0x00,
+                         (uint8_t)(0xE0 | (kVideoPid >> 8)), (uint8_t)(kVideoPid & 0xFF), 0xF0, 0x00,
+                         stream_type, (uint8_t)(0xE0 | (kVideoPid >> 8)), (uint8_t)(kVideoPid & 0xFF), 0xF0, 0x00,
+                         0, 0, 0, 0};
+        writeSection(kPmtPid, pmt_cc_, pmt, sizeof(pmt));
+    }
+
+    int codec_;
+    std::vector<uint8_t> &out_;
+    bool first_ = true;
+    uint8_t pat_cc_ = 0;
+    uint8_t pmt_cc_ = 0;
+    uint8_t video_cc_ = 0;
+};
+
+ClipRecorder::ClipRecorder(const std::string &dir, const std::string &stream_id, int pre_sec, int post_sec, int max_sec)
+    : dir_(dir), stream_id_(stream_id), pre_ms_((int64_t)pre_sec * 1000), post_ms_((int64_t)post_sec * 1000),
+      max_ms_((int64_t)(max_sec > 0 ? max_sec : 60) * 1000)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(dir_, ec);
+    if (ec)
+    {
+        printf("[%s] 无法创建录像目录 %s: %s\n", stream_id_.c_str(), dir_.c_str(), ec.message().c_str());
+    }
+    writer_ = std::thread(&ClipRecorder::writerLoop, this);
+}
+
+ClipRecorder::~ClipRecorder()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (active_ && !active_->packets.empty())
+        {
+            finishClip();
+        }
+        stop_ = true;
+    }
+    cv_.notify_all();
+    if (writer_.joinable())
+    {
+        writer_.join();
+    }
+    printf("[%s] 报警录像共写入 %llu 个片段\n", stream_id_.c_str(), (unsigned long long)clips_written_.load());
+}
+
+void ClipRecorder::setCodec(int codec)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (codec_ != codec)
+    {
+        // 编码类型变了，缓冲里的旧码流不能和新码流写进同一个文件
+        ring_.clear();
+        ring_bytes_ = 0;
+        codec_ = codec;
+    }
+}
+
+void ClipRecorder::addPacket(const uint8_t *data, size_t size, int64_t dts_ms, int64_t pts_ms, bool key, bool config)
+{
+    if (data == nullptr || size == 0)
+    {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (config)
+    {
+        pending_config_.insert(pending_config_.end(), data, data + size);
+        return;
+    }
+    if (ring_.empty() && !key && !(active_ && !active_->wait_key))
+    {
+        pending_config_.clear();
+        return; // 缓冲区从关键帧开始
+    }
+    Packet packet;
+    packet.data = std::make_shared<std::vector<uint8_t>>();
+    packet.data->reserve(pending_config_.size() + size);
+    packet.data->insert(packet.data->end(), pending_config_.begin(), pending_config_.end());
+    packet.data->insert(packet.data->end(), data, data + size);
+    packet.dts_ms = dts_ms;
+    packet.pts_ms = pts_ms;
+    packet.key = key;
+    pending_config_.clear();
+    last_pts_ms_ = pts_ms;
+
+    if (!ring_.empty() || key)
+    {
+        ring_.push_back(packet);
+        ring_bytes_ += packet.data->size();
+        trimRing();
+    }
+
+    if (active_)
+    {
+        if (active_->wait_key && key)
+        {
+            active_->wait_key = false;
+            active_->begin_ms = pts_ms;
+        }
+        if (!active_->wait_key)
+        {
+            active_->packets.push_back(packet);
+        }
+        if (pts_ms >= active_->end_ms || pts_ms - active_->begin_ms >= max_ms_)
+        {
+            finishClip();
+        }
+    }
+}
+
+void ClipRecorder::trimRing()
+{
+    // 整段淘汰最旧的 GOP：去掉它之后剩余部分仍覆盖 pre_ms，或者超出内存上限
+    while (ring_.size() > 1)
+    {
+        size_t next_key = 1;
+        while (next_key < ring_.size() && !ring_[next_key].key)
+        {
+            ++next_key;
+        }
+        bool over_budget = ring_bytes_ > kMaxRingBytes;
+        if (next_key >= ring_.size())
+        {
+            if (over_budget)
+            {
+                // 只有一个超长 GOP，整体丢弃，从下一个关键帧重新开始
+                ring_.clear();
+                ring_bytes_ = 0;
+            }
+            return;
+        }
+        if (!over_budget && last_pts_ms_ - ring_[next_key].pts_ms < pre_ms_)
+        {
+            return;
+        }
+        for (size_t i = 0; i < next_key; ++i)
+        {
+            ring_bytes_ -= ring_.front().data->size();
+            ring_.pop_front();
+        }
+    }
+}
+
+void ClipRecorder::trigger()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (codec_ == 0)
+    {
+        return;
+    }
+    if (active_)
+    {
+        // 持续报警：延长片段，最长 max_ms
+        active_->end_ms = std::min(last_pts_ms_ + post_ms_, active_->begin_ms + max_ms_);
+        return;
+    }
+    std::unique_ptr<Clip> clip(new Clip());
+    clip->codec = codec_;
+    clip->end_ms = last_pts_ms_ + post_ms_;
+    // 事前部分从上一个片段之后的第一个关键帧开始，不与上一个片段重叠
+    size_t begin = 0;
+    while (begin < ring_.size() && !(ring_[begin].key && ring_[begin].pts_ms > last_clip_end_ms_))
+    {
+        ++begin;
+    }
+    clip->wait_key = begin >= ring_.size();
+    clip->begin_ms = clip->wait_key ? last_pts_ms_ : ring_[begin].pts_ms;
+    for (size_t i = begin; i < ring_.size(); ++i)
+    {
+        clip->packets.push_back(ring_[i]);
+    }
+
+    char name[64];
+    time_t now = time(nullptr);
+    struct tm tm_now;
+    localtime_r(&now, &tm_now);
+    strftime(name, sizeof(name), "%Y%m%d_%H%M%S", &tm_now);
+    // 同一秒内可能有多个片段，文件名带序号
+    clip->path = dir_ + "/" + stream_id_ + "_" + name + "_" + std::to_string(++clip_seq_) + ".ts";
+    printf("[%s] 报警录像开始: %s，事前 %.1fs\n", stream_id_.c_str(), clip->path.c_str(),
+           clip->wait_key ? 0.0 : (last_pts_ms_ - clip->begin_ms) / 1000.0);
+    active_ = std::move(clip);
+}
+
+void ClipRecorder::finishClip()
+{
+    if (!active_->packets.empty())
+    {
+        last_clip_end_ms_ = active_->packets.back().pts_ms;
+        jobs_.push_back(std::move(active_));
+        cv_.notify_one();
+    }
+    active_.reset();
+}
+
+void ClipRecorder::writerLoop()
+{
+    ThreadTopology::instance().placeCurrentThread(ThreadClass::Msg, "clip_" + stream_id_);
+    for (;;)
+    {
+        std::unique_ptr<Clip> clip;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+            if (jobs_.empty())
+            {
+                return;
+            }
+            clip = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+        if (writeClip(*clip))
+        {
+            clips_written_++;
+        }
+    }
+}
+
+bool ClipRecorder::writeClip(const Clip &clip)
+{
+    FILE *fp = fopen(clip.path.c_str(), "wb");
+    if (fp == nullptr)
+    {
+        printf("[%s] 无法创建录像文件 %s\n", stream_id_.c_str(), clip.path.c_str());
+        return false;
+    }
+    std::vector<uint8_t> buf;
+    buf.reserve(kWriteChunkBytes + 64 * 1024);
+    TsMuxer muxer(clip.codec, buf);
+    size_t total = 0;
+    bool ok = true;
+    for (const auto &packet : clip.packets)
+    {
+        muxer.writeFrame(packet.data->data(), packet.data->size(), packet.dts_ms, packet.pts_ms, packet.key);
+        if (buf.size() >= kWriteChunkBytes)
+        {
+            ok = ok && fwrite(buf.data(), 1, buf.size(), fp) == buf.size();
+            total += buf.size();
+            buf.clear();
+        }
+    }
+    if (!buf.empty())
+    {
+        ok = ok && fwrite(buf.data(), 1, buf.size(), fp) == buf.size();
+        total += buf.size();
+    }
+    fclose(fp);
+    int64_t duration_ms = clip.packets.empty() ? 0 : clip.packets.back().pts_ms - clip.packets.front().pts_ms;
+    printf("[%s] 报警录像写入%s: %s, %zu 帧, %.1fs, %.1f MB\n", stream_id_.c_str(), ok ? "完成" : "失败",
+           clip.path.c_str(), clip.packets.size(), duration_ms / 1000.0, total / 1048576.0);
+    return ok;
+}
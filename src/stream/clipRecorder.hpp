@@ -0,0 +1,85 @@
+#ifndef CLIP_RECORDER_HPP
+#define CLIP_RECORDER_HPP
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief 报警录像：缓存最近若干秒已编码的码流，报警时把事前+事后的码流写成 TS 文件
+ *
+ * 推流路径把送入输出媒体源的每一帧交给 addPacket()，环形缓冲按 GOP 整段淘汰，
+ * 保证缓冲区总是从关键帧开始且至少覆盖 pre_sec 秒。trigger() 开始一个片段，
+ * 持续报警会延长片段，最长 max_sec 秒。片段结束后交给后台写线程封装成 TS，
+ * 攒满大块后顺序写盘，推流线程和拉流回调只做内存拷贝，不碰磁盘，不重新编解码。
+ */
+class ClipRecorder {
+public:
+    ClipRecorder(const std::string &dir, const std::string &stream_id, int pre_sec, int post_sec, int max_sec);
+    ~ClipRecorder(); // 正在录制的片段按已有内容写盘后退出
+
+    // 输出码流的编码类型(264/265)，创建输出媒体源时设置
+    void setCodec(int codec);
+
+    /**
+     * @brief 送入一帧已编码的码流（Annex-B，带起始码），数据会被拷贝
+     * @param config 单独送入的参数集，缓存后拼到下一帧前面
+     */
+    void addPacket(const uint8_t *data, size_t size, int64_t dts_ms, int64_t pts_ms, bool key, bool config = false);
+
+    // 报警触发录像，正在录制时延长结束时间
+    void trigger();
+
+    uint64_t clipsWritten() const { return clips_written_; }
+
+private:
+    struct Packet {
+        std::shared_ptr<std::vector<uint8_t>> data;
+        int64_t dts_ms;
+        int64_t pts_ms;
+        bool key;
+    };
+    struct Clip {
+        std::string path;
+        int codec = 0;
+        int64_t begin_ms = 0;
+        int64_t end_ms = 0;
+        bool wait_key = false; // 缓冲区里没有可用的关键帧，从下一个关键帧开始录
+        std::vector<Packet> packets;
+    };
+
+    void trimRing();
+    void finishClip();
+    void writerLoop();
+    bool writeClip(const Clip &clip);
+
+    std::string dir_;
+    std::string stream_id_;
+    int64_t pre_ms_;
+    int64_t post_ms_;
+    int64_t max_ms_;
+
+    std::mutex mutex_;
+    int codec_ = 0;
+    std::deque<Packet> ring_;
+    size_t ring_bytes_ = 0;
+    std::vector<uint8_t> pending_config_;
+    int64_t last_pts_ms_ = 0;
+    int64_t last_clip_end_ms_ = INT64_MIN; // 上一个片段的最后一帧，新片段不重复录
+    std::unique_ptr<Clip> active_;
+    uint32_t clip_seq_ = 0;
+
+    std::condition_variable cv_;
+    std::deque<std::unique_ptr<Clip>> jobs_;
+    bool stop_ = false;
+    std::atomic<uint64_t> clips_written_{0};
+    std::thread writer_;
+};
+
+#endif // CLIP_RECORDER_HPP
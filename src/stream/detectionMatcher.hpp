@@ -0,0 +1,88 @@
+#ifndef DETECTION_MATCHER_HPP
+#define DETECTION_MATCHER_HPP
+
+#include <stdint.h>
+#include <deque>
+#include <memory>
+#include <vector>
+#include "types/yolo_datatype.h"
+#include "types/video_frame.h"
+
+/**
+ * @brief 双码流输入时，把子码流上的检测结果按时间匹配到主码流的帧上
+ *
+ * 两路 RTSP 会话的 pts 没有共同基准，匹配使用本机的码流到达时间(capture_us)。
+ * 只保存检测结果和子码流分辨率，不持有子码流的帧，避免占住 MatPool 内存。
+ * 只在推流线程中使用，不加锁。
+ */
+class DetectionMatcher {
+public:
+    struct Entry {
+        int64_t capture_us = 0;
+        int width = 0;
+        int height = 0;
+        std::shared_ptr<std::vector<Detection>> objects;
+    };
+
+    explicit DetectionMatcher(int64_t max_skew_us = 500000, size_t history = 32)
+        : max_skew_us_(max_skew_us), history_(history ? history : 1) {}
+
+    void add(const VideoFrame &frame, const std::shared_ptr<std::vector<Detection>> &objects) {
+        Entry entry;
+        entry.capture_us = frame.capture_us;
+        entry.width = frame.width;
+        entry.height = frame.height;
+        entry.objects = objects;
+        entries_.push_back(entry);
+        while (entries_.size() > history_) {
+            entries_.pop_front();
+        }
+    }
+
+    // 已收到的最新检测结果对应的到达时间，没有时为 0
+    int64_t latestCaptureUs() const { return entries_.empty() ? 0 : entries_.back().capture_us; }
+
+    /**
+     * @brief 查找到达时间与 capture_us 最接近的检测结果，超出容差时返回 nullptr
+     */
+    const Entry *match(int64_t capture_us) const {
+        const Entry *best = nullptr;
+        int64_t best_diff = 0;
+        for (const auto &entry : entries_) {
+            int64_t diff = entry.capture_us > capture_us ? entry.capture_us - capture_us : capture_us - entry.capture_us;
+            if (best == nullptr || diff < best_diff) {
+                best = &entry;
+                best_diff = diff;
+            }
+        }
+        return best != nullptr && best_diff <= max_skew_us_ ? best : nullptr;
+    }
+
+    /**
+     * @brief 把检测框从 (src_w, src_h) 映射到 (dst_w, dst_h)
+     */
+    static std::shared_ptr<std::vector<Detection>> scale(const std::vector<Detection> &objects,
+                                                         int src_w, int src_h, int dst_w, int dst_h) {
+        auto scaled = std::make_shared<std::vector<Detection>>(objects);
+        if (src_w <= 0 || src_h <= 0 || dst_w <= 0 || dst_h <= 0 || (src_w == dst_w && src_h == dst_h)) {
+            return scaled;
+        }
+        double sx = (double)dst_w / src_w;
+        double sy = (double)dst_h / src_h;
+        for (auto &obj : *scaled) {
+            int x0 = (int)(obj.box.x * sx + 0.5);
+            int y0 = (int)(obj.box.y * sy + 0.5);
+            int x1 = (int)((obj.box.x + obj.box.width) * sx + 0.5);
+            int y1 = (int)((obj.box.y + obj.box.height) * sy + 0.5);
+            obj.box = cv::Rect(x0, y0, x1 - x0, y1 - y0);
+        }
+        return scaled;
+    }
+
+private:
+    int64_t max_skew_us_;
+    size_t history_;
+    std::deque<Entry> entries_;
+};
+
+#endif // DETECTION_MATCHER_HPP
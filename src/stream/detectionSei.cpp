@@ -0,0 +1,170 @@
+#include "detectionSei.hpp"
+#include "nalUtils.hpp"
+#include <string.h>
+
+static const uint8_t kDetectionUuid[16] = {'S', 't', 'r', 'e', 'a', 'm', 'H', 'i',
+                                           'v', 'e', '-', 'D', 'e', 't', '0', '1'};
+static const uint8_t kVersion = 1;
+static const size_t kHeaderSize = 14;
+static const size_t kBoxSize = 10;
+
+static void putU16(std::vector<uint8_t> &buf, uint16_t v) {
+    buf.push_back((uint8_t)(v >> 8));
+    buf.push_back((uint8_t)v);
+}
+
+static uint16_t getU16(const uint8_t *p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+// payloadType/payloadSize 的 0xFF 分段编码
+static void putSeiValue(std::vector<uint8_t> &buf, size_t v) {
+    while (v >= 255) {
+        buf.push_back(0xFF);
+        v -= 255;
+    }
+    buf.push_back((uint8_t)v);
+}
+
+static bool getSeiValue(const uint8_t *&p, const uint8_t *end, size_t &v) {
+    v = 0;
+    while (p < end) {
+        uint8_t b = *p++;
+        v += b;
+        if (b != 0xFF) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t buildDetectionSei(const SeiFrameMeta &meta, bool hevc, std::vector<uint8_t> &out) {
+    size_t count = meta.boxes.size() > 255 ? 255 : meta.boxes.size();
+
+    // SEI 消息的 RBSP
+    std::vector<uint8_t> rbsp;
+    rbsp.reserve(32 + kHeaderSize + count * kBoxSize);
+    rbsp.push_back(5); // user_data_unregistered
+    putSeiValue(rbsp, sizeof(kDetectionUuid) + kHeaderSize + count * kBoxSize);
+    rbsp.insert(rbsp.end(), kDetectionUuid, kDetectionUuid + sizeof(kDetectionUuid));
+    rbsp.push_back(kVersion);
+    rbsp.push_back((uint8_t)count);
+    putU16(rbsp, (uint16_t)meta.width);
+    putU16(rbsp, (uint16_t)meta.height);
+    uint64_t pts = meta.pts >= 0 ? (uint64_t)meta.pts : ~0ULL;
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        rbsp.push_back((uint8_t)(pts >> shift));
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const SeiBox &box = meta.boxes[i];
+        putU16(rbsp, box.x);
+        putU16(rbsp, box.y);
+        putU16(rbsp, box.w);
+        putU16(rbsp, box.h);
+        rbsp.push_back(box.class_id);
+        rbsp.push_back(box.score);
+    }
+    rbsp.push_back(0x80); // rbsp_trailing_bits
+
+    out.clear();
+    out.reserve(rbsp.size() + rbsp.size() / 64 + 8);
+    const uint8_t start_code[4] = {0, 0, 0, 1};
+    out.insert(out.end(), start_code, start_code + 4);
+    if (hevc) {
+        out.push_back(39 << 1); // PREFIX_SEI_NUT, layer_id=0
+        out.push_back(1);       // temporal_id_plus1
+    } else {
+        out.push_back(0x06);
+    }
+    // 连续两个 0 之后出现 0~3 时插入防竞争字节
+    int zeros = 0;
+    for (uint8_t b : rbsp) {
+        if (zeros >= 2 && b <= 3) {
+            out.push_back(0x03);
+            zeros = 0;
+        }
+        out.push_back(b);
+        zeros = b == 0 ? zeros + 1 : 0;
+    }
+    return out.size();
+}
+
+bool parseDetectionSei(const uint8_t *nal, size_t len, bool hevc, SeiFrameMeta &meta) {
+    size_t header = hevc ? 2 : 1;
+    if (nal == nullptr || len <= header) {
+        return false;
+    }
+    if (hevc) {
+        int type = (nal[0] >> 1) & 0x3F;
+        if (type != 39 && type != 40) {
+            return false;
+        }
+    } else if ((nal[0] & 0x1F) != 6) {
+        return false;
+    }
+
+    // 去掉防竞争字节
+    std::vector<uint8_t> rbsp;
+    rbsp.reserve(len);
+    int zeros = 0;
+    for (size_t i = header; i < len; ++i) {
+        uint8_t b = nal[i];
+        if (zeros >= 2 && b == 0x03) {
+            zeros = 0;
+            continue;
+        }
+        rbsp.push_back(b);
+        zeros = b == 0 ? zeros + 1 : 0;
+    }
+
+    const uint8_t *p = rbsp.data();
+    const uint8_t *end = p + rbsp.size();
+    while (p < end && *p != 0x80) {
+        size_t type = 0, size = 0;
+        if (!getSeiValue(p, end, type) || !getSeiValue(p, end, size) || size > (size_t)(end - p)) {
+            return false;
+        }
+        const uint8_t *payload = p;
+        p += size;
+        if (type != 5 || size < sizeof(kDetectionUuid) + kHeaderSize ||
+            memcmp(payload, kDetectionUuid, sizeof(kDetectionUuid)) != 0) {
+            continue;
+        }
+        const uint8_t *data = payload + sizeof(kDetectionUuid);
+        size_t data_len = size - sizeof(kDetectionUuid);
+        size_t count = data[1];
+        if (data[0] != kVersion || data_len < kHeaderSize + count * kBoxSize) {
+            return false;
+        }
+        meta.width = getU16(data + 2);
+        meta.height = getU16(data + 4);
+        uint64_t pts = 0;
+        for (int i = 0; i < 8; ++i) {
+            pts = (pts << 8) | data[6 + i];
+        }
+        meta.pts = pts == ~0ULL ? -1 : (int64_t)pts;
+        meta.boxes.resize(count);
+        const uint8_t *b = data + kHeaderSize;
+        for (size_t i = 0; i < count; ++i, b += kBoxSize) {
+            meta.boxes[i].x = getU16(b);
+            meta.boxes[i].y = getU16(b + 2);
+            meta.boxes[i].w = getU16(b + 4);
+            meta.boxes[i].h = getU16(b + 6);
+            meta.boxes[i].class_id = b[8];
+            meta.boxes[i].score = b[9];
+        }
+        return true;
+    }
+    return false;
+}
+
+bool findDetectionSei(const uint8_t *data, size_t len, bool hevc, SeiFrameMeta &meta) {
+    std::vector<NalUnit> nals;
+    splitAnnexB(data, len, hevc ? VIDEO_CODEC_H265 : VIDEO_CODEC_H264, nals);
+    for (const NalUnit &nal : nals) {
+        if (parseDetectionSei(nal.data, nal.size, hevc, meta)) {
+            return true;
+        }
+    }
+    return false;
+}
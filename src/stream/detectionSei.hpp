@@ -0,0 +1,55 @@
+#ifndef DETECTION_SEI_HPP
+#define DETECTION_SEI_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/*
+检测结果随码流下发：序列化为 user_data_unregistered SEI（payloadType=5），
+由播放端解析后自行画框，服务端不再需要画框和重新编码。
+
+SEI 负载 = 16 字节 UUID("StreamHive-Det01") + 以下数据，多字节字段均为大端：
+    u8  version      当前为 1
+    u8  count        目标个数，最多 255
+    u16 width        坐标所在画面的宽
+    u16 height       坐标所在画面的高
+    u64 pts          所描述帧的源端 pts(ms)，未知时全 1
+    count × { u16 x, u16 y, u16 w, u16 h, u8 class_id, u8 score(0-255) }
+*/
+
+struct SeiBox {
+    uint16_t x = 0;
+    uint16_t y = 0;
+    uint16_t w = 0;
+    uint16_t h = 0;
+    uint8_t class_id = 0;
+    uint8_t score = 0; // 置信度 × 255
+};
+
+struct SeiFrameMeta {
+    int width = 0;
+    int height = 0;
+    int64_t pts = -1;
+    std::vector<SeiBox> boxes;
+};
+
+/**
+ * @brief 生成带 4 字节起始码的 SEI NAL（已加防竞争字节），可直接送入 mk_media_input_h264/h265
+ * @param hevc true 生成 H.265 PREFIX_SEI，否则生成 H.264 SEI
+ * @return NAL 长度
+ */
+size_t buildDetectionSei(const SeiFrameMeta &meta, bool hevc, std::vector<uint8_t> &out);
+
+/**
+ * @brief 解析单个 SEI NAL（从 NAL 头开始，不含起始码）
+ * @return 是本模块生成的检测结果 SEI 且解析成功时返回 true
+ */
+bool parseDetectionSei(const uint8_t *nal, size_t len, bool hevc, SeiFrameMeta &meta);
+
+/**
+ * @brief 在一段 Annex-B 码流（一个访问单元）中查找检测结果 SEI，供播放端使用
+ */
+bool findDetectionSei(const uint8_t *data, size_t len, bool hevc, SeiFrameMeta &meta);
+
+#endif // DETECTION_SEI_HPP
@@ -0,0 +1,86 @@
+#include "fileSource.hpp"
+#include <stdio.h>
+
+bool isFileSourceUrl(const std::string &url, std::string *path) {
+    if (url.compare(0, 7, "file://") != 0) {
+        return false;
+    }
+    if (path != nullptr) {
+        *path = url.substr(7);
+    }
+    return true;
+}
+
+bool AnnexBFileReader::open(const std::string &path) {
+    FILE *fp = fopen(path.c_str(), "rb");
+    if (fp == nullptr) {
+        printf("无法打开输入文件 %s\n", path.c_str());
+        return false;
+    }
+    data_.clear();
+    units_.clear();
+    next_ = 0;
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        data_.insert(data_.end(), buf, buf + n);
+    }
+    fclose(fp);
+
+    codec_ = guessCodec(data_.data(), data_.size());
+    if (codec_ == VIDEO_CODEC_UNKNOWN) {
+        // MP4 等封装格式不在这里解复用，需先转成裸流
+        printf("%s 不是 H.264/H.265 Annex-B 裸流\n", path.c_str());
+        return false;
+    }
+    std::vector<NalUnit> nals;
+    splitAnnexB(data_.data(), data_.size(), codec_, nals);
+
+    // 按访问单元分组：切片之后再出现参数集/AUD/SEI 或新一帧的第一个切片，即为下一帧
+    const uint8_t *base = data_.data();
+    const uint8_t *unit_begin = nullptr;
+    bool has_slice = false;
+    bool key = false;
+    for (const auto &nal : nals) {
+        // 回退到起始码开头
+        const uint8_t *begin = nal.data - 3;
+        if (begin > base && begin[-1] == 0) {
+            --begin;
+        }
+        bool slice = nalIsSlice(codec_, nal.type);
+        if (has_slice && (nalStartsAccessUnit(codec_, nal.type) || (slice && nalIsFirstSlice(codec_, nal.data, nal.size)))) {
+            AccessUnit unit;
+            unit.data = unit_begin;
+            unit.size = begin - unit_begin;
+            unit.key = key;
+            units_.push_back(unit);
+            unit_begin = nullptr;
+            has_slice = false;
+            key = false;
+        }
+        if (unit_begin == nullptr) {
+            unit_begin = begin;
+        }
+        if (slice) {
+            has_slice = true;
+            key = key || nalIsKeyFrame(codec_, nal.type);
+        }
+    }
+    if (has_slice) {
+        AccessUnit unit;
+        unit.data = unit_begin;
+        unit.size = base + data_.size() - unit_begin;
+        unit.key = key;
+        units_.push_back(unit);
+    }
+    printf("输入文件 %s: %s, %zu 字节, %zu 帧\n", path.c_str(), codecName(codec_), data_.size(), units_.size());
+    return !units_.empty();
+}
+
+bool AnnexBFileReader::next(AccessUnit &unit) {
+    if (next_ >= units_.size()) {
+        return false;
+    }
+    unit = units_[next_++];
+    return true;
+}
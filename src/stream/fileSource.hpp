@@ -0,0 +1,53 @@
+#ifndef FILE_SOURCE_HPP
+#define FILE_SOURCE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "nalUtils.hpp"
+
+// 文件输入的回放节奏
+enum file_pace_e {
+    FILE_PACE_REALTIME = 0, // 按帧率节拍送帧，模拟摄像头
+    FILE_PACE_MAX = 1,      // 不限速，下游阻塞时等待而不丢帧，用于测吞吐
+};
+
+// 一个访问单元（一帧），data 指向文件缓冲区内带起始码的连续数据
+struct AccessUnit {
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    bool key = false; // 含关键帧切片
+};
+
+/**
+ * @brief 判断输入地址是否为本地裸流文件（"file:///path/to/test.h264"）
+ * @param path 返回去掉 file:// 前缀后的文件路径
+ */
+bool isFileSourceUrl(const std::string &url, std::string *path = nullptr);
+
+/**
+ * @brief Annex-B 裸流文件读取器
+ *
+ * 整个文件一次读入内存，按访问单元切分后反复回放，回放过程不再有磁盘IO，
+ * 保证每次测量的输入完全相同。裸流没有时间戳，由调用方按帧序号生成。
+ */
+class AnnexBFileReader {
+public:
+    bool open(const std::string &path);
+
+    int codec() const { return codec_; }
+    size_t frameCount() const { return units_.size(); }
+
+    // 取下一帧，到达文件末尾时返回 false，调用 rewind() 后从头开始
+    bool next(AccessUnit &unit);
+    void rewind() { next_ = 0; }
+
+private:
+    std::vector<uint8_t> data_;
+    std::vector<AccessUnit> units_;
+    size_t next_ = 0;
+    int codec_ = VIDEO_CODEC_UNKNOWN;
+};
+
+#endif // FILE_SOURCE_HPP
@@ -0,0 +1,70 @@
+#ifndef FRAME_DECIMATOR_HPP
+#define FRAME_DECIMATOR_HPP
+
+#include <stdint.h>
+
+/**
+ * @brief 按目标帧率从输入帧中均匀抽帧
+ *
+ * 按帧间隔判断（距上一帧不足 1000/fps 就丢）会把 25fps 抽成 8.3fps 而不是 10fps，
+ * 且间隔随源端抖动漂移。这里维护一条按目标间隔推进的时间网格，帧时间落到网格点
+ * 附近半个源帧间隔内就选中，网格点只按固定步长前进，长期帧率等于目标帧率，
+ * 选中帧的间隔只在相邻两个源帧间隔之间交替（25->10 为 80/120ms）。
+ * 时间戳回退或长时间断流时重新对齐网格。只在解码线程中使用，不加锁。
+ */
+class FrameDecimator {
+public:
+    explicit FrameDecimator(int fps = 0) { setFps(fps); }
+
+    void setFps(int fps) {
+        fps_ = fps > 0 ? fps : 0;
+        interval_ms_ = fps_ > 0 ? 1000.0 / fps_ : 0;
+        next_due_ms_ = -1;
+    }
+    bool enabled() const { return interval_ms_ > 0; }
+
+    // 抽帧后的实际帧率：min(源帧率, 目标帧率)，未启用时为源帧率；源帧率未知(<=0)时取目标帧率
+    int outputFps(int source_fps) const {
+        if (!enabled()) {
+            return source_fps;
+        }
+        return source_fps > 0 && source_fps < fps_ ? source_fps : fps_;
+    }
+
+    // t_ms 为帧时间（源端 pts，没有时用本机时间），返回 true 表示保留这一帧
+    bool accept(int64_t t_ms) {
+        if (interval_ms_ <= 0) {
+            return true;
+        }
+        if (last_ms_ >= 0) {
+            int64_t d = t_ms - last_ms_;
+            if (d > 0 && d < 1000) {
+                src_period_ms_ = src_period_ms_ > 0 ? src_period_ms_ * 0.9 + d * 0.1 : d;
+            }
+        }
+        last_ms_ = t_ms;
+        if (next_due_ms_ < 0 || t_ms + 1000 < next_due_ms_ - interval_ms_) {
+            next_due_ms_ = t_ms + interval_ms_;
+            return true;
+        }
+        double tolerance = src_period_ms_ / 2;
+        if (t_ms + tolerance < next_due_ms_) {
+            return false;
+        }
+        next_due_ms_ += interval_ms_;
+        if (next_due_ms_ <= t_ms - tolerance) {
+            // 断流后网格落后太多，从当前帧重新开始，不补帧
+            next_due_ms_ = t_ms + interval_ms_;
+        }
+        return true;
+    }
+
+private:
+    int fps_ = 0;
+    double interval_ms_ = 0;
+    double next_due_ms_ = -1;
+    double src_period_ms_ = 0; // 源端帧间隔，指数平均
+    int64_t last_ms_ = -1;
+};
+
+#endif // FRAME_DECIMATOR_HPP
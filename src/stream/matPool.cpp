@@ -1,231 +1,378 @@
 #include "matPool.hpp"
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <sstream>
 
-MatPool::MatPool(size_t max_pool_size, size_t initial_pool_size)
-    : max_pool_size_(max_pool_size), initial_pool_size_(initial_pool_size) {
-    std::cout << "MatPool initialized with max_size=" << max_pool_size 
+static uint64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+MatPoolBudget &MatPoolBudget::instance() {
+    static MatPoolBudget budget;
+    return budget;
+}
+
+void MatPoolBudget::configure(size_t limit_bytes, uint64_t idle_ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    limit_bytes_ = limit_bytes;
+    idle_ms_ = idle_ms;
+    printf("帧内存预算: %s, 空闲回收: %llums\n",
+           limit_bytes ? (std::to_string(limit_bytes >> 20) + "MB").c_str() : "不限制",
+           (unsigned long long)idle_ms);
+}
+
+void MatPoolBudget::registerPool(MatPool *pool) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pools_.push_back(pool);
+}
+
+void MatPoolBudget::unregisterPool(MatPool *pool) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pools_.erase(std::remove(pools_.begin(), pools_.end(), pool), pools_.end());
+}
+
+bool MatPoolBudget::tryReserve(size_t bytes) {
+    bool trimmed = false;
+    size_t current = allocated_bytes_.load();
+    for (;;) {
+        if (limit_bytes_ > 0 && current + bytes > limit_bytes_) {
+            if (trimmed) {
+                rejected_++;
+                return false;
+            }
+            // 先回收其他尺寸类的空闲Mat，腾出这次需要的额度
+            std::lock_guard<std::mutex> lock(mutex_);
+            trimLocked(limit_bytes_ > bytes ? limit_bytes_ - bytes : 0);
+            trimmed = true;
+            current = allocated_bytes_.load();
+            continue;
+        }
+        if (allocated_bytes_.compare_exchange_weak(current, current + bytes)) {
+            break;
+        }
+    }
+    size_t high = high_watermark_.load();
+    while (current + bytes > high && !high_watermark_.compare_exchange_weak(high, current + bytes)) {
+    }
+    return true;
+}
+
+void MatPoolBudget::release(size_t bytes) {
+    allocated_bytes_ -= bytes;
+}
+
+void MatPoolBudget::trimLocked(size_t target_bytes) {
+    std::vector<MatPool::SizeClass *> classes;
+    for (auto *pool : pools_) {
+        auto snapshot = pool->snapshotClasses();
+        classes.insert(classes.end(), snapshot.begin(), snapshot.end());
+    }
+    // 最久未使用的尺寸类最先回收
+    std::sort(classes.begin(), classes.end(), [](MatPool::SizeClass *a, MatPool::SizeClass *b) {
+        return a->last_used_ms < b->last_used_ms;
+    });
+    for (auto *cls : classes) {
+        while (allocated_bytes_ > target_bytes && MatPool::drain(*cls, 1) > 0) {
+            trimmed_mats_++;
+        }
+        if (allocated_bytes_ <= target_bytes) {
+            break;
+        }
+    }
+}
+
+void MatPoolBudget::trimIdle() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (idle_ms_ == 0) {
+        return;
+    }
+    uint64_t now = nowMs();
+    for (auto *pool : pools_) {
+        for (auto *cls : pool->snapshotClasses()) {
+            if (now - cls->last_used_ms > idle_ms_ && cls->free_mats.size() > 0) {
+                size_t freed = MatPool::drain(*cls);
+                trimmed_mats_ += freed;
+                printf("回收空闲尺寸类 %dx%d_%d: 释放 %zu 个Mat\n", cls->width, cls->height, cls->type, freed);
+            }
+        }
+    }
+}
+
+void MatPoolBudget::printStats() const {
+    size_t pool_count;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pool_count = pools_.size();
+    }
+    printf("=== 帧内存预算 ===\n");
+    printf("  内存池: %zu, 上限: %zuMB, 当前: %.1fMB, 峰值: %.1fMB, 回收: %zu, 拒绝: %zu\n",
+           pool_count, limit_bytes_ >> 20, allocated_bytes_ / 1048576.0, high_watermark_ / 1048576.0,
+           trimmed_mats_.load(), rejected_.load());
+}
+
+MatPool::MatPool(size_t max_pool_size, size_t initial_pool_size, std::shared_ptr<DmaAllocator> allocator)
+    : max_pool_size_(max_pool_size), initial_pool_size_(initial_pool_size), allocator_(allocator) {
+    std::cout << "MatPool initialized with max_size=" << max_pool_size
               << ", initial_size=" << initial_pool_size << std::endl;
+    MatPoolBudget::instance().registerPool(this);
 }
 
 MatPool::~MatPool() {
-    clearAllPools();
+    MatPoolBudget::instance().unregisterPool(this);
+    std::lock_guard<std::mutex> lock(pools_mutex_);
+    size_t outstanding = 0;
+    for (auto &pair : pools_) {
+        // 仍在借出的Mat归还时直接释放，尺寸类由这些Mat的删除器保活到最后一个归还
+        pair.second->retired = true;
+        drain(*pair.second);
+        outstanding += pair.second->current_in_use;
+    }
+    if (outstanding > 0) {
+        std::cout << "MatPool destroyed with " << outstanding << " Mats still in use" << std::endl;
+    }
+    last_class_ = nullptr;
+    pools_.clear();
     std::cout << "MatPool destroyed" << std::endl;
 }
 
-std::string MatPool::generatePoolKey(int width, int height, int type) const {
-    return std::to_string(width) + "x" + std::to_string(height) + "_" + std::to_string(type);
+MatPool::SizeClass::~SizeClass() {
+    drain(*this);
+}
+
+void MatPool::SizeClass::release(PooledMat *item) {
+    current_in_use--;
+    if (!item || item->mat.empty() || item->mat.data == nullptr || retired.load(std::memory_order_relaxed) ||
+        free_mats.size() >= max_free || !free_mats.tryPush(item)) {
+        // 无效的Mat、尺寸类已停用或空闲链表已满，直接删除并归还预算
+        delete item;
+        MatPoolBudget::instance().release(bytes);
+    }
 }
 
-std::unique_ptr<cv::Mat> MatPool::createMat(int width, int height, int type) const {
+std::unique_ptr<MatPool::PooledMat> MatPool::createMat(const SizeClass &cls) const {
+    const int width = cls.width, height = cls.height, type = cls.type;
     try {
-        auto mat = std::make_unique<cv::Mat>(height, width, type);
-        if (mat->empty() || mat->data == nullptr) {
+        auto item = std::make_unique<PooledMat>();
+        if (allocator_) {
+            item->dma = allocator_->allocate(cls.bytes);
+        }
+        if (item->dma) {
+            // Mat 只引用缓冲区的缓存映射，不持有内存
+            item->mat = cv::Mat(height, width, type, item->dma->data());
+        } else {
+            item->mat = cv::Mat(height, width, type);
+        }
+        if (item->mat.empty() || item->mat.data == nullptr) {
             throw std::runtime_error("Failed to create Mat with valid data");
         }
-        return mat;
+        return item;
     } catch (const std::exception& e) {
-        std::cerr << "Error creating Mat(" << width << "x" << height << ", type=" << type 
+        std::cerr << "Error creating Mat(" << width << "x" << height << ", type=" << type
                   << "): " << e.what() << std::endl;
         throw;
     }
 }
 
-MatPool::PoolInfo& MatPool::getOrCreatePool(const std::string& key) {
+MatPool::SizeClass *MatPool::findClass(uint64_t key) const {
     std::lock_guard<std::mutex> lock(pools_mutex_);
-    
     auto it = pools_.find(key);
-    if (it == pools_.end()) {
-        pools_[key] = std::make_unique<PoolInfo>();
-        std::cout << "Created new pool for key: " << key << std::endl;
+    return it == pools_.end() ? nullptr : it->second.get();
+}
+
+std::vector<MatPool::SizeClass *> MatPool::snapshotClasses() const {
+    std::lock_guard<std::mutex> lock(pools_mutex_);
+    std::vector<SizeClass *> classes;
+    for (auto &pair : pools_) {
+        classes.push_back(pair.second.get());
+    }
+    return classes;
+}
+
+MatPool::SizeClass *MatPool::getOrCreateClass(int width, int height, int type) {
+    const uint64_t key = makeKey(width, height, type);
+    // 单路流绝大多数时间只有一种分辨率，命中缓存时无需加锁
+    SizeClass *cls = last_class_.load(std::memory_order_acquire);
+    if (cls && cls->key == key) {
+        return cls;
+    }
+
+    bool created = false;
+    {
+        std::lock_guard<std::mutex> lock(pools_mutex_);
+        auto it = pools_.find(key);
+        if (it == pools_.end()) {
+            it = pools_.emplace(key, std::make_shared<SizeClass>(key, width, height, type, max_pool_size_)).first;
+            std::cout << "Created new pool for " << width << "x" << height << "_" << type << std::endl;
+            created = true;
+        }
+        cls = it->second.get();
+        cls->last_used_ms = nowMs();
+        last_class_.store(cls, std::memory_order_release);
+    }
+    // 出现新尺寸通常意味着分辨率切换，顺便回收长时间未用的旧尺寸
+    if (created) {
+        MatPoolBudget::instance().trimIdle();
+    }
+    return cls;
+}
+
+std::shared_ptr<cv::Mat> MatPool::wrap(PooledMat *item, SizeClass *cls, const DmaBuffer **buffer) {
+    cls->current_in_use++;
+    if (buffer) {
+        *buffer = item->dma.get();
     }
-    
-    return *pools_[key];
+    // 删除器持有尺寸类的引用，Mat使用完毕后回到对应的空闲链表；对外只暴露其中的Mat
+    std::shared_ptr<SizeClass> holder = cls->shared_from_this();
+    std::shared_ptr<PooledMat> owner(item, [holder](PooledMat *m) { holder->release(m); });
+    return std::shared_ptr<cv::Mat>(owner, &item->mat);
 }
 
-std::shared_ptr<cv::Mat> MatPool::getMat(int width, int height, int type) {
+std::shared_ptr<cv::Mat> MatPool::getMat(int width, int height, int type, bool zero, const DmaBuffer **buffer) {
     if (width <= 0 || height <= 0) {
-        throw std::invalid_argument("Invalid dimensions: width=" + std::to_string(width) + 
+        throw std::invalid_argument("Invalid dimensions: width=" + std::to_string(width) +
                                   ", height=" + std::to_string(height));
     }
 
-    const std::string pool_key = generatePoolKey(width, height, type);
-    PoolInfo& pool = getOrCreatePool(pool_key);
-    
+    SizeClass *cls = getOrCreateClass(width, height, type);
+    cls->last_used_ms.store(nowMs(), std::memory_order_relaxed);
+    if (cls->retired.load(std::memory_order_relaxed)) {
+        // 分辨率切换回来了，重新启用
+        cls->retired = false;
+    }
     total_allocations_++;
-    
-    // 尝试从池中获取可用的Mat
-    {
-        std::lock_guard<std::mutex> lock(pool.mutex);
-        if (!pool.available_mats.empty()) {
-            auto mat_ptr = std::move(pool.available_mats.front());
-            pool.available_mats.pop();
-            pool.total_reused++;
-            pool.current_in_use++;
-            total_pool_hits_++;
-            
-            // 验证Mat的有效性
-            if (mat_ptr && !mat_ptr->empty() && mat_ptr->data != nullptr) {
-                // 清零数据（可选，根据需求决定）
-                mat_ptr->setTo(cv::Scalar::all(0));
-                
-                // 使用自定义删除器，确保Mat使用完毕后返回池中
-                return std::shared_ptr<cv::Mat>(
-                    mat_ptr.release(),
-                    [this, pool_key](cv::Mat* mat) {
-                        this->returnMat(mat, pool_key);
-                    }
-                );
-            }
+
+    // 尝试从空闲链表中获取可用的Mat
+    PooledMat *item = nullptr;
+    if (cls->free_mats.tryPop(item)) {
+        cls->total_reused++;
+        total_pool_hits_++;
+        if (zero) {
+            item->mat.setTo(cv::Scalar::all(0));
         }
+        return wrap(item, cls, buffer);
     }
-    
-    // 池中没有可用的Mat，创建新的
-    total_pool_misses_++;
-    auto new_mat = createMat(width, height, type);
-    
-    {
-        std::lock_guard<std::mutex> lock(pool.mutex);
-        pool.total_created++;
-        pool.current_in_use++;
-    }
-    
-    // 使用自定义删除器
-    return std::shared_ptr<cv::Mat>(
-        new_mat.release(),
-        [this, pool_key](cv::Mat* mat) {
-            this->returnMat(mat, pool_key);
-        }
-    );
-}
 
-void MatPool::returnMat(cv::Mat* mat, const std::string& pool_key) {
-    if (!mat || mat->empty() || mat->data == nullptr) {
-        delete mat;  // 直接删除无效的Mat
-        return;
+    // 池中没有可用的Mat，创建新的（新建的Mat内容未初始化，要求清零时同样处理）
+    total_pool_misses_++;
+    if (!MatPoolBudget::instance().tryReserve(cls->bytes)) {
+        return nullptr;
     }
-    
+    std::unique_ptr<PooledMat> new_item;
     try {
-        PoolInfo& pool = getOrCreatePool(pool_key);
-        std::lock_guard<std::mutex> lock(pool.mutex);
-        
-        pool.current_in_use--;
-        
-        // 如果池未满，则将Mat返回池中
-        if (pool.available_mats.size() < max_pool_size_) {
-            pool.available_mats.push(std::unique_ptr<cv::Mat>(mat));
-        } else {
-            // 池已满，直接删除
-            delete mat;
-        }
-    } catch (const std::exception& e) {
-        std::cerr << "Error returning Mat to pool: " << e.what() << std::endl;
-        delete mat;  // 发生错误时直接删除
+        new_item = createMat(*cls);
+    } catch (...) {
+        MatPoolBudget::instance().release(cls->bytes);
+        throw;
     }
+    if (zero) {
+        new_item->mat.setTo(cv::Scalar::all(0));
+    }
+    cls->total_created++;
+    return wrap(new_item.release(), cls, buffer);
 }
 
 void MatPool::preallocate(int width, int height, int count, int type) {
     if (width <= 0 || height <= 0 || count <= 0) {
         throw std::invalid_argument("Invalid parameters for preallocation");
     }
-    
-    const std::string pool_key = generatePoolKey(width, height, type);
-    PoolInfo& pool = getOrCreatePool(pool_key);
-    
-    std::lock_guard<std::mutex> lock(pool.mutex);
-    
-    std::cout << "Preallocating " << count << " Mats for " << pool_key << std::endl;
-    
-    for (int i = 0; i < count && pool.available_mats.size() < max_pool_size_; ++i) {
+
+    SizeClass *cls = getOrCreateClass(width, height, type);
+    std::cout << "Preallocating " << count << " Mats for " << width << "x" << height << "_" << type << std::endl;
+
+    for (int i = 0; i < count && cls->free_mats.size() < max_pool_size_; ++i) {
+        if (!MatPoolBudget::instance().tryReserve(cls->bytes)) {
+            std::cerr << "Frame memory budget exhausted after preallocating " << i << " Mats" << std::endl;
+            break;
+        }
         try {
-            auto mat = createMat(width, height, type);
-            pool.available_mats.push(std::move(mat));
-            pool.total_created++;
+            auto item = createMat(*cls);
+            if (!cls->free_mats.tryPush(item.get())) {
+                MatPoolBudget::instance().release(cls->bytes);
+                break;
+            }
+            item.release();
+            cls->total_created++;
         } catch (const std::exception& e) {
+            MatPoolBudget::instance().release(cls->bytes);
             std::cerr << "Failed to preallocate Mat " << i << ": " << e.what() << std::endl;
             break;
         }
     }
-    
-    std::cout << "Preallocated " << pool.available_mats.size() << " Mats for " << pool_key << std::endl;
+
+    std::cout << "Preallocated " << cls->free_mats.size() << " Mats for " << width << "x" << height << "_" << type << std::endl;
+}
+
+size_t MatPool::drain(SizeClass &cls, size_t max_count) {
+    size_t freed = 0;
+    PooledMat *item = nullptr;
+    while (freed < max_count && cls.free_mats.tryPop(item)) {
+        delete item;
+        MatPoolBudget::instance().release(cls.bytes);
+        freed++;
+    }
+    return freed;
 }
 
 void MatPool::clearPool(int width, int height, int type) {
-    const std::string pool_key = generatePoolKey(width, height, type);
-    
-    std::lock_guard<std::mutex> pools_lock(pools_mutex_);
-    auto it = pools_.find(pool_key);
-    if (it != pools_.end()) {
-        PoolInfo& pool = *it->second;
-        std::lock_guard<std::mutex> pool_lock(pool.mutex);
-        
-        size_t cleared_count = pool.available_mats.size();
-        while (!pool.available_mats.empty()) {
-            pool.available_mats.pop();
-        }
-        
-        std::cout << "Cleared " << cleared_count << " Mats from pool " << pool_key << std::endl;
+    SizeClass *cls = findClass(makeKey(width, height, type));
+    if (cls) {
+        size_t cleared_count = drain(*cls);
+        std::cout << "Cleared " << cleared_count << " Mats from pool " << width << "x" << height << "_" << type << std::endl;
+    }
+}
+
+void MatPool::retirePool(int width, int height, int type) {
+    SizeClass *cls = findClass(makeKey(width, height, type));
+    if (cls) {
+        cls->retired = true;
+        size_t cleared_count = drain(*cls);
+        std::cout << "Retired pool " << width << "x" << height << "_" << type << ", freed " << cleared_count
+                  << " idle Mats, " << cls->current_in_use << " in use will be freed on return" << std::endl;
     }
 }
 
 void MatPool::clearAllPools() {
     std::lock_guard<std::mutex> lock(pools_mutex_);
-    
+
+    // 尺寸类本身保留，借出中的Mat归还时仍需要它
     size_t total_cleared = 0;
     for (auto& pair : pools_) {
-        PoolInfo& pool = *pair.second;
-        std::lock_guard<std::mutex> pool_lock(pool.mutex);
-        
-        size_t pool_size = pool.available_mats.size();
-        while (!pool.available_mats.empty()) {
-            pool.available_mats.pop();
-        }
-        total_cleared += pool_size;
+        total_cleared += drain(*pair.second);
     }
-    
-    pools_.clear();
     std::cout << "Cleared all pools, total " << total_cleared << " Mats freed" << std::endl;
 }
 
 void MatPool::printStats() const {
     std::lock_guard<std::mutex> lock(pools_mutex_);
-    
+
     std::cout << "\n=== MatPool Statistics ===" << std::endl;
     std::cout << "Total allocations: " << total_allocations_ << std::endl;
     std::cout << "Pool hits: " << total_pool_hits_ << std::endl;
     std::cout << "Pool misses: " << total_pool_misses_ << std::endl;
-    
+
     if (total_allocations_ > 0) {
         double hit_rate = (double)total_pool_hits_ / total_allocations_ * 100.0;
         std::cout << "Hit rate: " << hit_rate << "%" << std::endl;
     }
-    
+
     std::cout << "Active pools: " << pools_.size() << std::endl;
-    
+
     for (const auto& pair : pools_) {
-        const PoolInfo& pool = *pair.second;
-        std::lock_guard<std::mutex> pool_lock(pool.mutex);
-        
-        std::cout << "  Pool " << pair.first << ":" << std::endl;
-        std::cout << "    Available: " << pool.available_mats.size() << std::endl;
-        std::cout << "    Total created: " << pool.total_created << std::endl;
-        std::cout << "    Total reused: " << pool.total_reused << std::endl;
-        std::cout << "    Currently in use: " << pool.current_in_use << std::endl;
+        const SizeClass &cls = *pair.second;
+        std::cout << "  Pool " << cls.width << "x" << cls.height << "_" << cls.type << ":" << std::endl;
+        std::cout << "    Available: " << cls.free_mats.size() << std::endl;
+        std::cout << "    Total created: " << cls.total_created << std::endl;
+        std::cout << "    Total reused: " << cls.total_reused << std::endl;
+        std::cout << "    Currently in use: " << cls.current_in_use << std::endl;
     }
     std::cout << "========================\n" << std::endl;
 }
 
 size_t MatPool::getPoolSize(int width, int height, int type) const {
-    const std::string pool_key = generatePoolKey(width, height, type);
-    
-    std::lock_guard<std::mutex> pools_lock(pools_mutex_);
-    auto it = pools_.find(pool_key);
-    if (it != pools_.end()) {
-        const PoolInfo& pool = *it->second;
-        std::lock_guard<std::mutex> pool_lock(pool.mutex);
-        return pool.available_mats.size();
-    }
-    return 0;
+    SizeClass *cls = findClass(makeKey(width, height, type));
+    return cls ? cls->free_mats.size() : 0;
 }
 
 size_t MatPool::getTotalPools() const {
@@ -3,20 +3,81 @@
 
 #include <opencv2/opencv.hpp>
 #include <memory>
-#include <queue>
 #include <mutex>
 #include <unordered_map>
 #include <string>
 #include <atomic>
+#include <cstdint>
+#include <vector>
+#include "threadPool/lockFreeQueue.hpp"
+#include "utils/dmaBuffer.hpp"
+
+class MatPool;
+
+/**
+ * @brief 进程级帧内存预算，所有流的 MatPool 共享
+ *
+ * - 统计所有内存池创建的Mat字节数（借出中 + 空闲），记录历史峰值
+ * - 超出预算时按最近最少使用顺序回收各尺寸类的空闲Mat，仍不够则拒绝分配
+ * - 长时间未使用的尺寸类（如摄像头切换分辨率后的旧尺寸）的空闲Mat会被整体回收
+ */
+class MatPoolBudget {
+public:
+    static MatPoolBudget &instance();
+
+    /**
+     * @brief 配置预算
+     * @param limit_bytes 帧内存上限，0表示不限制（仍然统计）
+     * @param idle_ms 尺寸类空闲超过该时间后回收其空闲Mat，0表示不按空闲时间回收
+     */
+    void configure(size_t limit_bytes, uint64_t idle_ms);
+
+    /**
+     * @brief 申请额度，超出预算时先回收空闲Mat，仍不够返回false
+     */
+    bool tryReserve(size_t bytes);
+    void release(size_t bytes);
+
+    /**
+     * @brief 回收所有空闲时间超过 idle_ms 的尺寸类中的空闲Mat
+     */
+    void trimIdle();
+
+    size_t limitBytes() const { return limit_bytes_; }
+    size_t allocatedBytes() const { return allocated_bytes_; }
+    size_t highWatermark() const { return high_watermark_; }
+    void printStats() const;
+
+private:
+    friend class MatPool;
+    MatPoolBudget() = default;
+    void registerPool(MatPool *pool);
+    void unregisterPool(MatPool *pool);
+    // 调用方持有 mutex_，按LRU回收空闲Mat直到已分配字节数不超过 target_bytes
+    void trimLocked(size_t target_bytes);
+
+    mutable std::mutex mutex_;      // 保护 pools_，同时串行化回收过程
+    std::vector<MatPool *> pools_;
+    size_t limit_bytes_ = 0;
+    uint64_t idle_ms_ = 0;
+    std::atomic<size_t> allocated_bytes_{0};
+    std::atomic<size_t> high_watermark_{0};
+    std::atomic<size_t> trimmed_mats_{0};
+    std::atomic<size_t> rejected_{0};
+};
 
 /**
  * @brief Mat内存池类，用于管理不同尺寸的cv::Mat对象，避免频繁的内存分配和释放
- * 
+ *
  * 特性：
- * - 支持多种分辨率的内存池
- * - 线程安全
- * - 自动扩容和回收
+ * - 按 (宽, 高, 类型) 打包成64位整数键划分尺寸类，每个尺寸类一个无锁空闲链表
+ * - 取用/归还走无锁路径，只有第一次遇到新尺寸时才加锁建表
+ * - 复用时默认不清零（RGA会整帧覆盖），需要时由调用方显式要求
+ * - 创建的Mat计入进程级帧内存预算（MatPoolBudget），超出预算时 getMat 返回空指针
+ * - 可选使用 DmaAllocator 分配像素内存，Mat直接引用带fd的缓冲区，供RGA/MPP零拷贝使用
  * - 统计功能
+ *
+ * 借出的Mat持有所属尺寸类的引用，可以比内存池活得更久：内存池析构后归还的Mat直接释放
  */
 class MatPool {
 public:
@@ -24,9 +85,11 @@ public:
      * @brief 构造函数
      * @param max_pool_size 每个尺寸池的最大容量
      * @param initial_pool_size 每个尺寸池的初始容量
+     * @param allocator 像素内存分配器，为空时使用普通堆内存
      */
-    MatPool(size_t max_pool_size = 50, size_t initial_pool_size = 10);
-    
+    MatPool(size_t max_pool_size = 50, size_t initial_pool_size = 10,
+            std::shared_ptr<DmaAllocator> allocator = nullptr);
+
     /**
      * @brief 析构函数
      */
@@ -37,16 +100,12 @@ public:
      * @param width 图像宽度
      * @param height 图像高度
      * @param type OpenCV Mat类型（默认CV_8UC3）
-     * @return shared_ptr<cv::Mat> 返回可用的Mat对象
+     * @param zero 是否将复用的Mat清零，默认不清零
+     * @param buffer 可选，回写Mat背后的fd缓冲区（堆内存时为nullptr），在Mat释放前有效
+     * @return shared_ptr<cv::Mat> 返回可用的Mat对象，帧内存预算耗尽时返回nullptr
      */
-    std::shared_ptr<cv::Mat> getMat(int width, int height, int type = CV_8UC3);
-
-    /**
-     * @brief 返还Mat对象到池中（通过自定义删除器自动调用）
-     * @param mat Mat对象指针
-     * @param pool_key 池的键值
-     */
-    void returnMat(cv::Mat* mat, const std::string& pool_key);
+    std::shared_ptr<cv::Mat> getMat(int width, int height, int type = CV_8UC3, bool zero = false,
+                                    const DmaBuffer **buffer = nullptr);
 
     /**
      * @brief 预分配指定尺寸的Mat对象
@@ -65,6 +124,13 @@ public:
      */
     void clearPool(int width, int height, int type = CV_8UC3);
 
+    /**
+     * @brief 停用指定尺寸的内存池（分辨率切换后的旧尺寸）
+     * 空闲Mat立即释放，借出中的Mat归还时直接释放而不再回到空闲链表；
+     * 之后再次按该尺寸 getMat 会重新启用
+     */
+    void retirePool(int width, int height, int type = CV_8UC3);
+
     /**
      * @brief 清理所有内存池
      */
@@ -85,37 +151,76 @@ public:
      */
     size_t getTotalPools() const;
 
+    /**
+     * @brief 按分辨率预分配时使用的数量（构造参数 initial_pool_size）
+     */
+    size_t getInitialPoolSize() const { return initial_pool_size_; }
+
+    /**
+     * @brief 生成尺寸类的键值：宽、高各占24位，类型占16位
+     */
+    static uint64_t makeKey(int width, int height, int type) {
+        return ((uint64_t)(width & 0xFFFFFF) << 40) | ((uint64_t)(height & 0xFFFFFF) << 16) | (uint64_t)(type & 0xFFFF);
+    }
+
 private:
-    struct PoolInfo {
-        std::queue<std::unique_ptr<cv::Mat>> available_mats;
+    friend class MatPoolBudget;
+
+    // 池中的一个元素：Mat 的像素内存可能来自 dma 缓冲区，两者一起回收
+    struct PooledMat {
+        cv::Mat mat;
+        std::unique_ptr<DmaBuffer> dma;
+    };
+
+    // 一个尺寸类：相同 (宽, 高, 类型) 的Mat共用一个无锁空闲链表
+    struct SizeClass : std::enable_shared_from_this<SizeClass> {
+        SizeClass(uint64_t key, int width, int height, int type, size_t capacity)
+            : key(key), width(width), height(height), type(type),
+              bytes((size_t)width * height * CV_ELEM_SIZE(type)), max_free(capacity), free_mats(capacity) {}
+        // 最后一个引用（内存池或借出的Mat）释放时，清空剩余的空闲Mat
+        ~SizeClass();
+
+        // 归还Mat：空闲链表已满时直接释放
+        void release(PooledMat *item);
+
+        const uint64_t key;
+        const int width;
+        const int height;
+        const int type;
+        const size_t bytes;     // 单个Mat的字节数，计入帧内存预算
+        const size_t max_free;  // 空闲链表容量会取整到2的幂，这里保存配置的上限
+        LockFreeQueue<PooledMat *> free_mats;
         std::atomic<size_t> total_created{0};
         std::atomic<size_t> total_reused{0};
         std::atomic<size_t> current_in_use{0};
-        mutable std::mutex mutex;
+        std::atomic<uint64_t> last_used_ms{0};
+        std::atomic<bool> retired{false}; // 已停用，归还的Mat直接释放
     };
 
     /**
-     * @brief 生成池的键值
+     * @brief 创建新的池元素，有分配器时像素内存放在fd缓冲区中
      */
-    std::string generatePoolKey(int width, int height, int type) const;
+    std::unique_ptr<PooledMat> createMat(const SizeClass &cls) const;
 
     /**
-     * @brief 创建新的Mat对象
+     * @brief 查找或创建尺寸类，命中最近一次使用的尺寸类时不加锁
      */
-    std::unique_ptr<cv::Mat> createMat(int width, int height, int type) const;
-
-    /**
-     * @brief 获取或创建池信息
-     */
-    PoolInfo& getOrCreatePool(const std::string& key);
+    SizeClass *getOrCreateClass(int width, int height, int type);
+    SizeClass *findClass(uint64_t key) const;
+    static std::shared_ptr<cv::Mat> wrap(PooledMat *item, SizeClass *cls, const DmaBuffer **buffer);
+    // 释放空闲链表中的Mat，最多 max_count 个，返回释放的个数
+    static size_t drain(SizeClass &cls, size_t max_count = SIZE_MAX);
+    std::vector<SizeClass *> snapshotClasses() const;
 
     // 成员变量
-    mutable std::mutex pools_mutex_;
-    std::unordered_map<std::string, std::unique_ptr<PoolInfo>> pools_;
-    
+    mutable std::mutex pools_mutex_;   // 只保护 pools_ 的结构变化
+    std::unordered_map<uint64_t, std::shared_ptr<SizeClass>> pools_;
+    std::atomic<SizeClass *> last_class_{nullptr}; // 只做查找缓存，生命周期由 pools_ 管理
+
     const size_t max_pool_size_;
     const size_t initial_pool_size_;
-    
+    std::shared_ptr<DmaAllocator> allocator_;
+
     // 统计信息
     mutable std::atomic<size_t> total_allocations_{0};
     mutable std::atomic<size_t> total_pool_hits_{0};
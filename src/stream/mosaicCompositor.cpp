@@ -0,0 +1,277 @@
+#include "mosaicCompositor.hpp"
+#include <algorithm>
+#include <chrono>
+#include "nalUtils.hpp"
+#include "utils/dmaBuffer.hpp"
+#include "utils/threadAffinity.hpp"
+
+// YUV420SP 的坐标和尺寸都要是偶数
+static int alignEven(int v)
+{
+    return v & ~1;
+}
+
+static int inputVideo(mk_media media, int codec, const void *data, int len, int64_t pts)
+{
+    if (codec == VIDEO_CODEC_H265)
+    {
+        return mk_media_input_h265(media, data, len, pts, pts);
+    }
+    return mk_media_input_h264(media, data, len, pts, pts);
+}
+
+MosaicCompositor::MosaicCompositor(const MosaicConfig &config, const std::vector<std::string> &stream_ids)
+    : config_(config)
+{
+    config_.width = alignEven(std::max(config_.width, 64));
+    config_.height = alignEven(std::max(config_.height, 64));
+    config_.fps = config_.fps > 0 ? config_.fps : 25;
+    codec_ = (config_.codec == "h265" || config_.codec == "hevc") ? VIDEO_CODEC_H265 : VIDEO_CODEC_H264;
+    int count = (int)stream_ids.size();
+    grid_ = config_.grid > 0 ? config_.grid : (count <= 1 ? 1 : (count <= 4 ? 2 : 3));
+    if (count > grid_ * grid_)
+    {
+        printf("拼接输出: %d 路流超出 %dx%d 网格，只拼接前 %d 路\n", count, grid_, grid_, grid_ * grid_);
+        count = grid_ * grid_;
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        // 格子边界按整数等分，最后一行/列吸收除不尽的余数
+        int row = i / grid_;
+        int col = i % grid_;
+        int x0 = alignEven(config_.width * col / grid_);
+        int x1 = col == grid_ - 1 ? config_.width : alignEven(config_.width * (col + 1) / grid_);
+        int y0 = alignEven(config_.height * row / grid_);
+        int y1 = row == grid_ - 1 ? config_.height : alignEven(config_.height * (row + 1) / grid_);
+        Tile tile;
+        tile.stream_id = stream_ids[i];
+        tile.slot = std::make_shared<MosaicSlot>();
+        tile.cell = {x0, y0, x1 - x0, y1 - y0};
+        tile.content = tile.cell;
+        slots_[tile.stream_id] = tile.slot;
+        tiles_.push_back(tile);
+    }
+}
+
+MosaicCompositor::~MosaicCompositor()
+{
+    stop();
+}
+
+std::shared_ptr<MosaicSlot> MosaicCompositor::slot(const std::string &stream_id) const
+{
+    auto it = slots_.find(stream_id);
+    return it != slots_.end() ? it->second : nullptr;
+}
+
+bool MosaicCompositor::initOutput()
+{
+    encoder_ = new MppEncoder();
+    MppEncoderParams enc_params;
+    memset(&enc_params, 0, sizeof(MppEncoderParams));
+    enc_params.width = config_.width;
+    enc_params.height = config_.height;
+    enc_params.hor_stride = (config_.width + 15) & ~15;
+    enc_params.ver_stride = (config_.height + 15) & ~15;
+    enc_params.fmt = MPP_FMT_YUV420SP;
+    enc_params.type = codec_ == VIDEO_CODEC_H265 ? MPP_VIDEO_CodingHEVC : MPP_VIDEO_CodingAVC;
+    enc_params.fps_in_num = config_.fps;
+    enc_params.fps_out_num = config_.fps;
+    enc_params.bps = config_.bitrate_kbps * 1000;
+    if (encoder_->Init(enc_params, NULL) != 0)
+    {
+        printf("拼接输出: 编码器初始化失败\n");
+        delete encoder_;
+        encoder_ = nullptr;
+        return false;
+    }
+    media_ = mk_media_create("__defaultVhost__", config_.app.c_str(), config_.stream.c_str(), 0, 0, 0);
+    mk_media_init_video(media_, codec_ == VIDEO_CODEC_H265 ? MKCodecH265 : MKCodecH264, config_.width, config_.height,
+                        (float)config_.fps, encoder_->GetBps());
+    mk_media_init_complete(media_);
+    return true;
+}
+
+void MosaicCompositor::releaseOutput()
+{
+    if (media_ != nullptr)
+    {
+        mk_media_release(media_);
+        media_ = nullptr;
+    }
+    if (encoder_ != nullptr)
+    {
+        delete encoder_;
+        encoder_ = nullptr;
+    }
+}
+
+bool MosaicCompositor::start()
+{
+    if (running_ || tiles_.empty())
+    {
+        return running_;
+    }
+    if (!initOutput())
+    {
+        return false;
+    }
+    running_ = true;
+    thread_ = std::thread(&MosaicCompositor::run, this);
+    printf("拼接输出: %s/%s, %dx%d@%d, %dx%d 网格, %zu 路流, 编码 %s\n", config_.app.c_str(), config_.stream.c_str(),
+           config_.width, config_.height, config_.fps, grid_, grid_, tiles_.size(), codecName(codec_));
+    return true;
+}
+
+void MosaicCompositor::stop()
+{
+    running_ = false;
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+    releaseOutput();
+}
+
+void MosaicCompositor::composeTile(Tile &tile, const VideoFramePtr &frame, rga_buffer_t &canvas)
+{
+    if (frame == nullptr || !frame->valid())
+    {
+        // 流已停止，格子涂黑
+        imfill(canvas, tile.cell, 0);
+        tile.src_width = 0;
+        tile.src_height = 0;
+        return;
+    }
+    if (frame->width != tile.src_width || frame->height != tile.src_height)
+    {
+        // 首帧或源分辨率变化：按比例重新计算画面区域，先涂黑整个格子，黑边之后不再重画
+        tile.src_width = frame->width;
+        tile.src_height = frame->height;
+        double scale = std::min((double)tile.cell.width / frame->width, (double)tile.cell.height / frame->height);
+        int w = std::max(2, alignEven((int)(frame->width * scale)));
+        int h = std::max(2, alignEven((int)(frame->height * scale)));
+        tile.content = {tile.cell.x + alignEven((tile.cell.width - w) / 2), tile.cell.y + alignEven((tile.cell.height - h) / 2),
+                        w, h};
+        imfill(canvas, tile.cell, 0);
+    }
+    rga_buffer_t src;
+    if (frame->fd_is_dmabuf)
+    {
+        // 检测框是CPU画的，推流线程交出帧之前已画完；交给RGA读之前结束CPU访问窗口，推流线程已结束时不重复
+        if (frame->cpu_access != nullptr)
+        {
+            frame->cpu_access->end();
+        }
+        src = wrapbuffer_fd(frame->fd, frame->width, frame->height, RK_FORMAT_RGB_888, frame->width_stride,
+                            frame->height_stride);
+    }
+    else
+    {
+        src = wrapbuffer_virtualaddr((void *)frame->mat->data, frame->width, frame->height, RK_FORMAT_RGB_888,
+                                     frame->width_stride, frame->height_stride);
+    }
+    // 缩放和 RGB->NV12 一次完成，直接写到画布上格子的位置
+    rga_buffer_t pat;
+    im_rect prect;
+    memset(&pat, 0, sizeof(pat));
+    memset(&prect, 0, sizeof(prect));
+    im_rect srect = {0, 0, frame->width, frame->height};
+    IM_STATUS ret = improcess(src, canvas, pat, srect, tile.content, prect, IM_SYNC);
+    if (ret != IM_STATUS_SUCCESS)
+    {
+        printf("拼接输出: %s 缩放失败: %s\n", tile.stream_id.c_str(), imStrError(ret));
+    }
+}
+
+void MosaicCompositor::run()
+{
+    ThreadTopology::instance().placeCurrentThread(ThreadClass::Encode, "mosaic_" + config_.stream);
+    // 画布就是编码器的输入缓冲区，两帧之间内容保持不变，没有新帧的格子不用重画
+    void *mpp_frame = encoder_->GetInputFrameBuffer();
+    if (mpp_frame == nullptr)
+    {
+        running_ = false;
+        return;
+    }
+    rga_buffer_t canvas = wrapbuffer_fd(encoder_->GetInputFrameBufferFd(mpp_frame), encoder_->GetWidth(),
+                                        encoder_->GetHeight(), RK_FORMAT_YCbCr_420_SP, encoder_->GetHorStride(),
+                                        encoder_->GetVerStride());
+    im_rect full = {0, 0, encoder_->GetWidth(), encoder_->GetHeight()};
+    imfill(canvas, full, 0);
+
+    const int64_t interval_us = 1000000 / config_.fps;
+    int64_t start_us = VideoFrame::NowUs();
+    uint64_t index = 0;
+    while (running_)
+    {
+        int64_t due_us = start_us + (int64_t)index * interval_us;
+        int64_t now_us = VideoFrame::NowUs();
+        if (due_us > now_us)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(due_us - now_us));
+        }
+        else if (now_us - due_us > interval_us)
+        {
+            // 拼接或编码跟不上时跳过落下的帧，时间戳仍按帧序号等间隔
+            index = (now_us - start_us) / interval_us;
+        }
+
+        for (auto &tile : tiles_)
+        {
+            VideoFramePtr frame;
+            if (tile.slot->takeNewer(tile.seen, frame))
+            {
+                composeTile(tile, frame, canvas);
+                tile_updates_++;
+            }
+            else
+            {
+                tile_reuses_++;
+            }
+        }
+
+        int64_t pts = (int64_t)(index * 1000 / config_.fps);
+        if (frames_ == 0)
+        {
+            // SPS/PPS 单独送入，先于第一帧
+            char header[1024];
+            int header_size = encoder_->GetHeader(header, sizeof(header));
+            if (header_size > 0)
+            {
+                inputVideo(media_, codec_, header, header_size, pts);
+            }
+        }
+        const char *enc_data = nullptr;
+        int enc_size = encoder_->Encode(mpp_frame, &enc_data);
+        if (enc_size > 0)
+        {
+            inputVideo(media_, codec_, enc_data, enc_size, pts);
+            frames_++;
+        }
+        index++;
+    }
+    printf("拼接输出线程已退出，共编码 %llu 帧\n", (unsigned long long)frames_.load());
+}
+
+void MosaicCompositor::reportStatus()
+{
+    if (!running_)
+    {
+        return;
+    }
+    int64_t now_us = VideoFrame::NowUs();
+    uint64_t frames = frames_;
+    uint64_t updates = tile_updates_;
+    uint64_t reuses = tile_reuses_;
+    double seconds = last_report_us_ > 0 ? (now_us - last_report_us_) / 1e6 : 0;
+    uint64_t tiles = (updates - last_updates_) + (reuses - last_reuses_);
+    printf("拼接输出: %s/%s, %dx%d 网格, 编码 %.1f fps, 格子重画 %.0f%%（其余沿用上一帧）\n",
+           config_.app.c_str(), config_.stream.c_str(), grid_, grid_,
+           seconds > 0 ? (frames - last_frames_) / seconds : 0.0,
+           tiles > 0 ? (updates - last_updates_) * 100.0 / tiles : 0.0);
+    last_frames_ = frames;
+    last_updates_ = updates;
+    last_reuses_ = reuses;
+    last_report_us_ = now_us;
+}
@@ -0,0 +1,110 @@
+#ifndef MOSAIC_COMPOSITOR_HPP
+#define MOSAIC_COMPOSITOR_HPP
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "mk_mediakit.h"
+#include "im2d.h"
+#include "rga.h"
+#include "config/config.hpp"
+#include "types/video_frame.h"
+#include "rkmedia/utils/mpp_encoder.h"
+
+/**
+ * @brief 一路流交给拼接线程的最新一帧
+ *
+ * 推流线程每输出一帧就替换一次，只保留最新的一帧引用，不拷贝像素；
+ * 拼接线程按版本号判断有没有新帧，没有新帧的格子不重新拼接。
+ */
+class MosaicSlot {
+public:
+    void publish(const VideoFramePtr &frame) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        frame_ = frame;
+        version_++;
+    }
+
+    // 流停止时清空，格子显示为黑色
+    void clear() { publish(nullptr); }
+
+    // 版本号与 seen 不同时返回 true，并取出当前帧（可能为空）
+    bool takeNewer(uint64_t &seen, VideoFramePtr &frame) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (version_ == seen) {
+            return false;
+        }
+        seen = version_;
+        frame = frame_;
+        return true;
+    }
+
+private:
+    std::mutex mutex_;
+    VideoFramePtr frame_;
+    uint64_t version_ = 0;
+};
+
+/**
+ * @brief 多路拼接输出
+ *
+ * 各路推流线程把带检测框的 RGB 帧交到各自的 MosaicSlot，拼接线程按固定帧率：
+ * 有新帧的格子用 RGA 一次完成缩放和 RGB->NV12 转换，直接写进编码器的输入缓冲区；
+ * 没有新帧的格子不动，编码器输入缓冲区在两帧之间保持原内容，相当于复用上一次的拼接结果。
+ * 拼接画面编码一次，作为独立的 mk_media 发布。
+ */
+class MosaicCompositor {
+public:
+    // stream_ids 为按格子顺序排列的流 id，超出网格的流不参与拼接
+    MosaicCompositor(const MosaicConfig &config, const std::vector<std::string> &stream_ids);
+    ~MosaicCompositor();
+
+    // 流 id 对应的格子，不参与拼接时返回 nullptr
+    std::shared_ptr<MosaicSlot> slot(const std::string &stream_id) const;
+
+    bool start();
+    void stop();
+    void reportStatus();
+
+private:
+    struct Tile {
+        std::string stream_id;
+        std::shared_ptr<MosaicSlot> slot;
+        uint64_t seen = 0;
+        im_rect cell;                // 格子在画面中的位置
+        im_rect content;             // 按源画面比例缩放后实际占用的区域，比例不同时四周留黑边
+        int src_width = 0;
+        int src_height = 0;
+    };
+
+    void run();
+    bool initOutput();
+    void releaseOutput();
+    void composeTile(Tile &tile, const VideoFramePtr &frame, rga_buffer_t &canvas);
+
+    MosaicConfig config_;
+    int grid_;
+    std::vector<Tile> tiles_;
+    std::map<std::string, std::shared_ptr<MosaicSlot>> slots_;
+
+    MppEncoder *encoder_ = nullptr;
+    mk_media media_ = nullptr;
+    int codec_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+
+    // 统计：编码帧数、重新拼接的格子数、沿用上次内容的格子数
+    std::atomic<uint64_t> frames_{0};
+    std::atomic<uint64_t> tile_updates_{0};
+    std::atomic<uint64_t> tile_reuses_{0};
+    uint64_t last_frames_ = 0;
+    uint64_t last_updates_ = 0;
+    uint64_t last_reuses_ = 0;
+    int64_t last_report_us_ = 0;
+};
+
+#endif // MOSAIC_COMPOSITOR_HPP
@@ -0,0 +1,138 @@
+#include "nalUtils.hpp"
+
+// 返回 pos 处起始码的长度(3/4)，不是起始码时返回 0
+static size_t startCodeAt(const uint8_t *data, size_t len, size_t pos) {
+    if (pos + 3 <= len && data[pos] == 0 && data[pos + 1] == 0) {
+        if (data[pos + 2] == 1) {
+            return 3;
+        }
+        if (pos + 4 <= len && data[pos + 2] == 0 && data[pos + 3] == 1) {
+            return 4;
+        }
+    }
+    return 0;
+}
+
+size_t splitAnnexB(const uint8_t *data, size_t len, int codec, std::vector<NalUnit> &nals) {
+    nals.clear();
+    if (data == nullptr) {
+        return 0;
+    }
+    size_t pos = 0;
+    size_t sc = 0;
+    while (pos < len && (sc = startCodeAt(data, len, pos)) == 0) {
+        ++pos;
+    }
+    while (pos < len && sc > 0) {
+        size_t begin = pos + sc;
+        size_t next = begin;
+        sc = 0;
+        while (next < len && (sc = startCodeAt(data, len, next)) == 0) {
+            ++next;
+        }
+        if (next > begin) {
+            NalUnit nal;
+            nal.data = data + begin;
+            nal.size = next - begin;
+            nal.type = nalType(codec, nal.data, nal.size);
+            nals.push_back(nal);
+        }
+        pos = next;
+    }
+    return nals.size();
+}
+
+int nalType(int codec, const uint8_t *nal, size_t size) {
+    if (nal == nullptr || size == 0) {
+        return -1;
+    }
+    if (codec == VIDEO_CODEC_H265) {
+        return (nal[0] >> 1) & 0x3F;
+    }
+    return nal[0] & 0x1F;
+}
+
+bool nalIsKeyFrame(int codec, int type) {
+    if (codec == VIDEO_CODEC_H265) {
+        return type >= 16 && type <= 21; // BLA/IDR/CRA
+    }
+    return type == 5;
+}
+
+bool nalIsParameterSet(int codec, int type) {
+    if (codec == VIDEO_CODEC_H265) {
+        return type >= 32 && type <= 34;
+    }
+    return type == 7 || type == 8;
+}
+
+bool nalIsSlice(int codec, int type) {
+    if (codec == VIDEO_CODEC_H265) {
+        return type >= 0 && type <= 31;
+    }
+    return type >= 1 && type <= 5;
+}
+
+bool nalIsDisposable(int codec, const uint8_t *nal, size_t size) {
+    int type = nalType(codec, nal, size);
+    if (!nalIsSlice(codec, type)) {
+        return false;
+    }
+    if (codec == VIDEO_CODEC_H265) {
+        // 0~14 中的偶数类型为子层非参考图像
+        return type <= 14 && (type % 2) == 0;
+    }
+    return ((nal[0] >> 5) & 0x03) == 0;
+}
+
+bool nalIsFirstSlice(int codec, const uint8_t *nal, size_t size) {
+    int type = nalType(codec, nal, size);
+    if (!nalIsSlice(codec, type)) {
+        return false;
+    }
+    if (codec == VIDEO_CODEC_H265) {
+        return size > 2 && (nal[2] & 0x80) != 0;
+    }
+    // first_mb_in_slice 为 ue(v)，值为 0 时编码为单个 1 比特
+    return size > 1 && (nal[1] & 0x80) != 0;
+}
+
+bool nalStartsAccessUnit(int codec, int type) {
+    if (codec == VIDEO_CODEC_H265) {
+        // VPS/SPS/PPS/AUD/前缀SEI 及保留的前缀类型，后缀SEI(40)属于当前访问单元
+        return (type >= 32 && type <= 39) || (type >= 41 && type <= 44) || (type >= 48 && type <= 55);
+    }
+    // SEI/SPS/PPS/AUD 及 14~18 的前缀类型
+    return (type >= 6 && type <= 9) || (type >= 14 && type <= 18);
+}
+
+int guessCodec(const uint8_t *data, size_t len) {
+    std::vector<NalUnit> nals;
+    splitAnnexB(data, len, VIDEO_CODEC_UNKNOWN, nals);
+    for (const auto &nal : nals) {
+        uint8_t b0 = nal.data[0];
+        if ((b0 & 0x80) != 0) {
+            continue; // forbidden_zero_bit
+        }
+        int h265_type = (b0 >> 1) & 0x3F;
+        if (nal.size >= 2 && h265_type >= 32 && h265_type <= 34 && (b0 & 0x01) == 0 && nal.data[1] == 0x01) {
+            return VIDEO_CODEC_H265;
+        }
+        int h264_type = b0 & 0x1F;
+        if ((h264_type == 7 || h264_type == 8) && (b0 & 0x60) != 0) {
+            return VIDEO_CODEC_H264;
+        }
+    }
+    return VIDEO_CODEC_UNKNOWN;
+}
+
+const char *codecName(int codec) {
+    switch (codec) {
+    case VIDEO_CODEC_H264:
+        return "H.264";
+    case VIDEO_CODEC_H265:
+        return "H.265";
+    default:
+        return "unknown";
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef NAL_UTILS_HPP
+#define NAL_UTILS_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// 编码类型，数值与 av_worker_context_t::video_type 一致
+enum video_codec_e {
+    VIDEO_CODEC_UNKNOWN = 0,
+    VIDEO_CODEC_H264 = 264,
+    VIDEO_CODEC_H265 = 265,
+    VIDEO_CODEC_MJPEG = 1, // 只出现在 V4L2 摄像头输入，与 MppDecoder::Init 的取值一致
+};
+
+// Annex-B 码流中的一个 NAL，data 指向 NAL 头（不含起始码）
+struct NalUnit {
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    int type = -1;
+};
+
+/**
+ * @brief 按起始码切分 Annex-B 码流，NAL 数据不拷贝，指向原缓冲区
+ * @return NAL 个数
+ */
+size_t splitAnnexB(const uint8_t *data, size_t len, int codec, std::vector<NalUnit> &nals);
+
+// NAL 类型：H.264 为 nal_unit_type(5bit)，H.265 为 nal_unit_type(6bit)
+int nalType(int codec, const uint8_t *nal, size_t size);
+
+// IDR/IRAP 关键帧切片
+bool nalIsKeyFrame(int codec, int type);
+
+// SPS/PPS（H.265 另有 VPS）
+bool nalIsParameterSet(int codec, int type);
+
+// 视频编码层（切片）NAL
+bool nalIsSlice(int codec, int type);
+
+/**
+ * @brief 不被其他帧参考、丢弃后不影响后续解码的切片
+ * H.264 为 nal_ref_idc == 0 的切片，H.265 为子层非参考图像（TRAIL_N/TSA_N/STSA_N/RADL_N/RASL_N 等）
+ */
+bool nalIsDisposable(int codec, const uint8_t *nal, size_t size);
+
+/**
+ * @brief 访问单元(一帧)的第一个切片：H.264 为 first_mb_in_slice == 0，H.265 为 first_slice_segment_in_pic_flag
+ */
+bool nalIsFirstSlice(int codec, const uint8_t *nal, size_t size);
+
+/**
+ * @brief 出现在切片之后时标志着新访问单元开始的非切片 NAL（AUD/参数集/前缀SEI等）
+ */
+bool nalStartsAccessUnit(int codec, int type);
+
+/**
+ * @brief 从码流中的参数集推断编码类型，用于没有轨道信息的输入（如裸流文件）
+ */
+int guessCodec(const uint8_t *data, size_t len);
+
+const char *codecName(int codec);
+
+#endif // NAL_UTILS_HPP
@@ -0,0 +1,119 @@
+#ifndef OVERLOAD_SHEDDER_HPP
+#define OVERLOAD_SHEDDER_HPP
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <vector>
+#include "nalUtils.hpp"
+
+// 过载时在解码之前丢弃码流包的级别
+enum shed_level_e {
+    SHED_NONE = 0,      // 全部解码
+    SHED_NONREF = 1,    // 丢弃非参考帧，不影响其他帧解码
+    SHED_KEY_ONLY = 2,  // 只解码关键帧
+};
+
+// 配置字符串 "off"/"nonref"/"keyframes" 转换为允许的最高级别
+inline int shedLevelFromString(const std::string &s) {
+    if (s == "keyframes") {
+        return SHED_KEY_ONLY;
+    }
+    return s == "nonref" ? SHED_NONREF : SHED_NONE;
+}
+
+inline const char *shedLevelName(int level) {
+    static const char *names[] = {"全部解码", "丢弃非参考帧", "只解码关键帧"};
+    return names[level < 0 ? 0 : (level > SHED_KEY_ONLY ? SHED_KEY_ONLY : level)];
+}
+
+/**
+ * @brief 过载丢帧控制：按下游负载在解码之前丢弃码流包
+ *
+ * 负载为解码队列、推理队列的占用比例(0~1)，按码流包做指数平均。
+ * 平均负载持续偏高时升一级，持续偏低时降一级；升级快、降级慢，避免来回切换。
+ * 只解码关键帧时丢掉的 P 帧被后续帧参考，降级后继续丢到下一个关键帧再恢复解码。
+ * 只在拉流回调（ZLMediaKit 网络线程）中调用，级别和丢弃计数可在其他线程读取。
+ */
+class OverloadShedder {
+public:
+    void setMaxLevel(int level) { max_level_ = level; }
+    int maxLevel() const { return max_level_; }
+    int level() const { return level_; }
+    uint64_t dropped() const { return dropped_; }
+
+    /**
+     * @brief 更新负载，级别变化时返回 true
+     */
+    bool update(int64_t now_us, double load) {
+        if (max_level_ <= SHED_NONE) {
+            return false;
+        }
+        load_ = load_ * 0.9 + load * 0.1;
+        int64_t since = now_us - last_change_us_;
+        int level = level_;
+        if (load_ > 0.7 && level_ < max_level_ && since > 1000000) {
+            level = level_ + 1;
+        } else if (load_ < 0.3 && level_ > SHED_NONE && since > 3000000) {
+            level = level_ - 1;
+        }
+        if (level == level_) {
+            return false;
+        }
+        if (level_ == SHED_KEY_ONLY) {
+            // 离开只解码关键帧的状态，等下一个关键帧再恢复
+            wait_key_ = true;
+        }
+        level_ = level;
+        last_change_us_ = now_us;
+        return true;
+    }
+
+    /**
+     * @brief 判断一个码流包是否丢弃，参数集和关键帧总是保留
+     */
+    bool shouldDrop(int codec, const uint8_t *data, size_t size, bool key, bool config) {
+        if (config) {
+            return false;
+        }
+        if (key) {
+            wait_key_ = false;
+            return false;
+        }
+        bool drop = false;
+        if (level_ >= SHED_KEY_ONLY || wait_key_) {
+            drop = true;
+        } else if (level_ == SHED_NONREF) {
+            // 一个包里所有切片都不被参考才丢，包里只有 SEI 等非切片 NAL 时保留
+            nals_.clear();
+            splitAnnexB(data, size, codec, nals_);
+            bool has_slice = false;
+            drop = true;
+            for (const auto &nal : nals_) {
+                if (nalIsSlice(codec, nal.type)) {
+                    has_slice = true;
+                    if (!nalIsDisposable(codec, nal.data, nal.size)) {
+                        drop = false;
+                        break;
+                    }
+                }
+            }
+            drop = drop && has_slice;
+        }
+        if (drop) {
+            dropped_++;
+        }
+        return drop;
+    }
+
+private:
+    int max_level_ = SHED_NONE;
+    std::atomic<int> level_{SHED_NONE};
+    double load_ = 0;
+    int64_t last_change_us_ = 0;
+    bool wait_key_ = false;
+    std::atomic<uint64_t> dropped_{0};
+    std::vector<NalUnit> nals_;
+};
+
+#endif // OVERLOAD_SHEDDER_HPP
@@ -0,0 +1,89 @@
+#ifndef PACKET_RING_HPP
+#define PACKET_RING_HPP
+
+#include <stdio.h>
+#include <vector>
+#include "utils/safeMemory.hpp"
+
+/**
+ * @brief 编码输出包的预分配缓冲环，只在推流线程内使用，不加锁
+ *
+ * 槽位按对齐内存一次性分配并循环复用，容量根据实际编码输出的最大包长动态调整
+ * （留 25% 余量并按 4K 取整），只增不减，避免每帧按原始帧大小 malloc/free。
+ * 一个槽位在被再次取用之前（slot_count 帧内）保持有效。
+ */
+class PacketRing {
+public:
+    PacketRing(size_t slot_count, size_t initial_size, size_t alignment = 64)
+        : alignment_(alignment), target_size_(roundUp(initial_size)) {
+        for (size_t i = 0; i < (slot_count ? slot_count : 1); ++i) {
+            slots_.emplace_back(target_size_, alignment_);
+        }
+    }
+
+    /**
+     * @brief 取下一个槽位，容量不足目标大小时先扩容
+     * @param capacity 回写槽位容量
+     */
+    char *acquire(size_t &capacity) {
+        AlignedBuffer &slot = slots_[next_];
+        next_ = (next_ + 1) % slots_.size();
+        if (slot.size() < target_size_) {
+            slot = AlignedBuffer(target_size_, alignment_);
+            grow_count_++;
+        }
+        capacity = slot.size();
+        return slot.as_char();
+    }
+
+    /**
+     * @brief 记录一次实际输出长度（无论是否写入本环），用于调整槽位大小
+     */
+    void record(size_t len) {
+        if (len == 0) {
+            return;
+        }
+        packets_++;
+        total_bytes_ += len;
+        if (len > max_size_) {
+            max_size_ = len;
+        }
+        size_t wanted = roundUp(max_size_ + max_size_ / 4);
+        if (wanted > target_size_) {
+            target_size_ = wanted;
+        }
+    }
+
+    /**
+     * @brief 编码器报告缓冲区不足时调用，下一次取用的槽位至少为 needed
+     */
+    void reserve(size_t needed) {
+        size_t wanted = roundUp(needed + needed / 4);
+        if (wanted > target_size_) {
+            target_size_ = wanted;
+        }
+    }
+
+    void printStats(const char *name) const {
+        printf("[%s] 编码包: %zu 个, 平均 %.1fKB, 最大 %.1fKB, 槽位 %zu x %.1fKB, 扩容 %zu 次\n",
+               name, packets_, packets_ ? total_bytes_ / 1024.0 / packets_ : 0.0, max_size_ / 1024.0,
+               slots_.size(), target_size_ / 1024.0, grow_count_);
+    }
+
+private:
+    static size_t roundUp(size_t size) {
+        const size_t page = 4096;
+        return (size + page - 1) / page * page;
+    }
+
+    std::vector<AlignedBuffer> slots_;
+    size_t next_ = 0;
+    size_t alignment_;
+    size_t target_size_;
+    size_t max_size_ = 0;
+    size_t packets_ = 0;
+    size_t total_bytes_ = 0;
+    size_t grow_count_ = 0;
+};
+
+#endif // PACKET_RING_HPP
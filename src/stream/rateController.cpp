@@ -0,0 +1,115 @@
+#include "rateController.hpp"
+#include <algorithm>
+
+// 连续多少个无拥塞窗口后向上恢复一档，恢复比降档慢，避免在拥塞边缘来回振荡
+static const int kRecoverWindows = 5;
+
+RateController::RateController(const RateControlParams &params, int bps, int fps)
+    : params_(params)
+{
+    max_bps_ = bps > 0 ? bps : 1;
+    min_bps_ = params.min_kbps > 0 ? std::min(params.min_kbps * 1000, max_bps_) : max_bps_ / 4;
+    max_fps_ = fps > 0 ? fps : 25;
+    min_fps_ = params.min_fps > 0 ? std::min(params.min_fps, max_fps_) : std::max(1, max_fps_ / 2);
+    bps_ = max_bps_;
+    fps_ = max_fps_;
+    gop_ = baseGop(fps_);
+}
+
+int RateController::baseGop(int fps) const
+{
+    if (static_scene_ && params_.max_gop_sec > 0)
+    {
+        return fps * params_.max_gop_sec;
+    }
+    // 配置的 GOP 按帧数给出，降帧后保持相同的时长
+    return params_.gop > 0 ? std::max(1, params_.gop * fps / max_fps_) : fps * 2;
+}
+
+void RateController::addFrame(size_t bytes, bool key)
+{
+    window_bytes_ += bytes;
+    double &avg = key ? i_avg_ : p_avg_;
+    avg = avg == 0 ? bytes : avg * 0.9 + bytes * 0.1;
+}
+
+bool RateController::evaluate(int64_t now_us, int64_t lag_ms, int backlog, Decision &decision)
+{
+    if (window_begin_us_ == 0)
+    {
+        window_begin_us_ = now_us;
+        return false;
+    }
+    int64_t elapsed_us = now_us - window_begin_us_;
+    if (elapsed_us < 1000000)
+    {
+        return false;
+    }
+    int64_t measured_bps = (int64_t)(window_bytes_ * 8 * 1000000 / elapsed_us);
+    window_begin_us_ = now_us;
+    window_bytes_ = 0;
+
+    int bps = bps_;
+    int fps = fps_;
+    bool congested = lag_ms > params_.lag_high_ms || backlog > params_.backlog_high;
+    if (congested)
+    {
+        clear_windows_ = 0;
+        if (bps_ > min_bps_)
+        {
+            int64_t base = measured_bps > 0 ? std::min<int64_t>(bps_, measured_bps) : bps_;
+            bps = std::max<int64_t>(min_bps_, base * 3 / 4);
+        }
+        else if (fps_ > min_fps_)
+        {
+            fps = std::max(min_fps_, fps_ * 3 / 4);
+        }
+    }
+    else if (lag_ms < params_.lag_high_ms / 2 && backlog <= 1)
+    {
+        if (++clear_windows_ >= kRecoverWindows)
+        {
+            clear_windows_ = 0;
+            if (fps_ < max_fps_)
+            {
+                fps = std::min(max_fps_, fps_ + std::max(1, max_fps_ / 8));
+            }
+            else if (bps_ < max_bps_)
+            {
+                bps = std::min<int64_t>(max_bps_, (int64_t)bps_ * 9 / 8);
+            }
+        }
+    }
+    else
+    {
+        clear_windows_ = 0;
+    }
+
+    // P/I 大小比带滞回，避免在阈值附近反复切换 GOP
+    if (params_.max_gop_sec > 0 && i_avg_ > 0 && p_avg_ > 0)
+    {
+        double ratio = p_avg_ / i_avg_;
+        if (!static_scene_ && ratio < 0.05)
+        {
+            static_scene_ = true;
+        }
+        else if (static_scene_ && ratio > 0.1)
+        {
+            static_scene_ = false;
+        }
+    }
+    int gop = baseGop(fps);
+
+    if (bps == bps_ && fps == fps_ && gop == gop_)
+    {
+        return false;
+    }
+    bps_ = bps;
+    fps_ = fps;
+    gop_ = gop;
+    adjustments_++;
+    decision.bps = bps_;
+    decision.fps = fps_;
+    decision.gop = gop_;
+    return true;
+}
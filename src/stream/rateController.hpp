@@ -0,0 +1,76 @@
+#ifndef RATE_CONTROLLER_HPP
+#define RATE_CONTROLLER_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 输出码率控制配置
+struct RateControlParams {
+    int bitrate_kbps = 0;  // 目标码率，0 表示按分辨率估算
+    int gop = 0;           // GOP 帧数，0 表示 2 秒
+    bool adaptive = false; // 按输出拥塞和画面复杂度自动调整
+    int min_kbps = 0;      // 自动降码率的下限，0 表示目标码率的 1/4
+    int min_fps = 0;       // 自动降帧率的下限，0 表示源帧率的一半
+    int max_gop_sec = 4;   // 静止画面可延长到的 GOP 时长(秒)，0 表示不调整 GOP
+    int lag_high_ms = 200; // 输出线程处理延迟超过该值视为拥塞
+    int backlog_high = 3;  // 等待编码的帧数超过该值视为拥塞
+};
+
+/**
+ * @brief 输出码率自适应：每秒评估一次，拥塞时先降码率再降帧率，恢复时先升帧率再升码率
+ *
+ * 拥塞信号有两个：ZLMediaKit 输出线程处理一个任务的排队延迟（发布侧背压），
+ * 以及推流线程待编码的帧数（编码侧跟不上）。降码率以上一秒的实际码率为基准，
+ * VBR 在简单画面下本来就用不满目标码率，只降目标值不会减少实际输出。
+ * 画面复杂度用 P 帧与 I 帧的平均大小之比衡量，静止画面 I 帧占了大部分码率，延长 GOP。
+ * 只在推流线程中使用，不加锁。
+ */
+class RateController {
+public:
+    struct Decision {
+        int bps;
+        int fps;
+        int gop;
+    };
+
+    // bps/fps 为编码器初始参数，也是自动调整的上限
+    RateController(const RateControlParams &params, int bps, int fps);
+
+    // 每输出一帧调用
+    void addFrame(size_t bytes, bool key);
+
+    /**
+     * @brief 评估窗口满 1 秒时做一次决策
+     * @param lag_ms  输出线程排队延迟
+     * @param backlog 等待编码的帧数
+     * @return 需要调整编码参数时返回 true，新参数写入 decision
+     */
+    bool evaluate(int64_t now_us, int64_t lag_ms, int backlog, Decision &decision);
+
+    int bps() const { return bps_; }
+    int fps() const { return fps_; }
+    int gop() const { return gop_; }
+    uint32_t adjustments() const { return adjustments_; }
+
+private:
+    int baseGop(int fps) const;
+
+    RateControlParams params_;
+    int max_bps_;
+    int min_bps_;
+    int max_fps_;
+    int min_fps_;
+    int bps_;
+    int fps_;
+    int gop_;
+    bool static_scene_ = false;
+
+    int64_t window_begin_us_ = 0;
+    uint64_t window_bytes_ = 0;
+    double i_avg_ = 0; // I 帧平均大小(字节)，指数平均
+    double p_avg_ = 0; // P 帧平均大小
+    int clear_windows_ = 0; // 连续无拥塞的窗口数
+    uint32_t adjustments_ = 0;
+};
+
+#endif // RATE_CONTROLLER_HPP
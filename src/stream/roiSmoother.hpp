@@ -0,0 +1,100 @@
+#ifndef ROI_SMOOTHER_HPP
+#define ROI_SMOOTHER_HPP
+
+#include <algorithm>
+#include <vector>
+#include "types/yolo_datatype.h"
+
+// 编码 ROI 配置
+struct RoiParams {
+    bool enable = false;
+    int max_regions = 6;  // 目标区域个数上限，超出时合并相邻的框
+    int qp_delta = -6;    // 目标区域相对 QP
+    int bg_qp_delta = 4;  // 背景相对 QP，0 表示背景不变
+    int hold_frames = 5;  // 目标消失后区域继续保留的帧数
+    int margin = 16;      // 检测框向外扩展的像素，框抖动时目标边缘不出区域
+};
+
+/**
+ * @brief 把每帧的检测框整理成编码器的 ROI 区域
+ *
+ * 检测框逐帧跳动、偶尔漏检，直接作为 ROI 会让目标画质随帧忽高忽低。
+ * 与上一帧重叠的框视为同一目标并刷新保留时间，漏检的目标按 hold_frames 继续保留；
+ * 区域多于硬件上限时，反复合并并集面积增加最少的两个区域。
+ * 只在推流线程中使用，不加锁。
+ */
+class RoiSmoother {
+public:
+    explicit RoiSmoother(const RoiParams &params) : params_(params) {
+        if (params_.max_regions < 1) {
+            params_.max_regions = 1;
+        }
+    }
+
+    // 输入一帧检测结果（编码分辨率下的坐标），返回本帧的 ROI 矩形
+    const std::vector<cv::Rect> &update(const std::vector<Detection> &objects, int width, int height) {
+        cv::Rect frame(0, 0, width, height);
+        for (auto &held : held_) {
+            held.ttl--;
+        }
+        for (const auto &obj : objects) {
+            cv::Rect box(obj.box.x - params_.margin, obj.box.y - params_.margin,
+                         obj.box.width + params_.margin * 2, obj.box.height + params_.margin * 2);
+            box &= frame;
+            if (box.area() <= 0) {
+                continue;
+            }
+            Held *match = nullptr;
+            double best = 0.3; // IoU 阈值
+            for (auto &held : held_) {
+                double inter = (held.box & box).area();
+                double iou = inter / (held.box.area() + box.area() - inter);
+                if (iou > best) {
+                    best = iou;
+                    match = &held;
+                }
+            }
+            if (match != nullptr) {
+                match->box = box;
+                match->ttl = params_.hold_frames;
+            } else {
+                held_.push_back({box, params_.hold_frames});
+            }
+        }
+        held_.erase(std::remove_if(held_.begin(), held_.end(), [](const Held &h) { return h.ttl < 0; }), held_.end());
+
+        regions_.clear();
+        for (const auto &held : held_) {
+            regions_.push_back(held.box);
+        }
+        while ((int)regions_.size() > params_.max_regions) {
+            size_t a = 0, b = 1;
+            long best_cost = -1;
+            for (size_t i = 0; i < regions_.size(); ++i) {
+                for (size_t j = i + 1; j < regions_.size(); ++j) {
+                    long cost = (long)(regions_[i] | regions_[j]).area() - regions_[i].area() - regions_[j].area();
+                    if (best_cost < 0 || cost < best_cost) {
+                        best_cost = cost < 0 ? 0 : cost;
+                        a = i;
+                        b = j;
+                    }
+                }
+            }
+            regions_[a] |= regions_[b];
+            regions_.erase(regions_.begin() + b);
+        }
+        return regions_;
+    }
+
+private:
+    struct Held {
+        cv::Rect box;
+        int ttl;
+    };
+
+    RoiParams params_;
+    std::vector<Held> held_;
+    std::vector<cv::Rect> regions_;
+};
+
+#endif // ROI_SMOOTHER_HPP
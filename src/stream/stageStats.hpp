@@ -0,0 +1,69 @@
+#ifndef STAGE_STATS_HPP
+#define STAGE_STATS_HPP
+
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include "types/video_frame.h"
+
+/**
+ * @brief 单路流各处理阶段的累计帧数，由各阶段所在线程各自累加
+ */
+struct StageCounters {
+    std::atomic<uint64_t> demuxed{0};  // 收到/读出的码流帧
+    std::atomic<uint64_t> decoded{0};  // 解码输出的帧
+    std::atomic<uint64_t> inferred{0}; // 推流线程取到的推理结果
+    std::atomic<uint64_t> output{0};   // 送入输出媒体源的帧
+};
+
+/**
+ * @brief 按两次采样之间的增量计算各阶段帧率
+ */
+class StageFpsMeter {
+public:
+    explicit StageFpsMeter(const StageCounters &counters) : counters_(counters) { reset(); }
+
+    // 以当前时刻为起点重新计时
+    void reset() {
+        begin_us_ = last_us_ = VideoFrame::NowUs();
+        begin_ = last_ = snapshot();
+    }
+
+    // 打印上次采样以来的帧率
+    void report(const char *name) {
+        int64_t now = VideoFrame::NowUs();
+        Snapshot cur = snapshot();
+        print(name, "", last_, cur, now - last_us_);
+        last_ = cur;
+        last_us_ = now;
+    }
+
+    // 打印从 reset() 起的平均帧率
+    void summary(const char *name) const {
+        print(name, "平均", begin_, snapshot(), VideoFrame::NowUs() - begin_us_);
+    }
+
+private:
+    struct Snapshot {
+        uint64_t demuxed, decoded, inferred, output;
+    };
+
+    Snapshot snapshot() const {
+        return Snapshot{counters_.demuxed.load(), counters_.decoded.load(), counters_.inferred.load(), counters_.output.load()};
+    }
+
+    static void print(const char *name, const char *tag, const Snapshot &a, const Snapshot &b, int64_t us) {
+        double sec = us > 0 ? us / 1e6 : 1e-6;
+        printf("[%s] %s帧率(%.1fs): 读流 %.1f, 解码 %.1f, 推理 %.1f, 输出 %.1f fps\n", name, tag, sec,
+               (b.demuxed - a.demuxed) / sec, (b.decoded - a.decoded) / sec, (b.inferred - a.inferred) / sec,
+               (b.output - a.output) / sec);
+    }
+
+    const StageCounters &counters_;
+    int64_t begin_us_ = 0;
+    int64_t last_us_ = 0;
+    Snapshot begin_{};
+    Snapshot last_{};
+};
+
+#endif // STAGE_STATS_HPP
@@ -1,13 +1,48 @@
 #include "streamManager.hpp"
+#include "utils/threadAffinity.hpp"
+#include "stream/matPool.hpp"
 #include <iostream>
 #include <thread>
 #include <chrono>
 
+// 播放请求事件：不做播放鉴权，直接放行，同时通知对应的流有新观看者
+static void API_CALL on_mk_media_play_func(const mk_media_info url_info, const mk_auth_invoker invoker,
+                                           const mk_sock_info sender) {
+    RtspWorker::notifyViewerJoin(mk_media_info_get_app(url_info), mk_media_info_get_stream(url_info));
+    mk_auth_invoker_do(invoker, nullptr);
+}
+
 MultiStreamManager::MultiStreamManager(const Config& config) 
-    : config_(config), running_(false) {
+    : config_(config), running_(false), alarm_server_(nullptr) {
+    ThreadTopology::instance().configure(config_.thread_topology);
+    // 所有流的Mat内存池共享同一份帧内存预算
+    MatPoolBudget::instance().configure((size_t)config_.global.frame_memory_mb << 20,
+                                        (uint64_t)config_.global.frame_pool_idle_sec * 1000);
     printf("多路流管理器初始化完成\n");
 }
 
+std::unique_ptr<RtspWorker> MultiStreamManager::createWorker(const StreamConfig& stream) {
+    // 推理上下文在第一路流启动时创建，之后所有流共享，重启流不再重复加载模型
+    if (!infer_ctx_) {
+        infer_ctx_ = std::make_shared<InferContext>(config_.global.model_root, config_.global.thread_num);
+    }
+    auto worker = std::make_unique<RtspWorker>(
+        stream,                     // 流配置
+        config_.global,             // 全局配置
+        config_.rtsp_server.port,   // port
+        infer_ctx_,                 // 共享推理上下文
+        this->alarm_server_         // alarm_server
+    );
+    if (mosaic_) {
+        // 重启的流沿用原来的格子
+        auto slot = mosaic_->slot(stream.id);
+        if (slot) {
+            worker->setMosaicSlot(slot);
+        }
+    }
+    return worker;
+}
+
 MultiStreamManager::~MultiStreamManager() {
     stop();
 }
@@ -18,9 +53,16 @@ bool MultiStreamManager::start() {
     mk_config config;
     memset(&config, 0, sizeof(mk_config));
     config.log_mask = LOG_CONSOLE;
-    config.thread_num = 4;
+    config.thread_num = config_.thread_topology.poller_num;
     mk_env_init(&config);
+    // ZLMediaKit 的事件轮询线程由库内部创建，线程名为 "event poller N"，按线程名匹配后绑核
+    ThreadTopology::instance().placeExternalThreads(ThreadClass::Poller, "event poller");
     mk_rtsp_server_start(config_.rtsp_server.port, 0);
+    // 监听播放请求：新观看者到来时让对应的流尽快输出关键帧
+    mk_events events;
+    memset(&events, 0, sizeof(events));
+    events.on_mk_media_play = on_mk_media_play_func;
+    mk_events_listen(&events);
     
     if (config_.rtsp_server.port > 0){
         //初始化信息服务器
@@ -37,6 +79,21 @@ bool MultiStreamManager::start() {
     }
     
     printf("检测到 %zu 路启用的流\n", enabled_streams.size());
+
+    if (config_.mosaic.enable) {
+        // 拼接线程先启动，流还没出帧的格子显示为黑色
+        std::vector<std::string> mosaic_ids = config_.mosaic.streams;
+        if (mosaic_ids.empty()) {
+            for (const auto& stream : enabled_streams) {
+                mosaic_ids.push_back(stream.id);
+            }
+        }
+        mosaic_ = std::make_unique<MosaicCompositor>(config_.mosaic, mosaic_ids);
+        if (!mosaic_->start()) {
+            printf("警告: 拼接输出启动失败\n");
+            mosaic_.reset();
+        }
+    }
     
     int success_count = 0;
     for (const auto& stream : enabled_streams) {
@@ -46,16 +103,7 @@ bool MultiStreamManager::start() {
                config_.rtsp_server.port, stream.output_app.c_str(), stream.output_stream.c_str());
         
         try {
-            auto worker = std::make_unique<RtspWorker>(
-                stream.name,           // stream_name
-                stream.input_url,      // stream_url
-                config_.rtsp_server.port,  // port
-                stream.output_app,     // push_path_first
-                stream.output_stream,  // push_path_second
-                config_.global.model_root,  // model_root
-                config_.global.thread_num,  // thread_num
-                this->alarm_server_    // alarm_server
-            );
+            auto worker = createWorker(stream);
             
             worker->start();
             workers_[stream.id] = std::move(worker);
@@ -84,6 +132,10 @@ void MultiStreamManager::stop() {
     }
     
     printf("=== 停止多路流管理器 ===\n");
+
+    if (mosaic_) {
+        mosaic_->stop();
+    }
     
     for (auto& [id, worker] : workers_) {
         printf("正在停止流: %s\n", id.c_str());
@@ -96,6 +148,7 @@ void MultiStreamManager::stop() {
     }
     
     workers_.clear();
+    mosaic_.reset();
     running_ = false;
     printf("=== 多路流管理器已停止 ===\n");
 }
@@ -115,16 +168,7 @@ bool MultiStreamManager::startStream(const std::string& stream_id) {
     printf("启动单个流: %s (%s)\n", stream.id.c_str(), stream.name.c_str());
     
     try {
-        auto worker = std::make_unique<RtspWorker>(
-            stream.name,           // stream_name
-            stream.input_url,      // stream_url
-            config_.rtsp_server.port,  // port
-            stream.output_app,     // push_path_first
-            stream.output_stream,  // push_path_second
-            config_.global.model_root,  // model_root
-            config_.global.thread_num,  // thread_num
-            this->alarm_server_    // alarm_server
-        );
+        auto worker = createWorker(stream);
         
         worker->start();
         workers_[stream_id] = std::move(worker);
@@ -202,9 +246,38 @@ void MultiStreamManager::showStatus() {
         printf("  输出: rtsp://localhost:%d/%s/%s\n", 
                config_.rtsp_server.port, stream.output_app.c_str(), stream.output_stream.c_str());
         printf("  启用: %s\n", enabled ? "是" : "否");
+        auto it = workers_.find(stream.id);
+        if (it != workers_.end()) {
+            it->second->reportStageFps();
+            it->second->reportRateControl();
+            it->second->reportOverload();
+            it->second->reportLatency();
+        }
+        if (it != workers_.end() && it->second->viewerJoins() > 0) {
+            int64_t join_ms = it->second->lastJoinMs();
+            printf("  观看: %u 次播放请求，最近一次等到关键帧 %s ms\n", it->second->viewerJoins(),
+                   join_ms >= 0 ? std::to_string(join_ms).c_str() : "-");
+        }
+        if (it != workers_.end() && it->second->reconnectCount() > 0) {
+            int64_t restart_ms = it->second->lastRestartMs();
+            if (restart_ms >= 0) {
+                printf("  重连: %u 次，最近一次断流到首帧 %lld ms\n", it->second->reconnectCount(), (long long)restart_ms);
+            } else {
+                printf("  重连: %u 次，尚未恢复出帧\n", it->second->reconnectCount());
+            }
+        }
         printf("  --------------------------------\n");
     }
     
+    if (mosaic_) {
+        mosaic_->reportStatus();
+    }
+    if (infer_ctx_) {
+        infer_ctx_->GetScheduler()->printStats();
+    }
+    MatPoolBudget::instance().trimIdle();
+    MatPoolBudget::instance().printStats();
+
     auto running_streams = getRunningStreams();
     printf("总计: %zu 路流配置，%zu 路运行中\n", config_.streams.size(), running_streams.size());
 }
@@ -214,11 +287,9 @@ bool MultiStreamManager::restartStream(const std::string& stream_id) {
     printf("重启流: %s\n", stream_id.c_str());
     
     if (isStreamRunning(stream_id)) {
-        if (!stopStream(stream_id)) {
-            return false;
-        }
-        // 等待完全停止
-        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+        // 运行中的流只重连拉流，解码器、编码器和模型上下文都保留，避免冷启动
+        workers_[stream_id]->reconnect();
+        return true;
     }
     
     return startStream(stream_id);
@@ -239,6 +310,10 @@ StreamConfig MultiStreamManager::getStreamInfo(const std::string& stream_id) con
     return config_.getStreamById(stream_id);
 }
 
+void MultiStreamManager::showThreads() {
+    ThreadTopology::instance().printReport();
+}
+
 // 健康检查
 void MultiStreamManager::healthCheck() {
     printf("\n=== 流健康检查 ===\n");
@@ -30,6 +30,7 @@ public:
     std::vector<StreamConfig> getAllStreams() const;
     StreamConfig getStreamInfo(const std::string& stream_id) const;
     void showStatus();
+    void showThreads();
     
     // 健康检查
     void healthCheck();
@@ -40,8 +41,12 @@ public:
     size_t getRunningStreamCount() const { return workers_.size(); }
     
 private:
+    std::unique_ptr<RtspWorker> createWorker(const StreamConfig& stream);
+
     Config config_;
     std::map<std::string, std::unique_ptr<RtspWorker>> workers_;
     bool running_;
+    std::shared_ptr<InferContext> infer_ctx_; // 所有流共享的推理上下文
     msgServer *alarm_server_; // 消息服务器，用于发送RTSP地址和报警信息
+    std::unique_ptr<MosaicCompositor> mosaic_; // 多路拼接输出，未启用时为空
 };
\ No newline at end of file
@@ -0,0 +1,72 @@
+#ifndef TIMESTAMP_REBASER_HPP
+#define TIMESTAMP_REBASER_HPP
+
+#include <stdint.h>
+
+/**
+ * @brief 把输入码流的时间戳平移到输出流的时间轴上
+ *
+ * 输出时间戳 = 输入pts + 偏移，保持源端的帧间隔，推理耗时抖动不会反映到输出时间上。
+ * 输入时间戳回退或跳变超过 max_gap_ms（断流重连、源端重置）时重新计算偏移，
+ * 使输出在上一帧之后按平均帧间隔继续，保证输出单调递增。
+ */
+class TimestampRebaser {
+public:
+    explicit TimestampRebaser(int64_t max_gap_ms = 5000, int64_t default_interval_ms = 40)
+        : max_gap_ms_(max_gap_ms), interval_ms_(default_interval_ms) {}
+
+    /**
+     * @param pts 输入pts(ms)，小于0表示未知
+     * @param fallback_ms pts未知时使用的本地时间(ms)
+     * @return 输出时间戳(ms)
+     */
+    int64_t rebase(int64_t pts, int64_t fallback_ms) {
+        bool has_pts = pts >= 0;
+        int64_t in = has_pts ? pts : fallback_ms;
+        if (!started_) {
+            started_ = true;
+            last_has_pts_ = has_pts;
+            offset_ = -in;
+            last_in_ = in;
+            last_out_ = 0;
+            return 0;
+        }
+
+        int64_t delta = in - last_in_;
+        // pts 与本地时间不是同一时间轴，切换时同样按不连续处理
+        if (delta <= 0 || delta > max_gap_ms_ || has_pts != last_has_pts_) {
+            // 时间轴不连续，接在上一帧之后继续
+            offset_ = last_out_ + interval_ms_ - in;
+            discontinuities_++;
+        } else {
+            // 平滑估计帧间隔，只用于不连续时的衔接
+            interval_ms_ = (interval_ms_ * 7 + delta) / 8;
+            if (interval_ms_ <= 0) {
+                interval_ms_ = 1;
+            }
+        }
+
+        int64_t out = in + offset_;
+        if (out <= last_out_) {
+            out = last_out_ + 1;
+        }
+        last_in_ = in;
+        last_out_ = out;
+        last_has_pts_ = has_pts;
+        return out;
+    }
+
+    uint64_t discontinuities() const { return discontinuities_; }
+
+private:
+    int64_t max_gap_ms_;
+    int64_t interval_ms_;
+    bool started_ = false;
+    bool last_has_pts_ = false;
+    int64_t offset_ = 0;
+    int64_t last_in_ = 0;
+    int64_t last_out_ = 0;
+    uint64_t discontinuities_ = 0;
+};
+
+#endif // TIMESTAMP_REBASER_HPP
@@ -0,0 +1,280 @@
+#include "v4l2Source.hpp"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/videodev2.h>
+
+static int xioctl(int fd, unsigned long request, void *arg) {
+    int ret;
+    do {
+        ret = ioctl(fd, request, arg);
+    } while (ret < 0 && errno == EINTR);
+    return ret;
+}
+
+static uint32_t formatFromString(const std::string &s) {
+    if (s == "mjpeg" || s == "mjpg") {
+        return V4L2_PIX_FMT_MJPEG;
+    }
+    if (s == "nv12") {
+        return V4L2_PIX_FMT_NV12;
+    }
+    if (s == "yuyv") {
+        return V4L2_PIX_FMT_YUYV;
+    }
+    return 0;
+}
+
+bool isV4l2SourceUrl(const std::string &url, std::string *device) {
+    if (url.compare(0, 7, "v4l2://") != 0) {
+        return false;
+    }
+    if (device != nullptr) {
+        *device = url.substr(7);
+    }
+    return true;
+}
+
+bool V4l2Capture::isMjpeg() const {
+    return pixel_format_ == V4L2_PIX_FMT_MJPEG || pixel_format_ == V4L2_PIX_FMT_JPEG;
+}
+
+bool V4l2Capture::isYuyv() const {
+    return pixel_format_ == V4L2_PIX_FMT_YUYV;
+}
+
+const char *V4l2Capture::formatName() const {
+    switch (pixel_format_) {
+    case V4L2_PIX_FMT_MJPEG:
+    case V4L2_PIX_FMT_JPEG:
+        return "MJPEG";
+    case V4L2_PIX_FMT_NV12:
+        return "NV12";
+    case V4L2_PIX_FMT_YUYV:
+        return "YUYV";
+    default:
+        return "unknown";
+    }
+}
+
+bool V4l2Capture::negotiate(const V4l2Params &params) {
+    // 列出设备支持的格式，按配置或优先级选一个下游能直接处理的
+    std::vector<uint32_t> supported;
+    struct v4l2_fmtdesc desc;
+    memset(&desc, 0, sizeof(desc));
+    desc.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    while (xioctl(fd_, VIDIOC_ENUM_FMT, &desc) == 0) {
+        supported.push_back(desc.pixelformat);
+        desc.index++;
+    }
+    auto has = [&](uint32_t f) {
+        for (uint32_t s : supported) {
+            if (s == f) {
+                return true;
+            }
+        }
+        return false;
+    };
+    uint32_t wanted = formatFromString(params.format);
+    if (wanted == 0) {
+        // USB2.0 带宽下高分辨率高帧率只有 MJPEG 能跑满，MJPEG 交给硬件解码
+        const uint32_t order[] = {V4L2_PIX_FMT_MJPEG, V4L2_PIX_FMT_JPEG, V4L2_PIX_FMT_NV12, V4L2_PIX_FMT_YUYV};
+        for (uint32_t f : order) {
+            if (has(f)) {
+                wanted = f;
+                break;
+            }
+        }
+    }
+    if (wanted == 0 || !has(wanted)) {
+        printf("%s 不支持 %s 格式，可用 mjpeg/nv12/yuyv\n", device_.c_str(), params.format.c_str());
+        return false;
+    }
+
+    struct v4l2_format fmt;
+    memset(&fmt, 0, sizeof(fmt));
+    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    fmt.fmt.pix.width = params.width;
+    fmt.fmt.pix.height = params.height;
+    fmt.fmt.pix.pixelformat = wanted;
+    fmt.fmt.pix.field = V4L2_FIELD_NONE;
+    if (xioctl(fd_, VIDIOC_S_FMT, &fmt) < 0) {
+        printf("%s VIDIOC_S_FMT 失败: %s\n", device_.c_str(), strerror(errno));
+        return false;
+    }
+    // 驱动会把分辨率调整到最接近的档位，以返回值为准
+    pixel_format_ = fmt.fmt.pix.pixelformat;
+    width_ = fmt.fmt.pix.width;
+    height_ = fmt.fmt.pix.height;
+    bytes_per_line_ = fmt.fmt.pix.bytesperline;
+
+    struct v4l2_streamparm parm;
+    memset(&parm, 0, sizeof(parm));
+    parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    parm.parm.capture.timeperframe.numerator = 1;
+    parm.parm.capture.timeperframe.denominator = params.fps > 0 ? params.fps : 30;
+    xioctl(fd_, VIDIOC_S_PARM, &parm);
+    fps_ = params.fps > 0 ? params.fps : 30;
+    if (xioctl(fd_, VIDIOC_G_PARM, &parm) == 0 && parm.parm.capture.timeperframe.numerator > 0) {
+        fps_ = parm.parm.capture.timeperframe.denominator / parm.parm.capture.timeperframe.numerator;
+    }
+    return true;
+}
+
+bool V4l2Capture::open(const std::string &device, const V4l2Params &params) {
+    close();
+    device_ = device;
+    fd_ = ::open(device.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd_ < 0) {
+        printf("无法打开摄像头 %s: %s\n", device.c_str(), strerror(errno));
+        return false;
+    }
+    struct v4l2_capability cap;
+    memset(&cap, 0, sizeof(cap));
+    if (xioctl(fd_, VIDIOC_QUERYCAP, &cap) < 0 || !(cap.device_caps & V4L2_CAP_VIDEO_CAPTURE) ||
+        !(cap.device_caps & V4L2_CAP_STREAMING)) {
+        // 多平面设备（ISP 等）走厂商的采集接口，这里只处理 USB 摄像头这类单平面设备
+        printf("%s 不是单平面视频采集设备\n", device.c_str());
+        close();
+        return false;
+    }
+    if (!negotiate(params)) {
+        close();
+        return false;
+    }
+
+    struct v4l2_requestbuffers req;
+    memset(&req, 0, sizeof(req));
+    req.count = params.buffers > 1 ? params.buffers : 2;
+    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    req.memory = V4L2_MEMORY_MMAP;
+    if (xioctl(fd_, VIDIOC_REQBUFS, &req) < 0 || req.count < 2) {
+        printf("%s 申请缓冲区失败: %s\n", device.c_str(), strerror(errno));
+        close();
+        return false;
+    }
+    buffers_.resize(req.count);
+    for (uint32_t i = 0; i < req.count; ++i) {
+        struct v4l2_buffer buf;
+        memset(&buf, 0, sizeof(buf));
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = i;
+        if (xioctl(fd_, VIDIOC_QUERYBUF, &buf) < 0) {
+            printf("%s VIDIOC_QUERYBUF 失败: %s\n", device.c_str(), strerror(errno));
+            close();
+            return false;
+        }
+        void *data = mmap(nullptr, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, buf.m.offset);
+        if (data == MAP_FAILED) {
+            printf("%s mmap 失败: %s\n", device.c_str(), strerror(errno));
+            close();
+            return false;
+        }
+        buffers_[i].data = data;
+        buffers_[i].length = buf.length;
+
+        // 导出为 dma-buf，驱动不支持时下游退回按虚拟地址访问
+        struct v4l2_exportbuffer exp;
+        memset(&exp, 0, sizeof(exp));
+        exp.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        exp.index = i;
+        exp.flags = O_RDONLY | O_CLOEXEC;
+        if (xioctl(fd_, VIDIOC_EXPBUF, &exp) == 0) {
+            buffers_[i].fd = exp.fd;
+        }
+    }
+    for (uint32_t i = 0; i < req.count; ++i) {
+        struct v4l2_buffer buf;
+        memset(&buf, 0, sizeof(buf));
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = i;
+        if (xioctl(fd_, VIDIOC_QBUF, &buf) < 0) {
+            printf("%s VIDIOC_QBUF 失败: %s\n", device.c_str(), strerror(errno));
+            close();
+            return false;
+        }
+    }
+    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (xioctl(fd_, VIDIOC_STREAMON, &type) < 0) {
+        printf("%s VIDIOC_STREAMON 失败: %s\n", device.c_str(), strerror(errno));
+        close();
+        return false;
+    }
+    streaming_ = true;
+    return true;
+}
+
+void V4l2Capture::close() {
+    if (fd_ < 0) {
+        return;
+    }
+    if (streaming_) {
+        enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        xioctl(fd_, VIDIOC_STREAMOFF, &type);
+        streaming_ = false;
+    }
+    for (auto &b : buffers_) {
+        if (b.fd >= 0) {
+            ::close(b.fd);
+        }
+        if (b.data != nullptr) {
+            munmap(b.data, b.length);
+        }
+    }
+    buffers_.clear();
+    ::close(fd_);
+    fd_ = -1;
+}
+
+int V4l2Capture::dequeue(V4l2Frame &frame, int timeout_ms) {
+    if (fd_ < 0) {
+        return -1;
+    }
+    struct pollfd pfd;
+    pfd.fd = fd_;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    int ret = poll(&pfd, 1, timeout_ms);
+    if (ret == 0 || (ret < 0 && errno == EINTR)) {
+        return 0;
+    }
+    if (ret < 0 || (pfd.revents & (POLLERR | POLLHUP | POLLNVAL))) {
+        return -1;
+    }
+    struct v4l2_buffer buf;
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    if (xioctl(fd_, VIDIOC_DQBUF, &buf) < 0) {
+        return errno == EAGAIN ? 0 : -1;
+    }
+    const Buffer &b = buffers_[buf.index];
+    frame.index = buf.index;
+    frame.data = (const uint8_t *)b.data;
+    frame.size = buf.bytesused;
+    frame.length = b.length;
+    frame.fd = b.fd;
+    frame.pts_us = (int64_t)buf.timestamp.tv_sec * 1000000 + buf.timestamp.tv_usec;
+    if (buf.flags & V4L2_BUF_FLAG_ERROR) {
+        // 传输出错的帧（USB 丢包）直接归还
+        release(frame);
+        return 0;
+    }
+    return 1;
+}
+
+bool V4l2Capture::release(const V4l2Frame &frame) {
+    struct v4l2_buffer buf;
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = frame.index;
+    return xioctl(fd_, VIDIOC_QBUF, &buf) == 0;
+}
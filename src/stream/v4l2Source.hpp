@@ -0,0 +1,85 @@
+#ifndef V4L2_SOURCE_HPP
+#define V4L2_SOURCE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// V4L2 摄像头采集参数，驱动不支持时按驱动返回的最接近值
+struct V4l2Params {
+    int width = 1280;
+    int height = 720;
+    int fps = 30;
+    std::string format = "auto"; // "auto" 优先 MJPEG，其次 NV12、YUYV; 也可指定 "mjpeg"/"nv12"/"yuyv"
+    int buffers = 4;             // 驱动缓冲区个数
+};
+
+// 驱动填好的一帧，用完后调用 V4l2Capture::release 归还
+struct V4l2Frame {
+    int index = -1;
+    const uint8_t *data = nullptr; // mmap 地址
+    size_t size = 0;               // 有效数据长度（MJPEG 每帧不同）
+    size_t length = 0;             // 缓冲区总长度
+    int fd = -1;                   // VIDIOC_EXPBUF 导出的 dma-buf，驱动不支持导出时为 -1
+    int64_t pts_us = 0;            // 驱动给出的采集时间
+};
+
+/**
+ * @brief 判断输入地址是否为 V4L2 设备（"v4l2:///dev/video0"）
+ * @param device 返回设备路径
+ */
+bool isV4l2SourceUrl(const std::string &url, std::string *device = nullptr);
+
+/**
+ * @brief V4L2 单平面 mmap 采集
+ *
+ * 缓冲区由驱动分配，映射到用户态的同时导出为 dma-buf，下游 RGA/MPP 按 fd 直接读取
+ * 驱动缓冲区，采集路径上没有 CPU 拷贝。帧在 release 之前不会被驱动覆盖。
+ * 只在采集线程中使用，不加锁。
+ */
+class V4l2Capture {
+public:
+    ~V4l2Capture() { close(); }
+
+    bool open(const std::string &device, const V4l2Params &params);
+    void close();
+
+    /**
+     * @brief 等待下一帧
+     * @return 1 取到一帧；0 超时；-1 设备出错（拔出等），需要重新打开
+     */
+    int dequeue(V4l2Frame &frame, int timeout_ms);
+    bool release(const V4l2Frame &frame);
+
+    uint32_t pixelFormat() const { return pixel_format_; }
+    bool isMjpeg() const;
+    bool isYuyv() const;
+    const char *formatName() const;
+    int width() const { return width_; }
+    int height() const { return height_; }
+    int bytesPerLine() const { return bytes_per_line_; }
+    int fps() const { return fps_; }
+    bool dmabufExported() const { return !buffers_.empty() && buffers_[0].fd >= 0; }
+
+private:
+    struct Buffer {
+        void *data = nullptr;
+        size_t length = 0;
+        int fd = -1;
+    };
+
+    bool negotiate(const V4l2Params &params);
+
+    int fd_ = -1;
+    std::string device_;
+    uint32_t pixel_format_ = 0;
+    int width_ = 0;
+    int height_ = 0;
+    int bytes_per_line_ = 0;
+    int fps_ = 0;
+    bool streaming_ = false;
+    std::vector<Buffer> buffers_;
+};
+
+#endif // V4L2_SOURCE_HPP
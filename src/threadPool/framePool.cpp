@@ -1,66 +1,128 @@
 #include "framePool.hpp"
 #include <atomic>
+#include <stdexcept>
 #include "draw/cv_draw.h"
+#include "utils/threadAffinity.hpp"
+
+
+InferContext::InferContext(const std::string model_path, const int ctx_num) {
+    //每个推理上下文加载一个模型，个别加载失败时少开调度线程
+    for (int i = 0; i < ctx_num; i++) {
+        try {
+            auto model = std::make_shared<Yolov5>();
+            if (model->LoadModel(model_path.c_str()) != NN_SUCCESS) {
+                std::cerr << "Failed to load model " << i << " from " << model_path << std::endl;
+                continue;
+            }
+            this->models_.push_back(model);
+        } catch (const std::exception &e) {
+            std::cerr << "Error loading model " << i << ": " << e.what() << std::endl;
+        }
+    }
+    if (this->models_.empty()) {
+        //一个模型都没有时不能调度，交给创建流的一方报告失败，下次创建流时重试
+        throw std::runtime_error("no inference model loaded from " + model_path);
+    }
+    //调度线程数与模型数一致，线程编号即模型编号
+    this->scheduler_ = std::make_unique<InferScheduler>(this->models_.size(), [](int worker_id) {
+        ThreadTopology::instance().placeCurrentThread(ThreadClass::Infer, "infer_" + std::to_string(worker_id));
+    });
+}
+
+InferContext::~InferContext() {
+    //先停调度线程，再释放模型
+    this->scheduler_.reset();
+    this->models_.clear();
+}
+
+std::shared_ptr<Yolov5> InferContext::GetModel(int worker_id) {
+    return this->models_.at(worker_id);
+}
 
 
 framePool::framePool(const std::string model_path, const int thread_num) {
   this->thread_num_ = thread_num;
   this->model_path_ = model_path;
+  this->infer_ctx_ = std::make_shared<InferContext>(model_path, thread_num);
+  this->Init();
+}
+
+framePool::framePool(std::shared_ptr<InferContext> infer_ctx, const std::string stream_name,
+                     int weight, int priority, size_t queue_size) {
+  this->infer_ctx_ = infer_ctx;
+  this->stream_name_ = stream_name;
+  this->weight_ = weight;
+  this->priority_ = priority;
+  this->queue_size_ = queue_size;
   this->Init();
 }
 
 
 void framePool::Init() {
-    try{
-        //配置n个线程
-        this->pool_ = std::make_shared<ThreadPool>(this->thread_num_);
-        //每个线程加载一个模型
-        for (int i = 0; i < this->thread_num_; i++) {
-            auto model = std::make_shared<Yolov5>();
-            model->LoadModel(this->model_path_.c_str());
-            //将模型添加到线程池中
-            this->models_.push_back(model);
-        }
-    }catch (const std::exception &e) {
-        std::cerr << "Error initializing framePool: " << e.what() << std::endl;
-    }
+    this->stream_handle_ = this->infer_ctx_->GetScheduler()->registerStream(
+        this->stream_name_, this->weight_, this->priority_, this->queue_size_);
 }
 
 void framePool::DeInit() {
-    this->pool_.reset();
-    this->models_.clear();
+    if (this->stream_handle_ >= 0) {
+        //等待本流正在执行的推理结束，之后任务中捕获的this不再被访问
+        this->infer_ctx_->GetScheduler()->unregisterStream(this->stream_handle_);
+        this->stream_handle_ = -1;
+    }
 }
 
-void framePool::inferenceThread(std::shared_ptr<cv::Mat> src){
-    pool_->enqueue([this, src]() {
+void framePool::inferenceThread(VideoFramePtr frame, bool run_model){
+    this->infer_ctx_->GetScheduler()->submit(this->stream_handle_, [this, frame, run_model](int worker_id) {
         try {
             // 检查输入图像的有效性
-            if (!src || src->empty() || src->data == nullptr) {
+            if (!frame || !frame->valid() || frame->mat->empty()) {
                 std::cerr << "Invalid input image in inference thread" << std::endl;
                 return;
             }
-            
-            auto model_id = this->get_model_id(); // 获取模型ID
 
-            auto model = this->models_[model_id];
-            auto objects = std::make_shared<std::vector<Detection>>();
-            model->Run(*src, *objects); // 注意Run参数类型
-            DrawDetections(*src, *objects);
+            frame->infer_begin_us = VideoFrame::NowUs();
+            std::shared_ptr<std::vector<Detection>> objects;
+            if (run_model) {
+                auto model = this->infer_ctx_->GetModel(worker_id); // 调度线程独占的模型
+                objects = std::make_shared<std::vector<Detection>>();
+                model->Run(*frame->mat, *objects); // 注意Run参数类型
+            } else {
+                std::lock_guard<std::mutex> lock(this->image_results_mutex_);
+                objects = this->last_objects_ ? this->last_objects_ : std::make_shared<std::vector<Detection>>();
+            }
+            if (this->draw_detections_) {
+              DrawDetections(*frame->mat, *objects);
+            }
+            frame->infer_end_us = VideoFrame::NowUs();
             std::lock_guard<std::mutex> lock(this->image_results_mutex_);
-            this->image_results_.push({src, objects});
+            if (run_model) {
+                this->last_objects_ = objects;
+            }
+            detection_t result;
+            result.frame = frame;
+            result.objects = objects;
+            result.inferred = run_model;
+            this->image_results_.push(result);
         } catch (const std::exception &e) {
             std::cerr << "Error in inference thread: " << e.what() << std::endl;
         }
     });
 }
-int framePool::get_model_id() {
-  std::lock_guard<std::mutex> lock(id_mutex_);
-  int mode_id = id;
-  id++;
-  if (id == thread_num_) {
-    id = 0;
-  }
-  return mode_id;
+
+void framePool::inferenceThread(std::shared_ptr<cv::Mat> src){
+    auto frame = std::make_shared<VideoFrame>();
+    frame->mat = src;
+    if (src) {
+        frame->format = VIDEO_FRAME_FMT_RGB888;
+        frame->width = src->cols;
+        frame->height = src->rows;
+        frame->width_stride = src->cols;
+        frame->height_stride = src->rows;
+    }
+    frame->seq = ++this->legacy_seq_;
+    frame->stream_id = this->stream_name_;
+    frame->capture_us = frame->decode_us = VideoFrame::NowUs();
+    this->inferenceThread(frame);
 }
 
 
@@ -76,12 +138,16 @@ detection_t framePool::GetImageResultFromQueue() {
     return result;
 }
 
-framePool::~framePool() = default;
+framePool::~framePool() {
+    this->DeInit();
+}
 
-int framePool::GetTasksSize() { return pool_->TasksSize(); }
+int framePool::GetTasksSize() {
+    return this->infer_ctx_->GetScheduler()->queuedJobs(this->stream_handle_);
+}
 
 // 添加获取结果队列大小的方法
 int framePool::GetResultQueueSize() {
     std::lock_guard<std::mutex> lock(this->image_results_mutex_);
     return this->image_results_.size();
-}
\ No newline at end of file
+}
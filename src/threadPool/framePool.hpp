@@ -1,35 +1,63 @@
+#include <atomic>
 #include <queue>
 #include "threadPool.hpp"
+#include "inferScheduler.hpp"
 #include "model/yolov5.h"
+#include "types/video_frame.h"
 #include "im2d.h"
 #include "rga.h"
 #include "RgaUtils.h"
 
 typedef struct {
-   std::shared_ptr<cv::Mat> src;
+   VideoFramePtr frame;
    std::shared_ptr<std::vector<Detection>> objects;
+   bool inferred = true; // false 表示没有推理，objects 沿用最近一次检测结果，不应再次报警
 } detection_t;
 
+// 进程级共享的推理上下文：一组模型实例 + 调度器，每个调度线程独占一个模型
+class InferContext {
+ public:
+    InferContext(const std::string model_path, const int ctx_num);
+    ~InferContext();
+    std::shared_ptr<Yolov5> GetModel(int worker_id);
+    InferScheduler *GetScheduler() { return scheduler_.get(); }
+
+ private:
+    std::vector<std::shared_ptr<Yolov5>> models_;
+    std::unique_ptr<InferScheduler> scheduler_;
+};
+
 class framePool {
  public:
+    // 独占模式：自己创建推理上下文（兼容旧用法）
     framePool(const std::string model_path, const int thread_num);
+    // 共享模式：挂到进程级推理上下文上，按权重参与调度
+    framePool(std::shared_ptr<InferContext> infer_ctx, const std::string stream_name,
+              int weight = 1, int priority = 0, size_t queue_size = 8);
     ~framePool();
     void Init();
     void DeInit();
-    void inferenceThread(std::shared_ptr<cv::Mat> src);
+    // run_model 为 false 时不跑模型，沿用最近一次的检测结果画框，帧仍按提交顺序进入结果队列
+    void inferenceThread(VideoFramePtr frame, bool run_model = true);
+    void inferenceThread(std::shared_ptr<cv::Mat> src); // 兼容旧用法，包装成VideoFrame
     detection_t GetImageResultFromQueue();
     int GetTasksSize();
     int GetResultQueueSize(); // 新增：获取结果队列大小
-    int get_model_id();
+    void SetDrawDetections(bool draw) { draw_detections_ = draw; } // 推理后是否把检测框画到帧上
 
  private:
     int thread_num_{1};
     std::string model_path_{"null"};
     std::string label_path_{"null"};
-    uint32_t id{0};
-    std::shared_ptr<ThreadPool> pool_;
+    std::string stream_name_{"default"};
+    int weight_{1};
+    int priority_{0};
+    size_t queue_size_{0};
+    int stream_handle_{-1};
+    uint64_t legacy_seq_{0};
+    std::atomic<bool> draw_detections_{true};
+    std::shared_ptr<InferContext> infer_ctx_;
+    std::shared_ptr<std::vector<Detection>> last_objects_; // 最近一次推理的检测结果，受 image_results_mutex_ 保护
     std::queue<detection_t> image_results_; // 调整队列类型
-    std::vector<std::shared_ptr<Yolov5>> models_;
-    std::mutex id_mutex_;
     std::mutex image_results_mutex_;
-};
\ No newline at end of file
+};
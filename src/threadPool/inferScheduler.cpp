@@ -0,0 +1,249 @@
+#include "inferScheduler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+InferScheduler::InferScheduler(size_t worker_num, ThreadInit thread_init)
+    : thread_init_(thread_init) {
+    if (worker_num == 0) {
+        worker_num = 1;
+    }
+    cursors_.assign(worker_num, 0);
+    for (size_t i = 0; i < worker_num; ++i) {
+        workers_.emplace_back(&InferScheduler::workerLoop, this, i);
+    }
+    printf("推理调度器已启动，共享推理上下文: %zu\n", worker_num);
+}
+
+InferScheduler::~InferScheduler() {
+    stop_ = true;
+    wait_cv_.notify_all();
+    for (auto &worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+int InferScheduler::registerStream(const std::string &name, int weight, int priority, size_t capacity) {
+    auto stream = std::make_shared<StreamQueue>();
+    stream->name = name;
+    stream->weight = std::max(1, weight);
+    stream->priority = priority;
+    stream->capacity = capacity;
+
+    std::lock_guard<std::mutex> lock(streams_mutex_);
+    stream->handle = next_handle_++;
+
+    // 主线程分配给当前权重总和最小的工作线程，保证各线程负载均衡
+    std::vector<int> load(workers_.size(), 0);
+    for (const auto &s : streams_) {
+        load[s->home] += s->weight;
+    }
+    stream->home = std::min_element(load.begin(), load.end()) - load.begin();
+    streams_.push_back(stream);
+
+    printf("推理调度器注册流 %s: handle=%d weight=%d priority=%d home=%zu\n",
+           name.c_str(), stream->handle, stream->weight, stream->priority, stream->home);
+    return stream->handle;
+}
+
+void InferScheduler::unregisterStream(int handle) {
+    StreamPtr stream;
+    {
+        std::lock_guard<std::mutex> lock(streams_mutex_);
+        auto it = std::find_if(streams_.begin(), streams_.end(),
+                               [handle](const StreamPtr &s) { return s->handle == handle; });
+        if (it == streams_.end()) {
+            return;
+        }
+        stream = *it;
+        streams_.erase(it);
+    }
+
+    // 丢弃排队任务，并等待正在执行的任务结束，之后调用方才能安全释放任务中引用的资源
+    std::unique_lock<std::mutex> lock(stream->mutex);
+    stream->closed = true;
+    pending_ -= stream->jobs.size();
+    stream->jobs.clear();
+    stream->idle_cv.wait(lock, [&stream] { return stream->inflight == 0; });
+    printf("推理调度器注销流 %s\n", stream->name.c_str());
+}
+
+bool InferScheduler::submit(int handle, Job job) {
+    StreamPtr stream = findStream(handle);
+    if (!stream) {
+        return false;
+    }
+
+    bool accepted = true;
+    {
+        std::lock_guard<std::mutex> lock(stream->mutex);
+        if (stream->closed) {
+            return false;
+        }
+        // 队列满时丢弃最旧的帧，新帧更有实时价值
+        if (stream->capacity > 0 && stream->jobs.size() >= stream->capacity) {
+            stream->jobs.pop_front();
+            stream->dropped++;
+            pending_--;
+            accepted = false;
+        }
+        stream->jobs.push_back(std::move(job));
+        stream->submitted++;
+        pending_++;
+    }
+    wait_cv_.notify_one();
+    return accepted;
+}
+
+size_t InferScheduler::queuedJobs(int handle) const {
+    StreamPtr stream = findStream(handle);
+    if (!stream) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(stream->mutex);
+    return stream->jobs.size();
+}
+
+std::vector<InferScheduler::StreamPtr> InferScheduler::snapshot() const {
+    std::lock_guard<std::mutex> lock(streams_mutex_);
+    return streams_;
+}
+
+InferScheduler::StreamPtr InferScheduler::findStream(int handle) const {
+    std::lock_guard<std::mutex> lock(streams_mutex_);
+    for (const auto &s : streams_) {
+        if (s->handle == handle) {
+            return s;
+        }
+    }
+    return nullptr;
+}
+
+// 差额轮询：游标停留在一路流上，直到该流用完本轮的权重额度或队列为空
+bool InferScheduler::nextHomeJob(size_t worker_id, StreamPtr &owner, Job &job) {
+    std::vector<StreamPtr> home;
+    for (auto &s : snapshot()) {
+        if (s->home == worker_id) {
+            home.push_back(s);
+        }
+    }
+    if (home.empty()) {
+        return false;
+    }
+
+    size_t &cursor = cursors_[worker_id];
+    for (size_t step = 0; step < home.size() * 2; ++step) {
+        auto &stream = home[cursor % home.size()];
+        std::lock_guard<std::mutex> lock(stream->mutex);
+        if (stream->closed || stream->jobs.empty()) {
+            stream->deficit = 0;
+            cursor++;
+            continue;
+        }
+        if (stream->deficit <= 0) {
+            stream->deficit += stream->weight;
+        }
+        job = std::move(stream->jobs.front());
+        stream->jobs.pop_front();
+        stream->deficit--;
+        stream->inflight++;
+        pending_--;
+        if (stream->deficit <= 0) {
+            cursor++;
+        }
+        owner = stream;
+        return true;
+    }
+    return false;
+}
+
+// 主流全部空闲时，从其他线程的流中窃取最紧迫的任务：先比优先级，再比加权积压量
+bool InferScheduler::stealJob(size_t worker_id, StreamPtr &owner, Job &job) {
+    StreamPtr victim;
+    int best_priority = 0;
+    size_t best_backlog = 0;
+    for (auto &s : snapshot()) {
+        if (s->home == worker_id) {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(s->mutex);
+        if (s->closed || s->jobs.empty()) {
+            continue;
+        }
+        size_t backlog = s->jobs.size() * s->weight;
+        if (!victim || s->priority > best_priority ||
+            (s->priority == best_priority && backlog > best_backlog)) {
+            victim = s;
+            best_priority = s->priority;
+            best_backlog = backlog;
+        }
+    }
+    if (!victim) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(victim->mutex);
+    if (victim->closed || victim->jobs.empty()) {
+        return false;
+    }
+    job = std::move(victim->jobs.front());
+    victim->jobs.pop_front();
+    victim->inflight++;
+    victim->stolen++;
+    pending_--;
+    owner = victim;
+    return true;
+}
+
+void InferScheduler::finishJob(const StreamPtr &owner) {
+    std::lock_guard<std::mutex> lock(owner->mutex);
+    owner->inflight--;
+    owner->executed++;
+    if (owner->inflight == 0) {
+        owner->idle_cv.notify_all();
+    }
+}
+
+void InferScheduler::workerLoop(size_t worker_id) {
+    if (thread_init_) {
+        thread_init_(static_cast<int>(worker_id));
+    }
+    while (!stop_) {
+        StreamPtr owner;
+        Job job;
+        if (nextHomeJob(worker_id, owner, job) || stealJob(worker_id, owner, job)) {
+            try {
+                job(static_cast<int>(worker_id));
+            } catch (const std::exception &e) {
+                std::cerr << "Error in inference job: " << e.what() << std::endl;
+            }
+            finishJob(owner);
+            continue;
+        }
+
+        // 没有可执行的任务，等待新任务提交；加超时防止通知丢失
+        std::unique_lock<std::mutex> lock(wait_mutex_);
+        wait_cv_.wait_for(lock, std::chrono::milliseconds(20),
+                          [this] { return stop_ || pending_ > 0; });
+    }
+}
+
+std::vector<InferScheduler::StreamStats> InferScheduler::getStats() const {
+    std::vector<StreamStats> stats;
+    for (auto &s : snapshot()) {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        stats.push_back({s->name, s->weight, s->priority, s->jobs.size(),
+                         s->submitted, s->executed, s->dropped, s->stolen});
+    }
+    return stats;
+}
+
+void InferScheduler::printStats() const {
+    printf("=== 推理调度器统计 (上下文: %zu, 排队: %zu) ===\n", workers_.size(), pending_.load());
+    for (const auto &s : getStats()) {
+        printf("  %s: weight=%d priority=%d queued=%zu submitted=%zu executed=%zu dropped=%zu stolen=%zu\n",
+               s.name.c_str(), s.weight, s.priority, s.queued, s.submitted, s.executed, s.dropped, s.stolen);
+    }
+}
@@ -0,0 +1,115 @@
+#ifndef INFER_SCHEDULER_HPP
+#define INFER_SCHEDULER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief 进程级推理调度器，所有流共享同一组推理上下文（NPU模型实例）
+ *
+ * 特性：
+ * - 每路流一个有界双端队列，队列满时丢弃最旧的帧，保证实时性
+ * - 每个工作线程负责一组"主"流，按权重做差额轮询（DRR）
+ * - 工作线程的主流全部空闲时，从其他流中窃取任务，避免推理上下文闲置
+ * - 任务回调拿到工作线程编号，用来索引该线程独占的推理上下文
+ */
+class InferScheduler {
+public:
+    using Job = std::function<void(int worker_id)>;
+    using ThreadInit = std::function<void(int worker_id)>;
+
+    struct StreamStats {
+        std::string name;
+        int weight;
+        int priority;
+        size_t queued;
+        size_t submitted;
+        size_t executed;
+        size_t dropped;
+        size_t stolen;
+    };
+
+    /**
+     * @brief 构造函数
+     * @param worker_num 工作线程数，等于共享推理上下文的数量
+     * @param thread_init 工作线程启动时调用，用于绑核、命名等
+     */
+    explicit InferScheduler(size_t worker_num, ThreadInit thread_init = nullptr);
+    ~InferScheduler();
+
+    /**
+     * @brief 注册一路流
+     * @param name 流名称，仅用于统计输出
+     * @param weight DRR权重，每轮可连续执行的帧数
+     * @param priority 优先级，窃取任务时优先照顾高优先级的流
+     * @param capacity 队列最大长度，0表示不限制
+     * @return 流句柄
+     */
+    int registerStream(const std::string &name, int weight = 1, int priority = 0, size_t capacity = 8);
+
+    /**
+     * @brief 注销一路流，丢弃排队中的任务并等待正在执行的任务结束
+     */
+    void unregisterStream(int handle);
+
+    /**
+     * @brief 提交一个任务
+     * @return 队列已满挤掉旧任务或流不存在时返回false
+     */
+    bool submit(int handle, Job job);
+
+    size_t queuedJobs(int handle) const;
+    size_t workerNum() const { return workers_.size(); }
+    std::vector<StreamStats> getStats() const;
+    void printStats() const;
+
+private:
+    struct StreamQueue {
+        int handle = -1;
+        std::string name;
+        int weight = 1;
+        int priority = 0;
+        size_t capacity = 0;
+        size_t home = 0;        // 主工作线程编号
+        int deficit = 0;        // DRR差额计数
+        bool closed = false;
+        size_t inflight = 0;    // 正在执行的任务数
+        std::deque<Job> jobs;
+        size_t submitted = 0;
+        size_t executed = 0;
+        size_t dropped = 0;
+        size_t stolen = 0;
+        mutable std::mutex mutex;
+        std::condition_variable idle_cv;
+    };
+    using StreamPtr = std::shared_ptr<StreamQueue>;
+
+    void workerLoop(size_t worker_id);
+    bool nextHomeJob(size_t worker_id, StreamPtr &owner, Job &job);
+    bool stealJob(size_t worker_id, StreamPtr &owner, Job &job);
+    std::vector<StreamPtr> snapshot() const;
+    StreamPtr findStream(int handle) const;
+    void finishJob(const StreamPtr &owner);
+
+    std::vector<std::thread> workers_;
+    ThreadInit thread_init_;
+    std::vector<size_t> cursors_;          // 每个工作线程的DRR游标
+
+    mutable std::mutex streams_mutex_;
+    std::vector<StreamPtr> streams_;
+    int next_handle_ = 0;
+
+    std::mutex wait_mutex_;
+    std::condition_variable wait_cv_;
+    std::atomic<size_t> pending_{0};
+    std::atomic<bool> stop_{false};
+};
+
+#endif // INFER_SCHEDULER_HPP
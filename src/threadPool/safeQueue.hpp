@@ -2,6 +2,7 @@
 #include <queue>
 #include <mutex>
 #include <condition_variable>
+#include <chrono>
 
 template<typename T>
 class SafeQueue {
@@ -9,9 +10,12 @@ public:
     // 构造函数，可以指定最大队列长度，默认为0表示无限制
     explicit SafeQueue(size_t max_size = 0) : max_size_(max_size) {}
     
-    // 返回是否成功添加到队列
+    // 返回是否成功添加到队列，关闭后不再接收
     bool push(const T& value) {
         std::unique_lock<std::mutex> lock(mtx_);
+        if (closed_) {
+            return false;
+        }
         
         // 如果设置了最大队列长度且队列已满，则丢弃新数据
         if (max_size_ > 0 && queue_.size() >= max_size_) {
@@ -24,15 +28,38 @@ public:
         return true; // 数据成功添加
     }
     
+    // 阻塞等待数据；队列关闭且已取空时返回 false
     bool pop(T& value) {
         std::unique_lock<std::mutex> lock(mtx_);
-        cv_.wait(lock, [this]{ return !queue_.empty(); });
+        cv_.wait(lock, [this]{ return !queue_.empty() || closed_; });
+        if (queue_.empty()) {
+            return false;
+        }
         value = queue_.front();
         queue_.pop();
         // printf("queue size: %zu\n", queue_.size());
         return true;
     }
     
+    // 限时等待，超时或队列关闭且已取空时返回 false，timeout_ms 为 0 时不等待
+    bool pop_for(T& value, int timeout_ms) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this]{ return !queue_.empty() || closed_; });
+        if (queue_.empty()) {
+            return false;
+        }
+        value = queue_.front();
+        queue_.pop();
+        return true;
+    }
+    
+    // 关闭队列：唤醒所有阻塞在 pop 上的线程，剩余数据仍可取出
+    void close() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        closed_ = true;
+        cv_.notify_all();
+    }
+    
     size_t size() {
         std::unique_lock<std::mutex> lock(mtx_);
         return queue_.size();
@@ -80,4 +107,5 @@ private:
     std::condition_variable cv_;
     size_t max_size_;          // 最大队列长度，0表示无限制
     size_t dropped_count_ = 0; // 被丢弃的数据数量
+    bool closed_ = false;      // 已关闭，pop 不再阻塞
 };
\ No newline at end of file
@@ -0,0 +1,128 @@
+// 视频帧描述符，贯穿 解码 -> 推理 -> 编码推流 整条流水线
+
+#ifndef STREAMHIVE_VIDEO_FRAME_H
+#define STREAMHIVE_VIDEO_FRAME_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <opencv2/opencv.hpp>
+
+class DmaCpuAccess;
+
+typedef enum
+{
+    VIDEO_FRAME_FMT_UNKNOWN = 0,
+    VIDEO_FRAME_FMT_NV12 = 1,   // YUV420SP
+    VIDEO_FRAME_FMT_RGB888 = 2,
+} video_frame_format_e;
+
+/**
+ * @brief 引用计数的视频帧
+ *
+ * 像素内存由 mat 持有（通常来自 MatPool，引用计数归零后自动回池），
+ * fd 为像素内存对应的 dma-buf/memfd 句柄，没有时为 -1。时间戳分两类：
+ * - pts/dts：码流时间，单位毫秒，来自解码器，未知时为 -1
+ * - *_us：本机 steady_clock 微秒，用于统计各阶段耗时
+ */
+struct VideoFrame
+{
+    std::shared_ptr<cv::Mat> mat;
+    int fd = -1;
+    bool fd_is_dmabuf = false; // fd 为 dma-buf 时可以直接交给 RGA/MPP，memfd 只能用于进程间共享
+    std::shared_ptr<DmaCpuAccess> cpu_access; // dma-buf 的CPU访问窗口，交给硬件读之前 end()，帧释放时自动结束
+    video_frame_format_e format = VIDEO_FRAME_FMT_UNKNOWN;
+    int width = 0;
+    int height = 0;
+    int width_stride = 0;  // 行跨度，单位像素
+    int height_stride = 0; // 列跨度，单位行
+
+    int64_t pts = -1;
+    int64_t dts = -1;
+    uint64_t seq = 0;      // 每路流内从1开始递增的帧序号
+    std::string stream_id;
+
+    int64_t capture_us = 0;     // 码流数据到达时间
+    int64_t decode_us = 0;      // 解码输出时间
+    int64_t infer_begin_us = 0; // 开始推理时间
+    int64_t infer_end_us = 0;   // 推理完成时间
+
+    bool valid() const { return mat != nullptr && mat->data != nullptr; }
+
+    static int64_t NowUs()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+};
+
+typedef std::shared_ptr<VideoFrame> VideoFramePtr;
+
+/**
+ * @brief 单路流的逐帧延迟统计，推流线程逐帧累计，状态报告时打印并清零
+ */
+class FrameLatencyStats
+{
+public:
+    // 推流完成时调用，累计各阶段耗时
+    void add(const VideoFrame &frame, int64_t output_us)
+    {
+        if (frame.capture_us <= 0)
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        decode_sum_ += frame.decode_us - frame.capture_us;
+        queue_sum_ += frame.infer_begin_us - frame.decode_us;
+        infer_sum_ += frame.infer_end_us - frame.infer_begin_us;
+        encode_sum_ += output_us - frame.infer_end_us;
+        int64_t total = output_us - frame.capture_us;
+        total_sum_ += total;
+        if (total > total_max_)
+        {
+            total_max_ = total;
+        }
+        count_++;
+    }
+
+    void addReordered()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        reordered_++;
+    }
+
+    // 打印上次调用以来的平均延迟并清零，期间没有推出帧时不打印
+    void report()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (count_ == 0)
+        {
+            return;
+        }
+        printf("  帧延迟(ms, %llu帧平均): 解码=%.1f 排队=%.1f 推理=%.1f 编码推流=%.1f 总计=%.1f 最大=%.1f 乱序丢弃=%llu\n",
+               (unsigned long long)count_,
+               decode_sum_ / 1000.0 / count_, queue_sum_ / 1000.0 / count_,
+               infer_sum_ / 1000.0 / count_, encode_sum_ / 1000.0 / count_,
+               total_sum_ / 1000.0 / count_, total_max_ / 1000.0,
+               (unsigned long long)reordered_);
+        decode_sum_ = queue_sum_ = infer_sum_ = encode_sum_ = total_sum_ = total_max_ = 0;
+        count_ = 0;
+        reordered_ = 0;
+    }
+
+private:
+    std::mutex mutex_;
+    int64_t decode_sum_ = 0;
+    int64_t queue_sum_ = 0;
+    int64_t infer_sum_ = 0;
+    int64_t encode_sum_ = 0;
+    int64_t total_sum_ = 0;
+    int64_t total_max_ = 0;
+    uint64_t count_ = 0;
+    uint64_t reordered_ = 0;
+};
+
+#endif // STREAMHIVE_VIDEO_FRAME_H
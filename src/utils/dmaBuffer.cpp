@@ -0,0 +1,210 @@
+#include "dmaBuffer.hpp"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/types.h>
+
+// 与 <linux/dma-heap.h>、<linux/dma-buf.h> 保持一致，交叉编译工具链的内核头文件可能没有这两个文件
+struct dma_heap_allocation_data_t {
+    __u64 len;
+    __u32 fd;
+    __u32 fd_flags;
+    __u64 heap_flags;
+};
+#define DMA_HEAP_IOC_MAGIC 'H'
+#define DMA_HEAP_IOCTL_ALLOC_T _IOWR(DMA_HEAP_IOC_MAGIC, 0x0, struct dma_heap_allocation_data_t)
+
+struct dma_buf_sync_t {
+    __u64 flags;
+};
+#define DMA_BUF_SYNC_READ_T (1 << 0)
+#define DMA_BUF_SYNC_WRITE_T (2 << 0)
+#define DMA_BUF_SYNC_RW_T (DMA_BUF_SYNC_READ_T | DMA_BUF_SYNC_WRITE_T)
+#define DMA_BUF_SYNC_START_T (0 << 2)
+#define DMA_BUF_SYNC_END_T (1 << 2)
+#define DMA_BUF_BASE_T 'b'
+#define DMA_BUF_IOCTL_SYNC_T _IOW(DMA_BUF_BASE_T, 0, struct dma_buf_sync_t)
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+static int memfdCreate(const char *name) {
+    // 旧版 glibc 没有 memfd_create 包装函数，直接走系统调用
+    return (int)syscall(SYS_memfd_create, name, MFD_CLOEXEC);
+}
+
+DmaBuffer::~DmaBuffer() {
+    if (data_ && data_ != MAP_FAILED) {
+        munmap(data_, size_);
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+// dma-buf 的cache同步：START 之后CPU可访问，END 之后设备可访问；对 memfd 调用会返回 ENOTTY，忽略即可
+static void dmaBufSync(int fd, __u64 flags) {
+    struct dma_buf_sync_t sync;
+    sync.flags = flags;
+    while (ioctl(fd, DMA_BUF_IOCTL_SYNC_T, &sync) < 0 && (errno == EINTR || errno == EAGAIN)) {
+    }
+}
+
+void DmaBuffer::syncDeviceToCpu(int fd) {
+    if (fd >= 0) {
+        dmaBufSync(fd, DMA_BUF_SYNC_START_T | DMA_BUF_SYNC_RW_T);
+    }
+}
+
+void DmaBuffer::syncCpuToDevice(int fd) {
+    if (fd >= 0) {
+        dmaBufSync(fd, DMA_BUF_SYNC_END_T | DMA_BUF_SYNC_RW_T);
+    }
+}
+
+DmaCpuAccess::DmaCpuAccess(int fd, std::shared_ptr<void> owner) : fd_(fd), owner_(std::move(owner)) {
+    DmaBuffer::syncDeviceToCpu(fd_);
+}
+
+void DmaCpuAccess::end() {
+    std::call_once(end_once_, [this] {
+        DmaBuffer::syncCpuToDevice(fd_);
+        owner_.reset();
+        ended_.store(true);
+    });
+}
+
+DmaAllocator::DmaAllocator(const std::string &heap_path) : heap_path_(heap_path) {
+    if (!heap_path.empty()) {
+        heap_fd_ = open(heap_path.c_str(), O_RDWR | O_CLOEXEC);
+    }
+    if (heap_fd_ >= 0) {
+        printf("帧缓冲区使用 dma_heap: %s\n", heap_path.c_str());
+    } else {
+        printf("dma_heap %s 不可用，帧缓冲区使用 memfd\n", heap_path.empty() ? "(未配置)" : heap_path.c_str());
+    }
+}
+
+DmaAllocator::~DmaAllocator() {
+    if (heap_fd_ >= 0) {
+        close(heap_fd_);
+        heap_fd_ = -1;
+    }
+}
+
+std::unique_ptr<DmaBuffer> DmaAllocator::allocate(size_t size, const char *name) {
+    if (size == 0) {
+        return nullptr;
+    }
+    long page = sysconf(_SC_PAGESIZE);
+    size = (size + page - 1) / page * page;
+
+    int fd = -1;
+    DmaBuffer::Type type = DmaBuffer::MEMFD;
+    if (heap_fd_ >= 0) {
+        struct dma_heap_allocation_data_t alloc;
+        memset(&alloc, 0, sizeof(alloc));
+        alloc.len = size;
+        alloc.fd_flags = O_RDWR | O_CLOEXEC;
+        if (ioctl(heap_fd_, DMA_HEAP_IOCTL_ALLOC_T, &alloc) == 0) {
+            fd = (int)alloc.fd;
+            type = DmaBuffer::DMA_HEAP;
+        } else {
+            // CMA/dma32 区域耗尽时退回 memfd，保证流不中断
+            printf("dma_heap 分配 %zu 字节失败: %s，退回 memfd\n", size, strerror(errno));
+        }
+    }
+    if (fd < 0) {
+        fd = memfdCreate(name);
+        if (fd < 0) {
+            printf("memfd_create 失败: %s\n", strerror(errno));
+            return nullptr;
+        }
+        if (ftruncate(fd, (off_t)size) != 0) {
+            printf("memfd ftruncate %zu 失败: %s\n", size, strerror(errno));
+            close(fd);
+            return nullptr;
+        }
+    }
+
+    void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        printf("帧缓冲区 mmap 失败: %s\n", strerror(errno));
+        close(fd);
+        return nullptr;
+    }
+    return std::unique_ptr<DmaBuffer>(new DmaBuffer(fd, data, size, type));
+}
+
+int sendFd(int sock, int fd, const void *payload, size_t payload_len) {
+    // 至少发送一个字节的普通数据，否则部分内核不会投递控制消息
+    char dummy = 0;
+    struct iovec iov;
+    iov.iov_base = payload_len > 0 ? const_cast<void *>(payload) : &dummy;
+    iov.iov_len = payload_len > 0 ? payload_len : 1;
+
+    char control[CMSG_SPACE(sizeof(int))];
+    memset(control, 0, sizeof(control));
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+    ssize_t ret;
+    do {
+        ret = sendmsg(sock, &msg, MSG_NOSIGNAL);
+    } while (ret < 0 && errno == EINTR);
+    return ret < 0 ? -1 : 0;
+}
+
+int recvFd(int sock, void *payload, size_t *payload_len) {
+    char dummy = 0;
+    struct iovec iov;
+    bool has_payload = payload != nullptr && payload_len != nullptr && *payload_len > 0;
+    iov.iov_base = has_payload ? payload : &dummy;
+    iov.iov_len = has_payload ? *payload_len : 1;
+
+    char control[CMSG_SPACE(sizeof(int))];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t ret;
+    do {
+        ret = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    } while (ret < 0 && errno == EINTR);
+    if (ret < 0) {
+        return -1;
+    }
+    if (payload_len) {
+        *payload_len = has_payload ? (size_t)ret : 0;
+    }
+
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            int fd = -1;
+            memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+            return fd;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,112 @@
+#ifndef DMA_BUFFER_HPP
+#define DMA_BUFFER_HPP
+
+#include <stddef.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+
+/**
+ * @brief 可导出fd的帧缓冲区，创建时映射一次虚拟地址并一直缓存
+ *
+ * 优先从 dma_heap 分配（fd 是 dma-buf，可以直接交给 RGA/MPP 零拷贝使用），
+ * dma_heap 不可用或分配失败时退回 memfd（fd 只能用于进程间共享，硬件需走虚拟地址）。
+ */
+class DmaBuffer {
+public:
+    enum Type {
+        DMA_HEAP = 0,
+        MEMFD = 1,
+    };
+
+    ~DmaBuffer();
+    DmaBuffer(const DmaBuffer &) = delete;
+    DmaBuffer &operator=(const DmaBuffer &) = delete;
+
+    int fd() const { return fd_; }
+    void *data() const { return data_; }
+    size_t size() const { return size_; }
+    Type type() const { return type_; }
+    bool isDmaBuf() const { return type_ == DMA_HEAP; }
+
+    /**
+     * @brief 硬件写完、CPU读之前调用；缓冲区为带cache的dma-buf时刷新cache，其他情况为空操作
+     */
+    static void syncDeviceToCpu(int fd);
+
+    /**
+     * @brief CPU写完、硬件读之前调用
+     */
+    static void syncCpuToDevice(int fd);
+
+private:
+    friend class DmaAllocator;
+    DmaBuffer(int fd, void *data, size_t size, Type type) : fd_(fd), data_(data), size_(size), type_(type) {}
+
+    int fd_;
+    void *data_;
+    size_t size_;
+    Type type_;
+};
+
+/**
+ * @brief 一次CPU访问窗口：构造时 START（设备写完、CPU开始读写），end() 或析构时 END，两者严格成对
+ *
+ * 帧在流水线中任何位置被丢弃，随帧一起释放时补上 END；交给硬件读之前显式调用 end()，
+ * 多个读者（推流、拼接）各调一次也只生效一次。owner 保证 END 之前缓冲区不被回收。
+ */
+class DmaCpuAccess {
+public:
+    DmaCpuAccess(int fd, std::shared_ptr<void> owner);
+    ~DmaCpuAccess() { end(); }
+    DmaCpuAccess(const DmaCpuAccess &) = delete;
+    DmaCpuAccess &operator=(const DmaCpuAccess &) = delete;
+
+    // CPU写完、交给硬件读之前调用，只有第一次调用生效；并发调用都等到同步完成后才返回
+    void end();
+    bool ended() const { return ended_.load(); }
+
+private:
+    int fd_;
+    std::shared_ptr<void> owner_;
+    std::once_flag end_once_;
+    std::atomic<bool> ended_{false};
+};
+
+/**
+ * @brief 帧缓冲区分配器
+ */
+class DmaAllocator {
+public:
+    /**
+     * @param heap_path dma_heap 设备路径，如 /dev/dma_heap/system-dma32，为空或打不开时只用 memfd
+     */
+    explicit DmaAllocator(const std::string &heap_path = "/dev/dma_heap/system-dma32");
+    ~DmaAllocator();
+
+    /**
+     * @brief 分配缓冲区，大小按页对齐，失败返回nullptr
+     */
+    std::unique_ptr<DmaBuffer> allocate(size_t size, const char *name = "streamhive_frame");
+
+    bool hasDmaHeap() const { return heap_fd_ >= 0; }
+
+private:
+    int heap_fd_ = -1;
+    std::string heap_path_;
+};
+
+/**
+ * @brief 通过 Unix 域套接字发送fd（SCM_RIGHTS），可附带一段描述数据
+ * @return 成功返回0，失败返回-1
+ */
+int sendFd(int sock, int fd, const void *payload, size_t payload_len);
+
+/**
+ * @brief 接收 sendFd 发送的fd，payload 为可选的接收缓冲区
+ * @return 收到的fd，失败返回-1；payload_len 回写实际收到的描述数据长度
+ */
+int recvFd(int sock, void *payload, size_t *payload_len);
+
+#endif // DMA_BUFFER_HPP
@@ -1,4 +1,5 @@
 #include "msgServer.hpp"
+#include "threadAffinity.hpp"
 #include <iostream>
 
 msgServer::msgServer(int rtspPort,int alarmPort,Config &config)
@@ -46,6 +47,7 @@ void msgServer::setAlarmInterval(int interval_seconds) {
 }
 
 void msgServer::sentRtspAddressThread(int interval_seconds) {
+    ThreadTopology::instance().placeCurrentThread(ThreadClass::Msg, "msg_rtsp");
     while (running) {
         for (const auto &stream : config_.streams) {
             if (stream.enable) {
@@ -76,6 +78,7 @@ void msgServer::sendAlarm(std::shared_ptr<std::vector<Detection>> detections, st
 }
 
 void msgServer::sentAlarmThread() {
+    ThreadTopology::instance().placeCurrentThread(ThreadClass::Msg, "msg_alarm");
     while (running) {
         AlarmMessage_t alarm_msg;
         if (alarm_queue_.pop(alarm_msg)) {
@@ -105,6 +108,8 @@ void msgServer::start() {
 
 void msgServer::stop() {
     running = false;
+    // 报警线程可能阻塞在空队列上
+    alarm_queue_.close();
     // 等待线程结束
     if (rtsp_thread_.joinable()) {
         rtsp_thread_.join();
@@ -0,0 +1,234 @@
+#include "threadAffinity.hpp"
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <set>
+#include <fstream>
+#include <sstream>
+
+const char *threadClassName(ThreadClass cls) {
+    switch (cls) {
+    case ThreadClass::Poller: return "poller";
+    case ThreadClass::Infer: return "infer";
+    case ThreadClass::Encode: return "encode";
+    case ThreadClass::Msg: return "msg";
+    case ThreadClass::Decode: return "decode";
+    default: return "-";
+    }
+}
+
+static pid_t currentTid() {
+    return (pid_t)syscall(SYS_gettid);
+}
+
+static unsigned long long nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 读取 /proc/self/task/<tid>/stat 中的 utime+stime（单位: 时钟滴答）和最后运行的核心
+static bool readTaskStat(pid_t tid, unsigned long long &ticks, int &cpu) {
+    std::ifstream ifs("/proc/self/task/" + std::to_string(tid) + "/stat");
+    if (!ifs.is_open()) {
+        return false;
+    }
+    std::string line;
+    std::getline(ifs, line);
+    // comm 字段可能包含空格，从最后一个 ')' 之后开始解析
+    size_t pos = line.rfind(')');
+    if (pos == std::string::npos) {
+        return false;
+    }
+    std::istringstream iss(line.substr(pos + 2));
+    std::vector<std::string> fields;
+    std::string field;
+    while (iss >> field) {
+        fields.push_back(field);
+    }
+    // 去掉 pid 和 comm 后，utime/stime/processor 分别位于第 12/13/37 个字段
+    if (fields.size() < 37) {
+        return false;
+    }
+    ticks = std::stoull(fields[11]) + std::stoull(fields[12]);
+    cpu = std::stoi(fields[36]);
+    return true;
+}
+
+static std::string readTaskComm(pid_t tid) {
+    std::ifstream ifs("/proc/self/task/" + std::to_string(tid) + "/comm");
+    std::string comm;
+    std::getline(ifs, comm);
+    return comm;
+}
+
+ThreadTopology &ThreadTopology::instance() {
+    static ThreadTopology topology;
+    return topology;
+}
+
+std::vector<int> ThreadTopology::parseCpuList(const std::string &cpus) {
+    std::vector<int> result;
+    long online = sysconf(_SC_NPROCESSORS_CONF);
+    std::stringstream ss(cpus);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (item.empty()) {
+            continue;
+        }
+        int first = 0, last = 0;
+        size_t dash = item.find('-');
+        try {
+            if (dash == std::string::npos) {
+                first = last = std::stoi(item);
+            } else {
+                first = std::stoi(item.substr(0, dash));
+                last = std::stoi(item.substr(dash + 1));
+            }
+        } catch (const std::exception &e) {
+            printf("无效的核心列表项: %s\n", item.c_str());
+            continue;
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            if (cpu < 0 || cpu >= online || cpu >= CPU_SETSIZE) {
+                printf("忽略本机不存在的核心: %d\n", cpu);
+                continue;
+            }
+            result.push_back(cpu);
+        }
+    }
+    return result;
+}
+
+void ThreadTopology::configure(const ThreadTopologyConfig &config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+    const ThreadPlacementConfig *placements[(int)ThreadClass::Count] = {
+        &config.poller, &config.infer, &config.encode, &config.msg, &config.decode};
+    for (int i = 0; i < (int)ThreadClass::Count; ++i) {
+        cpus_[i] = parseCpuList(placements[i]->cpus);
+        fifo_priority_[i] = placements[i]->fifo_priority;
+    }
+}
+
+bool ThreadTopology::applyToThread(pid_t tid, ThreadClass cls) {
+    bool ok = true;
+    const auto &cpus = cpus_[(int)cls];
+    if (!cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus) {
+            CPU_SET(cpu, &set);
+        }
+        if (sched_setaffinity(tid, sizeof(set), &set) != 0) {
+            printf("线程 %d 绑核失败: %s\n", tid, strerror(errno));
+            ok = false;
+        }
+    }
+
+    int priority = fifo_priority_[(int)cls];
+    if (priority > 0) {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = std::min(priority, sched_get_priority_max(SCHED_FIFO));
+        // 需要 root 或 CAP_SYS_NICE，失败时保持普通调度继续运行
+        if (sched_setscheduler(tid, SCHED_FIFO, &param) != 0) {
+            printf("线程 %d 设置 SCHED_FIFO 失败: %s\n", tid, strerror(errno));
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+void ThreadTopology::placeCurrentThread(ThreadClass cls, const std::string &name) {
+    pid_t tid = currentTid();
+    // 线程名最长15个字符，便于 top -H 等工具观察
+    prctl(PR_SET_NAME, name.substr(0, 15).c_str(), 0, 0, 0);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    applyToThread(tid, cls);
+    ThreadRecord &record = threads_[tid];
+    record.name = name;
+    record.cls = (int)cls;
+}
+
+int ThreadTopology::placeExternalThreads(ThreadClass cls, const std::string &comm_prefix) {
+    int matched = 0;
+    DIR *dir = opendir("/proc/self/task");
+    if (!dir) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        pid_t tid = (pid_t)atoi(entry->d_name);
+        std::string comm = readTaskComm(tid);
+        if (comm.compare(0, comm_prefix.size(), comm_prefix) != 0) {
+            continue;
+        }
+        applyToThread(tid, cls);
+        ThreadRecord &record = threads_[tid];
+        record.name = comm;
+        record.cls = (int)cls;
+        matched++;
+    }
+    closedir(dir);
+    printf("线程类别 %s 匹配到 %d 个外部线程 (前缀: %s)\n", threadClassName(cls), matched, comm_prefix.c_str());
+    return matched;
+}
+
+void ThreadTopology::printReport() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    unsigned long long now = nowMs();
+    double elapsed_ms = last_report_ms_ ? (double)(now - last_report_ms_) : 0;
+    long hz = sysconf(_SC_CLK_TCK);
+
+    printf("\n=== 线程CPU占用 (统计区间 %.1fs) ===\n", elapsed_ms / 1000.0);
+    printf("  %-8s %-16s %-8s %-5s %s\n", "tid", "name", "class", "cpu", "usage");
+
+    DIR *dir = opendir("/proc/self/task");
+    if (!dir) {
+        return;
+    }
+    std::set<pid_t> alive;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        pid_t tid = (pid_t)atoi(entry->d_name);
+        alive.insert(tid);
+        unsigned long long ticks = 0;
+        int cpu = -1;
+        if (!readTaskStat(tid, ticks, cpu)) {
+            continue;
+        }
+        ThreadRecord &record = threads_[tid];
+        if (record.name.empty()) {
+            record.name = readTaskComm(tid);
+        }
+        // 第一次统计没有参考区间，只记录基线
+        double usage = 0;
+        if (elapsed_ms > 0 && ticks >= record.last_ticks) {
+            usage = (double)(ticks - record.last_ticks) * 1000.0 / hz / elapsed_ms * 100.0;
+        }
+        record.last_ticks = ticks;
+        printf("  %-8d %-16s %-8s %-5d %.1f%%\n", tid, record.name.c_str(),
+               record.cls >= 0 ? threadClassName((ThreadClass)record.cls) : "-", cpu, usage);
+    }
+    closedir(dir);
+    // 清理已经退出的线程记录
+    for (auto it = threads_.begin(); it != threads_.end();) {
+        it = alive.count(it->first) ? std::next(it) : threads_.erase(it);
+    }
+    last_report_ms_ = now;
+}
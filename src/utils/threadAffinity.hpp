@@ -0,0 +1,74 @@
+#ifndef THREAD_AFFINITY_HPP
+#define THREAD_AFFINITY_HPP
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include "config/config.hpp"
+
+// 线程类别，每类线程绑定到 thread_topology 中配置的核心集合
+enum class ThreadClass {
+    Poller = 0, // ZLMediaKit 事件轮询线程（网络收发、拉流回调）
+    Infer,      // 推理调度线程
+    Encode,     // 推流线程（颜色转换、编码、推流）
+    Msg,        // ZeroMQ 消息线程
+    Decode,     // 每路流的解码线程（MPP解码、颜色转换、提交推理）
+    Count
+};
+
+/**
+ * @brief 线程拓扑规划：按线程类别设置CPU亲和性与实时优先级，并统计每个线程的CPU占用
+ *
+ * 核心集合用 "0-3,6" 这样的字符串配置，超出本机在线核心的编号会被忽略，
+ * 配置为空则不绑核，因此同一份配置可以在任意 Linux 机器上运行。
+ */
+class ThreadTopology {
+public:
+    static ThreadTopology &instance();
+
+    void configure(const ThreadTopologyConfig &config);
+
+    /**
+     * @brief 对当前线程应用所属类别的绑核和调度策略，并登记线程名用于统计
+     */
+    void placeCurrentThread(ThreadClass cls, const std::string &name);
+
+    /**
+     * @brief 对外部库创建的线程（按 /proc/self/task/<tid>/comm 前缀匹配）应用绑核策略
+     * @return 匹配到的线程数
+     */
+    int placeExternalThreads(ThreadClass cls, const std::string &comm_prefix);
+
+    /**
+     * @brief 打印进程内每个线程的CPU占用、当前所在核心和所属类别
+     */
+    void printReport();
+
+    /**
+     * @brief 解析 "0-3,6" 格式的核心列表，过滤掉本机不存在的核心
+     */
+    static std::vector<int> parseCpuList(const std::string &cpus);
+
+private:
+    ThreadTopology() = default;
+    bool applyToThread(pid_t tid, ThreadClass cls);
+
+    struct ThreadRecord {
+        std::string name;
+        int cls = -1;
+        unsigned long long last_ticks = 0;
+    };
+
+    std::mutex mutex_;
+    ThreadTopologyConfig config_;
+    std::vector<int> cpus_[(int)ThreadClass::Count];
+    int fifo_priority_[(int)ThreadClass::Count] = {0};
+    std::map<pid_t, ThreadRecord> threads_;
+    unsigned long long last_report_ms_ = 0;
+};
+
+const char *threadClassName(ThreadClass cls);
+
+#endif // THREAD_AFFINITY_HPP
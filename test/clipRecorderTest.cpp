@@ -0,0 +1,136 @@
+// 报警录像测试：25fps、1秒一个GOP 的模拟码流，报警后检查 TS 文件的事前长度、帧数和封装格式
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "stream/clipRecorder.hpp"
+#include "stream/nalUtils.hpp"
+#include "testCheck.hpp"
+
+static std::vector<uint8_t> makeFrame(int index, bool key) {
+    std::vector<uint8_t> frame = {0, 0, 0, 1, (uint8_t)(key ? 0x65 : 0x41), 0x88};
+    frame.resize(frame.size() + 200 + (index % 7) * 50, (uint8_t)index);
+    return frame;
+}
+
+struct TsInfo {
+    size_t packets = 0;
+    size_t frames = 0;      // 视频 PES 个数
+    size_t key_frames = 0;  // 带随机访问标志的 PES
+    bool sync_ok = true;
+    bool cc_ok = true;
+    int64_t first_pts = -1;
+};
+
+static TsInfo parseTs(const std::string &path) {
+    TsInfo info;
+    FILE *fp = fopen(path.c_str(), "rb");
+    if (fp == nullptr) {
+        return info;
+    }
+    uint8_t pkt[188];
+    int last_cc = -1;
+    while (fread(pkt, 1, sizeof(pkt), fp) == sizeof(pkt)) {
+        info.packets++;
+        if (pkt[0] != 0x47) {
+            info.sync_ok = false;
+            break;
+        }
+        int pid = ((pkt[1] & 0x1F) << 8) | pkt[2];
+        if (pid != 0x100) {
+            continue;
+        }
+        int cc = pkt[3] & 0x0F;
+        if (last_cc >= 0 && cc != ((last_cc + 1) & 0x0F)) {
+            info.cc_ok = false;
+        }
+        last_cc = cc;
+        if ((pkt[1] & 0x40) == 0) {
+            continue;
+        }
+        info.frames++;
+        const uint8_t *p = pkt + 4;
+        if (pkt[3] & 0x20) {
+            if (p[0] > 0 && (p[1] & 0x40)) {
+                info.key_frames++;
+            }
+            p += 1 + p[0];
+        }
+        if (info.first_pts < 0 && p[0] == 0 && p[1] == 0 && p[2] == 1) {
+            const uint8_t *t = p + 9;
+            int64_t pts = ((int64_t)((t[0] >> 1) & 0x07) << 30) | ((int64_t)t[1] << 22) | ((int64_t)(t[2] >> 1) << 15) |
+                          ((int64_t)t[3] << 7) | (t[4] >> 1);
+            info.first_pts = pts;
+        }
+    }
+    fclose(fp);
+    return info;
+}
+
+static std::vector<std::string> listClips(const std::string &dir) {
+    std::vector<std::string> files;
+    DIR *d = opendir(dir.c_str());
+    if (d == nullptr) {
+        return files;
+    }
+    while (struct dirent *e = readdir(d)) {
+        std::string name = e->d_name;
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, ".ts") == 0) {
+            files.push_back(dir + "/" + name);
+        }
+    }
+    closedir(d);
+    return files;
+}
+
+int main() {
+    char tmpl[] = "/tmp/clipRecorderTestXXXXXX";
+    std::string dir = mkdtemp(tmpl);
+    {
+        // 事前 2 秒、事后 1 秒
+        ClipRecorder recorder(dir, "cam", 2, 1, 10);
+        recorder.setCodec(VIDEO_CODEC_H264);
+        const uint8_t sps_pps[] = {0, 0, 0, 1, 0x67, 0x64, 0x00, 0x28, 0, 0, 0, 1, 0x68, 0xEE, 0x3C, 0x80};
+        for (int i = 0; i < 250; ++i) {
+            bool key = i % 25 == 0;
+            int64_t pts = i * 40;
+            if (key) {
+                recorder.addPacket(sps_pps, sizeof(sps_pps), pts, pts, false, true);
+            }
+            std::vector<uint8_t> frame = makeFrame(i, key);
+            recorder.addPacket(frame.data(), frame.size(), pts, pts, key);
+            if (i == 150) {
+                recorder.trigger(); // 6.0s 报警
+            }
+            if (i == 160) {
+                recorder.trigger(); // 持续报警，结束时间延长到 7.4s
+            }
+        }
+    }
+
+    std::vector<std::string> clips = listClips(dir);
+    CHECK(clips.size() == 1, "one clip written");
+    if (clips.size() == 1) {
+        TsInfo info = parseTs(clips[0]);
+        // 缓冲区按整 GOP 淘汰：从 4.0s 的关键帧开始，到 7.4s 结束
+        CHECK(info.sync_ok, "ts sync bytes");
+        CHECK(info.cc_ok, "ts continuity counter");
+        CHECK(info.frames == 86, "clip frame count");
+        CHECK(info.key_frames == 4, "clip key frames");
+        CHECK(info.first_pts == (4000 + 1000) * 90, "clip starts at pre-event key frame");
+        printf("%s: %zu TS 包, %zu 帧\n", clips[0].c_str(), info.packets, info.frames);
+    }
+    for (const auto &clip : clips) {
+        remove(clip.c_str());
+    }
+    rmdir(dir.c_str());
+
+    if (failures) {
+        printf("clipRecorderTest: %d check(s) FAILED\n", failures);
+        return 1;
+    }
+    printf("clipRecorderTest: all checks passed\n");
+    return 0;
+}
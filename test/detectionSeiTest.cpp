@@ -0,0 +1,104 @@
+// 检测结果 SEI 序列化/解析测试：含防竞争字节、H.264/H.265 两种 NAL 头、在访问单元中查找
+#include <stdio.h>
+#include <string.h>
+#include "stream/detectionSei.hpp"
+#include "testCheck.hpp"
+
+static bool sameMeta(const SeiFrameMeta &a, const SeiFrameMeta &b) {
+    if (a.width != b.width || a.height != b.height || a.pts != b.pts || a.boxes.size() != b.boxes.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.boxes.size(); ++i) {
+        const SeiBox &x = a.boxes[i], &y = b.boxes[i];
+        if (x.x != y.x || x.y != y.y || x.w != y.w || x.h != y.h || x.class_id != y.class_id || x.score != y.score) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void checkRoundTrip(bool hevc) {
+    SeiFrameMeta meta;
+    meta.width = 1920;
+    meta.height = 1080;
+    meta.pts = 0x0000000100000002LL; // 含连续的 0 字节
+    for (int i = 0; i < 40; ++i) {
+        SeiBox box;
+        box.x = (uint16_t)(i * 3);   // 高字节为 0，制造 00 00 0x 序列
+        box.y = (uint16_t)(i == 0 ? 0 : 1000 + i);
+        box.w = 1;
+        box.h = 2;
+        box.class_id = (uint8_t)(i % 80);
+        box.score = (uint8_t)(i * 6);
+        meta.boxes.push_back(box);
+    }
+
+    std::vector<uint8_t> nal;
+    size_t size = buildDetectionSei(meta, hevc, nal);
+    CHECK(size == nal.size() && size > 4, "build size");
+    CHECK(nal[0] == 0 && nal[1] == 0 && nal[2] == 0 && nal[3] == 1, "start code");
+    // NAL 主体中不能出现起始码
+    bool has_start_code = false;
+    for (size_t i = 4; i + 2 < nal.size(); ++i) {
+        if (nal[i] == 0 && nal[i + 1] == 0 && nal[i + 2] < 3) {
+            has_start_code = true;
+        }
+    }
+    CHECK(!has_start_code, "emulation prevention applied");
+
+    SeiFrameMeta parsed;
+    CHECK(parseDetectionSei(nal.data() + 4, nal.size() - 4, hevc, parsed), "parse single NAL");
+    CHECK(sameMeta(meta, parsed), "round trip");
+
+    // 模拟一个访问单元: AUD + SEI + slice
+    std::vector<uint8_t> au;
+    const uint8_t aud_h264[] = {0, 0, 0, 1, 0x09, 0xF0};
+    const uint8_t aud_h265[] = {0, 0, 0, 1, 0x46, 0x01, 0x50};
+    const uint8_t slice_h264[] = {0, 0, 1, 0x65, 0x88, 0x80, 0x00, 0x00, 0x03, 0x01};
+    const uint8_t slice_h265[] = {0, 0, 1, 0x26, 0x01, 0xAF, 0x00, 0x00, 0x03, 0x01};
+    if (hevc) {
+        au.insert(au.end(), aud_h265, aud_h265 + sizeof(aud_h265));
+    } else {
+        au.insert(au.end(), aud_h264, aud_h264 + sizeof(aud_h264));
+    }
+    au.insert(au.end(), nal.begin(), nal.end());
+    if (hevc) {
+        au.insert(au.end(), slice_h265, slice_h265 + sizeof(slice_h265));
+    } else {
+        au.insert(au.end(), slice_h264, slice_h264 + sizeof(slice_h264));
+    }
+    SeiFrameMeta found;
+    CHECK(findDetectionSei(au.data(), au.size(), hevc, found), "find in access unit");
+    CHECK(sameMeta(meta, found), "find round trip");
+    // 用错误的编码类型解析应当失败
+    SeiFrameMeta wrong;
+    CHECK(!parseDetectionSei(nal.data() + 4, nal.size() - 4, !hevc, wrong), "codec mismatch rejected");
+}
+
+int main() {
+    checkRoundTrip(false);
+    checkRoundTrip(true);
+
+    // 空检测结果 + 未知 pts
+    SeiFrameMeta empty;
+    empty.width = 640;
+    empty.height = 360;
+    std::vector<uint8_t> nal;
+    buildDetectionSei(empty, false, nal);
+    SeiFrameMeta parsed;
+    parsed.pts = 123;
+    CHECK(parseDetectionSei(nal.data() + 4, nal.size() - 4, false, parsed), "parse empty");
+    CHECK(parsed.pts == -1 && parsed.boxes.empty() && parsed.width == 640, "empty round trip");
+
+    // 其他 UUID 的 SEI 被忽略
+    const uint8_t other[] = {0x06, 0x05, 0x11, 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x',
+                             'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 0x42, 0x80};
+    CHECK(!parseDetectionSei(other, sizeof(other), false, parsed), "foreign SEI ignored");
+
+    if (failures) {
+        printf("detectionSeiTest: %d check(s) FAILED\n", failures);
+        return 1;
+    }
+    printf("detectionSeiTest: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,119 @@
+// 帧缓冲区分配器测试：在普通 Linux 上走 memfd 路径，验证映射缓存和跨进程fd传递
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <thread>
+#include <vector>
+#include "utils/dmaBuffer.hpp"
+#include "testCheck.hpp"
+
+struct FrameDesc {
+    int width;
+    int height;
+    unsigned long long seq;
+};
+
+int main() {
+    // 不存在的 heap 路径强制使用 memfd
+    DmaAllocator allocator("/dev/dma_heap/not-exist");
+    CHECK(!allocator.hasDmaHeap(), "bogus heap should not open");
+
+    const int width = 640, height = 480;
+    auto buffer = allocator.allocate(width * height * 3);
+    CHECK(buffer != nullptr, "allocate");
+    if (!buffer) {
+        return 1;
+    }
+    CHECK(buffer->fd() >= 0, "fd exported");
+    CHECK(buffer->type() == DmaBuffer::MEMFD, "memfd fallback");
+    CHECK(buffer->size() % sysconf(_SC_PAGESIZE) == 0, "size page aligned");
+    CHECK(buffer->size() >= (size_t)width * height * 3, "size");
+
+    unsigned char *pixels = (unsigned char *)buffer->data();
+    for (size_t i = 0; i < buffer->size(); ++i) {
+        pixels[i] = (unsigned char)(i * 7);
+    }
+    // memfd 上的cache同步应当是无害的空操作
+    DmaBuffer::syncCpuToDevice(buffer->fd());
+    DmaBuffer::syncDeviceToCpu(buffer->fd());
+    {
+        // CPU访问窗口：多个读者都调用 end() 只结束一次，之后不再持有缓冲区
+        auto owner = std::make_shared<int>(0);
+        DmaCpuAccess access(buffer->fd(), owner);
+        CHECK(!access.ended() && owner.use_count() == 2, "cpu access window open");
+        access.end();
+        access.end();
+        CHECK(access.ended() && owner.use_count() == 1, "cpu access window ended once");
+    }
+    {
+        // 推流和拼接线程同时调用 end()：每个调用返回时同步都已完成
+        auto owner = std::make_shared<int>(0);
+        DmaCpuAccess access(buffer->fd(), owner);
+        std::vector<std::thread> readers;
+        std::atomic<int> early{0};
+        for (int i = 0; i < 4; ++i) {
+            readers.emplace_back([&access, &early] {
+                access.end();
+                if (!access.ended()) {
+                    early++;
+                }
+            });
+        }
+        for (auto &reader : readers) {
+            reader.join();
+        }
+        CHECK(early == 0 && owner.use_count() == 1, "concurrent end waits for the sync");
+    }
+
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) != 0) {
+        perror("socketpair");
+        return 1;
+    }
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        // 子进程：收到fd后映射同一块内存，校验内容并写回一个标记
+        close(sv[0]);
+        FrameDesc desc;
+        size_t len = sizeof(desc);
+        int fd = recvFd(sv[1], &desc, &len);
+        if (fd < 0 || len != sizeof(desc) || desc.seq != 42) {
+            _exit(2);
+        }
+        size_t size = (size_t)desc.width * desc.height * 3;
+        unsigned char *view = (unsigned char *)mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (view == MAP_FAILED) {
+            _exit(3);
+        }
+        for (size_t i = 0; i < size; ++i) {
+            if (view[i] != (unsigned char)(i * 7)) {
+                _exit(4);
+            }
+        }
+        view[0] = 0xAB;
+        munmap(view, size);
+        close(fd);
+        _exit(0);
+    }
+
+    close(sv[1]);
+    FrameDesc desc = {width, height, 42};
+    CHECK(sendFd(sv[0], buffer->fd(), &desc, sizeof(desc)) == 0, "sendFd");
+    int status = 0;
+    waitpid(pid, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0, "child process saw the same pixels");
+    // 子进程写入的内容通过同一块共享内存直接可见，没有任何拷贝
+    CHECK(pixels[0] == 0xAB, "write from other process visible through cached mapping");
+    close(sv[0]);
+
+    if (failures) {
+        printf("dmaBufferTest: %d check(s) FAILED\n", failures);
+        return 1;
+    }
+    printf("dmaBufferTest: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,126 @@
+// 抽帧测试：25fps 抽 10fps 的间隔与长期帧率、源端抖动、时间戳回退和长时间断流后的重新对齐
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+#include "stream/frameDecimator.hpp"
+#include "testCheck.hpp"
+
+// 按给定的帧时间逐帧送入，返回被保留的帧时间
+static std::vector<int64_t> run(FrameDecimator &decimator, const std::vector<int64_t> &times) {
+    std::vector<int64_t> kept;
+    for (int64_t t : times) {
+        if (decimator.accept(t)) {
+            kept.push_back(t);
+        }
+    }
+    return kept;
+}
+
+static std::vector<int64_t> steady(int64_t start_ms, int64_t period_ms, int count) {
+    std::vector<int64_t> times;
+    for (int i = 0; i < count; ++i) {
+        times.push_back(start_ms + i * period_ms);
+    }
+    return times;
+}
+
+static void checkDisabled() {
+    FrameDecimator decimator;
+    CHECK(!decimator.enabled(), "fps 0 disabled");
+    CHECK(run(decimator, steady(0, 40, 50)).size() == 50, "fps 0 keeps every frame");
+
+    // 目标帧率高于源帧率时不丢帧
+    FrameDecimator faster(30);
+    CHECK(run(faster, steady(0, 40, 250)).size() == 250, "target above source keeps every frame");
+
+    // 编码器、输出轨道和时间戳按抽帧后的帧率配置
+    CHECK(decimator.outputFps(25) == 25, "disabled output fps is the source fps");
+    CHECK(faster.outputFps(25) == 25, "target above source keeps the source fps");
+    CHECK(FrameDecimator(10).outputFps(25) == 10, "output fps is the target below source");
+    CHECK(FrameDecimator(10).outputFps(0) == 10, "unknown source fps uses the target");
+}
+
+static void checkSpacing() {
+    // 25fps 送 10 秒，应正好保留 100 帧，间隔只有 80/120ms 两种
+    FrameDecimator decimator(10);
+    std::vector<int64_t> kept = run(decimator, steady(0, 40, 250));
+    printf("25->10fps: 10s 保留 %zu 帧\n", kept.size());
+    CHECK(kept.size() == 100, "25->10 keeps exactly 10 fps");
+    int short_gaps = 0, long_gaps = 0;
+    for (size_t i = 1; i < kept.size(); ++i) {
+        int64_t gap = kept[i] - kept[i - 1];
+        if (gap == 80) {
+            short_gaps++;
+        } else if (gap == 120) {
+            long_gaps++;
+        } else {
+            printf("FAIL: 25->10 gap %lld ms at frame %zu\n", (long long)gap, i);
+            failures++;
+        }
+    }
+    CHECK(short_gaps > 0 && long_gaps > 0 && short_gaps - long_gaps <= 1 && long_gaps - short_gaps <= 1,
+          "25->10 alternates 80/120 ms");
+}
+
+static void checkJitter() {
+    // 到达时间在标称值上下抖动 ±10ms，长期帧率不漂移，不会连着保留相邻两帧
+    FrameDecimator decimator(10);
+    std::vector<int64_t> times;
+    uint32_t seed = 12345;
+    for (int i = 0; i < 250; ++i) {
+        seed = seed * 1103515245 + 12345;
+        int jitter = (int)((seed >> 16) % 21) - 10;
+        times.push_back(1000 + i * 40 + jitter);
+    }
+    std::vector<int64_t> kept = run(decimator, times);
+    printf("抖动 ±10ms: 10s 保留 %zu 帧\n", kept.size());
+    CHECK(kept.size() >= 99 && kept.size() <= 101, "jitter keeps 10 fps long term");
+    for (size_t i = 1; i < kept.size(); ++i) {
+        if (kept[i] - kept[i - 1] < 60) {
+            printf("FAIL: jitter gap %lld ms at frame %zu\n", (long long)(kept[i] - kept[i - 1]), i);
+            failures++;
+            break;
+        }
+    }
+}
+
+static void checkBackwards() {
+    // 摄像头重启后 pts 从头开始：回退后的第一帧立即保留，之后按 10fps 继续
+    FrameDecimator decimator(10);
+    run(decimator, steady(100000, 40, 125));
+    CHECK(decimator.accept(0), "first frame after pts jumps back is kept");
+    std::vector<int64_t> kept = run(decimator, steady(40, 40, 124));
+    printf("时间戳回退: 之后 5s 保留 %zu 帧\n", kept.size() + 1);
+    CHECK(kept.size() + 1 == 50, "10 fps resumes after pts jumps back");
+
+    // 小幅回退（乱序一帧）不重新对齐，也不额外保留
+    FrameDecimator small(10);
+    std::vector<int64_t> times = steady(0, 40, 50);
+    times.insert(times.begin() + 25, times[24] - 40);
+    CHECK(run(small, times).size() == 20, "small backward step does not add frames");
+}
+
+static void checkLongGap() {
+    // 断流 10 秒后恢复：第一帧立即保留，不为断流期间补帧
+    FrameDecimator decimator(10);
+    run(decimator, steady(0, 40, 125));
+    CHECK(decimator.accept(15000), "first frame after a long gap is kept");
+    std::vector<int64_t> kept = run(decimator, steady(15040, 40, 24));
+    printf("断流后: 1s 内保留 %zu 帧\n", kept.size() + 1);
+    CHECK(kept.size() + 1 == 10, "no burst after a long gap");
+    CHECK(!kept.empty() && kept[0] - 15000 >= 80, "second frame after gap keeps spacing");
+}
+
+int main() {
+    checkDisabled();
+    checkSpacing();
+    checkJitter();
+    checkBackwards();
+    checkLongGap();
+    if (failures) {
+        printf("frameDecimatorTest: %d check(s) FAILED\n", failures);
+        return 1;
+    }
+    printf("frameDecimatorTest: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,93 @@
+// InferScheduler 调度测试：验证DRR权重比例与空闲线程的任务窃取
+#include "threadPool/inferScheduler.hpp"
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <atomic>
+
+int main() {
+    std::cout << "=== InferScheduler 测试 ===" << std::endl;
+    int failed = 0;
+
+    // 测试1：单个推理上下文，两路流权重3:1，积压状态下执行次数应接近3:1
+    std::cout << "\n--- 测试1：DRR权重比例 ---" << std::endl;
+    {
+        InferScheduler scheduler(1);
+        std::atomic<int> count_a{0}, count_b{0};
+        int a = scheduler.registerStream("critical", 3, 1, 0);
+        int b = scheduler.registerStream("normal", 1, 0, 0);
+        // 先塞一个慢任务占住工作线程，让两路流都积压起来
+        scheduler.submit(a, [](int) { std::this_thread::sleep_for(std::chrono::milliseconds(50)); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        for (int i = 0; i < 200; ++i) {
+            scheduler.submit(a, [&count_a, &count_b](int) {
+                if (count_a + count_b < 200) count_a++;
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            });
+            scheduler.submit(b, [&count_a, &count_b](int) {
+                if (count_a + count_b < 200) count_b++;
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            });
+        }
+        while (scheduler.queuedJobs(a) + scheduler.queuedJobs(b) > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        double ratio = count_b > 0 ? (double)count_a / count_b : 0;
+        std::cout << "前200帧中 critical=" << count_a << " normal=" << count_b
+                  << " 比例=" << ratio << std::endl;
+        if (ratio < 2.5 || ratio > 3.5) {
+            std::cout << "失败：权重比例偏离3:1" << std::endl;
+            failed++;
+        }
+        scheduler.unregisterStream(a);
+        scheduler.unregisterStream(b);
+    }
+
+    // 测试2：两个推理上下文，只有一路流有任务，另一个线程应当窃取任务
+    std::cout << "\n--- 测试2：任务窃取 ---" << std::endl;
+    {
+        InferScheduler scheduler(2);
+        std::atomic<int> workers_seen[2] = {{0}, {0}};
+        int busy = scheduler.registerStream("busy", 1, 0, 0);
+        int idle = scheduler.registerStream("idle", 1, 0, 0);
+        for (int i = 0; i < 40; ++i) {
+            scheduler.submit(busy, [&workers_seen](int worker_id) {
+                workers_seen[worker_id]++;
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            });
+        }
+        while (scheduler.queuedJobs(busy) > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        scheduler.unregisterStream(busy);
+        scheduler.unregisterStream(idle);
+        std::cout << "worker0=" << workers_seen[0] << " worker1=" << workers_seen[1] << std::endl;
+        if (workers_seen[0] == 0 || workers_seen[1] == 0) {
+            std::cout << "失败：空闲线程没有窃取任务" << std::endl;
+            failed++;
+        }
+    }
+
+    // 测试3：有界队列满时丢弃最旧的任务
+    std::cout << "\n--- 测试3：有界队列 ---" << std::endl;
+    {
+        InferScheduler scheduler(1);
+        int s = scheduler.registerStream("bounded", 1, 0, 2);
+        scheduler.submit(s, [](int) { std::this_thread::sleep_for(std::chrono::milliseconds(50)); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        int accepted = 0;
+        for (int i = 0; i < 5; ++i) {
+            accepted += scheduler.submit(s, [](int) {}) ? 1 : 0;
+        }
+        auto stats = scheduler.getStats();
+        std::cout << "队列长度=" << stats[0].queued << " 丢弃=" << stats[0].dropped << std::endl;
+        if (stats[0].queued != 2 || stats[0].dropped != 3 || accepted != 2) {
+            std::cout << "失败：有界队列行为不正确" << std::endl;
+            failed++;
+        }
+        scheduler.unregisterStream(s);
+    }
+
+    std::cout << "\n" << (failed == 0 ? "全部测试通过" : "存在失败的测试") << std::endl;
+    return failed == 0 ? 0 : 1;
+}
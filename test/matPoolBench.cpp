@@ -0,0 +1,251 @@
+// MatPool 性能对比：旧实现（字符串键 + 全局锁 + 复用清零）与新实现（整数键 + 无锁空闲链表），并检查帧内存预算
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "stream/matPool.hpp"
+
+// 旧版 MatPool 的取用/归还路径，保留用于对比
+class LegacyMatPool {
+public:
+    explicit LegacyMatPool(size_t max_pool_size) : max_pool_size_(max_pool_size) {}
+
+    std::shared_ptr<cv::Mat> getMat(int width, int height, int type = CV_8UC3) {
+        const std::string pool_key = std::to_string(width) + "x" + std::to_string(height) + "_" + std::to_string(type);
+        PoolInfo &pool = getOrCreatePool(pool_key);
+        {
+            std::lock_guard<std::mutex> lock(pool.mutex);
+            if (!pool.available_mats.empty()) {
+                auto mat_ptr = std::move(pool.available_mats.front());
+                pool.available_mats.pop();
+                mat_ptr->setTo(cv::Scalar::all(0));
+                return std::shared_ptr<cv::Mat>(mat_ptr.release(), [this, pool_key](cv::Mat *mat) {
+                    this->returnMat(mat, pool_key);
+                });
+            }
+        }
+        return std::shared_ptr<cv::Mat>(new cv::Mat(height, width, type), [this, pool_key](cv::Mat *mat) {
+            this->returnMat(mat, pool_key);
+        });
+    }
+
+    ~LegacyMatPool() {
+        for (auto &pair : pools_) {
+            delete pair.second;
+        }
+    }
+
+private:
+    struct PoolInfo {
+        std::queue<std::unique_ptr<cv::Mat>> available_mats;
+        std::mutex mutex;
+    };
+
+    PoolInfo &getOrCreatePool(const std::string &key) {
+        std::lock_guard<std::mutex> lock(pools_mutex_);
+        auto it = pools_.find(key);
+        if (it == pools_.end()) {
+            it = pools_.emplace(key, new PoolInfo()).first;
+        }
+        return *it->second;
+    }
+
+    void returnMat(cv::Mat *mat, const std::string &pool_key) {
+        PoolInfo &pool = getOrCreatePool(pool_key);
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        if (pool.available_mats.size() < max_pool_size_) {
+            pool.available_mats.push(std::unique_ptr<cv::Mat>(mat));
+        } else {
+            delete mat;
+        }
+    }
+
+    std::mutex pools_mutex_;
+    std::unordered_map<std::string, PoolInfo *> pools_;
+    size_t max_pool_size_;
+};
+
+// threads 个线程各自循环取用 iterations 次，每次持有 hold 个Mat，模拟解码->推理->推流的在途帧
+template <typename Pool>
+double runBench(Pool &pool, int width, int height, int threads, int iterations, int hold) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&pool, width, height, iterations, hold]() {
+            std::vector<std::shared_ptr<cv::Mat>> inflight;
+            for (int i = 0; i < iterations; ++i) {
+                inflight.push_back(pool.getMat(width, height, CV_8UC3));
+                inflight.back()->data[0] = (unsigned char)i;
+                if ((int)inflight.size() > hold) {
+                    inflight.erase(inflight.begin());
+                }
+            }
+        });
+    }
+    for (auto &w : workers) {
+        w.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / ((double)threads * iterations);
+}
+
+static int checkPoolBehaviour() {
+    int failures = 0;
+    MatPool pool(4, 0);
+    pool.preallocate(64, 32, 2);
+    if (pool.getPoolSize(64, 32) != 2) {
+        std::cerr << "FAIL: preallocate" << std::endl;
+        failures++;
+    }
+    {
+        auto a = pool.getMat(64, 32);
+        auto b = pool.getMat(64, 32);
+        auto c = pool.getMat(64, 32);
+        if (pool.getPoolSize(64, 32) != 0) {
+            std::cerr << "FAIL: getMat should take from freelist" << std::endl;
+            failures++;
+        }
+        a->data[0] = 7;
+        cv::Mat *raw = a.get();
+        a.reset();
+        auto d = pool.getMat(64, 32);
+        if (d.get() != raw || d->data[0] != 7) {
+            std::cerr << "FAIL: reuse should return the same Mat without zeroing" << std::endl;
+            failures++;
+        }
+        d.reset();
+        auto e = pool.getMat(64, 32, CV_8UC3, true);
+        if (e->data[0] != 0) {
+            std::cerr << "FAIL: zero=true should clear reused Mat" << std::endl;
+            failures++;
+        }
+    }
+    if (pool.getPoolSize(64, 32) != 3) {
+        std::cerr << "FAIL: all Mats should be returned, got " << pool.getPoolSize(64, 32) << std::endl;
+        failures++;
+    }
+    if (MatPool::makeKey(1920, 1080, CV_8UC3) == MatPool::makeKey(1080, 1920, CV_8UC3)) {
+        std::cerr << "FAIL: key collision" << std::endl;
+        failures++;
+    }
+    return failures;
+}
+
+// 使用fd缓冲区时，Mat直接引用缓冲区的映射，复用时缓冲区跟着Mat一起回池
+static int checkDmaBacked() {
+    int failures = 0;
+    MatPool pool(4, 0, std::make_shared<DmaAllocator>(""));
+    const DmaBuffer *buffer = nullptr;
+    auto mat = pool.getMat(64, 32, CV_8UC3, false, &buffer);
+    if (!buffer || buffer->fd() < 0 || mat->data != buffer->data()) {
+        std::cerr << "FAIL: Mat should alias the fd buffer mapping" << std::endl;
+        return 1;
+    }
+    int fd = buffer->fd();
+    mat.reset();
+    const DmaBuffer *again = nullptr;
+    mat = pool.getMat(64, 32, CV_8UC3, false, &again);
+    if (again != buffer || again->fd() != fd) {
+        std::cerr << "FAIL: reused Mat should keep its fd buffer" << std::endl;
+        failures++;
+    }
+    return failures;
+}
+
+// 借出的Mat比内存池活得久：池析构后归还时直接释放，并归还预算
+static int checkOutlivesPool() {
+    int failures = 0;
+    MatPoolBudget &budget = MatPoolBudget::instance();
+    size_t before = budget.allocatedBytes();
+    std::shared_ptr<cv::Mat> survivor;
+    {
+        MatPool pool(4, 0);
+        pool.preallocate(64, 32, 2);
+        survivor = pool.getMat(64, 32);
+    }
+    survivor->data[0] = 1;
+    if (budget.allocatedBytes() != before + 64 * 32 * 3) {
+        std::cerr << "FAIL: only the outstanding Mat should stay allocated after the pool is gone" << std::endl;
+        failures++;
+    }
+    survivor.reset();
+    if (budget.allocatedBytes() != before) {
+        std::cerr << "FAIL: Mat returned after pool destruction should release its bytes" << std::endl;
+        failures++;
+    }
+    return failures;
+}
+
+// 预算：超出时先按LRU回收其他尺寸类的空闲Mat，仍不够则拒绝
+static int checkBudget() {
+    int failures = 0;
+    const size_t mat_bytes = 64 * 32 * 3;
+    MatPoolBudget &budget = MatPoolBudget::instance();
+    budget.configure(mat_bytes * 4, 0);
+    {
+        MatPool stream_a(8, 0);
+        MatPool stream_b(8, 0);
+        stream_a.preallocate(64, 32, 3);            // 旧分辨率，空闲3个
+        auto held = stream_b.getMat(32, 64);        // 占用1个
+        if (budget.allocatedBytes() != mat_bytes * 4) {
+            std::cerr << "FAIL: budget should count all pooled Mats" << std::endl;
+            failures++;
+        }
+        // 新尺寸需要额度时回收 stream_a 最久未用的空闲Mat
+        auto more = stream_b.getMat(32, 64);
+        if (!more || stream_a.getPoolSize(64, 32) != 2) {
+            std::cerr << "FAIL: LRU trim should free an idle Mat from another pool" << std::endl;
+            failures++;
+        }
+        std::vector<std::shared_ptr<cv::Mat>> hold_all;
+        for (int i = 0; i < 2; ++i) {
+            hold_all.push_back(stream_b.getMat(32, 64));
+        }
+        if (stream_b.getMat(32, 64) != nullptr) {
+            std::cerr << "FAIL: getMat should return nullptr when budget is exhausted" << std::endl;
+            failures++;
+        }
+        if (budget.highWatermark() != mat_bytes * 4) {
+            std::cerr << "FAIL: high watermark " << budget.highWatermark() << std::endl;
+            failures++;
+        }
+    }
+    if (budget.allocatedBytes() != 0) {
+        std::cerr << "FAIL: destroyed pools should return all bytes, left " << budget.allocatedBytes() << std::endl;
+        failures++;
+    }
+    budget.configure(0, 0);
+    return failures;
+}
+
+int main(int argc, char **argv) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 2000;
+    int failures = checkPoolBehaviour();
+    failures += checkBudget();
+    failures += checkDmaBacked();
+    failures += checkOutlivesPool();
+
+    const int width = 1920, height = 1080;
+    for (int threads : {1, 4}) {
+        LegacyMatPool legacy(50);
+        MatPool pool(50, 0);
+        // 预热，让两边都先建好足够的Mat
+        runBench(legacy, width, height, threads, 50, 4);
+        runBench(pool, width, height, threads, 50, 4);
+
+        double legacy_us = runBench(legacy, width, height, threads, iterations, 4);
+        double pool_us = runBench(pool, width, height, threads, iterations, 4);
+        printf("1080p threads=%d: legacy %.2f us/op, new %.2f us/op, speedup %.1fx\n",
+               threads, legacy_us, pool_us, legacy_us / pool_us);
+    }
+
+    if (failures) {
+        printf("matPoolBench: %d check(s) FAILED\n", failures);
+        return 1;
+    }
+    printf("matPoolBench: all checks passed\n");
+    return 0;
+}
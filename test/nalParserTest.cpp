@@ -0,0 +1,141 @@
+// NAL 解析测试：内置 H.264/H.265 码流片段校验切分、类型判断和按帧分组；
+// 传入本地裸流文件（如 ./nalParserTest video/test.h265）时额外打印该文件的编码类型、NAL 和帧统计
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+#include "stream/nalUtils.hpp"
+#include "stream/fileSource.hpp"
+#include "testCheck.hpp"
+
+static void checkH264() {
+    const uint8_t stream[] = {
+        0, 0, 0, 1, 0x67, 0x64, 0x00, 0x28,   // SPS
+        0, 0, 0, 1, 0x68, 0xEE, 0x3C, 0x80,   // PPS
+        0, 0, 0, 1, 0x06, 0x05, 0x01, 0x80,   // SEI
+        0, 0, 1, 0x65, 0x88, 0x84, 0x00, 0x00, 0x03, 0x01, // IDR，含防竞争字节
+        0, 0, 1, 0x41, 0x9A, 0x02,            // P，被参考
+        0, 0, 0, 1, 0x01, 0x9E, 0x04,         // B，nal_ref_idc=0
+    };
+    std::vector<NalUnit> nals;
+    CHECK(guessCodec(stream, sizeof(stream)) == VIDEO_CODEC_H264, "h264 guess");
+    CHECK(splitAnnexB(stream, sizeof(stream), VIDEO_CODEC_H264, nals) == 6, "h264 split count");
+    if (nals.size() != 6) {
+        return;
+    }
+    CHECK(nals[0].type == 7 && nals[1].type == 8 && nals[2].type == 6, "h264 types");
+    CHECK(nals[3].type == 5 && nals[3].size == 7, "h264 idr size keeps 00 00 03");
+    CHECK(nalIsParameterSet(VIDEO_CODEC_H264, nals[0].type) && nalIsParameterSet(VIDEO_CODEC_H264, nals[1].type), "h264 param sets");
+    CHECK(nalIsKeyFrame(VIDEO_CODEC_H264, nals[3].type) && !nalIsKeyFrame(VIDEO_CODEC_H264, nals[4].type), "h264 key frame");
+    CHECK(!nalIsDisposable(VIDEO_CODEC_H264, nals[4].data, nals[4].size), "h264 reference P kept");
+    CHECK(nalIsDisposable(VIDEO_CODEC_H264, nals[5].data, nals[5].size), "h264 non-reference B disposable");
+    CHECK(!nalIsDisposable(VIDEO_CODEC_H264, nals[2].data, nals[2].size), "h264 SEI not a slice");
+}
+
+static void checkH265() {
+    const uint8_t stream[] = {
+        0, 0, 0, 1, 0x40, 0x01, 0x0C, 0x01,   // VPS
+        0, 0, 0, 1, 0x42, 0x01, 0x01, 0x01,   // SPS
+        0, 0, 0, 1, 0x44, 0x01, 0xC1, 0x72,   // PPS
+        0, 0, 0, 1, 0x26, 0x01, 0xAF, 0x08,   // IDR_W_RADL
+        0, 0, 1, 0x02, 0x01, 0xD0, 0x10,      // TRAIL_R
+        0, 0, 1, 0x00, 0x01, 0xE0, 0x20,      // TRAIL_N
+        0, 0, 1, 0x2A, 0x01, 0xA0,            // CRA
+    };
+    std::vector<NalUnit> nals;
+    CHECK(guessCodec(stream, sizeof(stream)) == VIDEO_CODEC_H265, "h265 guess");
+    CHECK(splitAnnexB(stream, sizeof(stream), VIDEO_CODEC_H265, nals) == 7, "h265 split count");
+    if (nals.size() != 7) {
+        return;
+    }
+    CHECK(nals[0].type == 32 && nals[1].type == 33 && nals[2].type == 34, "h265 param set types");
+    CHECK(nals[3].type == 19 && nalIsKeyFrame(VIDEO_CODEC_H265, nals[3].type), "h265 idr");
+    CHECK(nals[6].type == 21 && nalIsKeyFrame(VIDEO_CODEC_H265, nals[6].type), "h265 cra");
+    CHECK(!nalIsDisposable(VIDEO_CODEC_H265, nals[4].data, nals[4].size), "h265 TRAIL_R kept");
+    CHECK(nalIsDisposable(VIDEO_CODEC_H265, nals[5].data, nals[5].size), "h265 TRAIL_N disposable");
+    CHECK(!nalIsDisposable(VIDEO_CODEC_H265, nals[0].data, nals[0].size), "h265 VPS not a slice");
+}
+
+// 裸流文件按访问单元分组：参数集归入其后的关键帧，同一帧的多个切片合成一帧
+static void checkFileReader() {
+    const uint8_t stream[] = {
+        0, 0, 0, 1, 0x67, 0x64, 0x00, 0x28,   // SPS
+        0, 0, 0, 1, 0x68, 0xEE, 0x3C, 0x80,   // PPS
+        0, 0, 0, 1, 0x65, 0x88, 0x84, 0x00,   // IDR 第一个切片
+        0, 0, 0, 1, 0x65, 0x48, 0x84, 0x10,   // IDR 第二个切片，first_mb_in_slice != 0
+        0, 0, 1, 0x41, 0x9A, 0x02,            // P
+        0, 0, 0, 1, 0x06, 0x05, 0x01, 0x80,   // SEI，属于下一帧
+        0, 0, 1, 0x01, 0x9E, 0x04,            // B
+    };
+    CHECK(isFileSourceUrl("file:///tmp/a.h264") && !isFileSourceUrl("rtsp://host/a.h264"), "file url");
+    char path[] = "/tmp/nalParserTestXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0 || write(fd, stream, sizeof(stream)) != (ssize_t)sizeof(stream)) {
+        printf("FAIL: write temp file\n");
+        failures++;
+        return;
+    }
+    close(fd);
+    AnnexBFileReader reader;
+    CHECK(reader.open(path), "reader open");
+    CHECK(reader.codec() == VIDEO_CODEC_H264 && reader.frameCount() == 3, "reader frame count");
+    AccessUnit unit;
+    CHECK(reader.next(unit) && unit.key && unit.data[4] == 0x67 && unit.size == 32, "reader key frame");
+    CHECK(reader.next(unit) && !unit.key && unit.size == 6, "reader P frame");
+    CHECK(reader.next(unit) && !unit.key && unit.data[4] == 0x06 && unit.size == 14, "reader SEI + B frame");
+    CHECK(!reader.next(unit), "reader eof");
+    reader.rewind();
+    CHECK(reader.next(unit) && unit.key, "reader rewind");
+    unlink(path);
+}
+
+// 统计本地裸流文件
+static int inspectFile(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (fp == nullptr) {
+        printf("无法打开 %s\n", path);
+        return 1;
+    }
+    std::vector<uint8_t> data;
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        data.insert(data.end(), buf, buf + n);
+    }
+    fclose(fp);
+
+    int codec = guessCodec(data.data(), data.size());
+    std::vector<NalUnit> nals;
+    splitAnnexB(data.data(), data.size(), codec, nals);
+    size_t params = 0, keys = 0, slices = 0, disposable = 0;
+    for (const auto &nal : nals) {
+        params += nalIsParameterSet(codec, nal.type);
+        keys += nalIsKeyFrame(codec, nal.type);
+        slices += nalIsSlice(codec, nal.type);
+        disposable += nalIsDisposable(codec, nal.data, nal.size);
+    }
+    printf("%s: %s, %zu 字节, NAL %zu 个 (参数集 %zu, 切片 %zu, 关键帧切片 %zu, 非参考切片 %zu)\n",
+           path, codecName(codec), data.size(), nals.size(), params, slices, keys, disposable);
+    AnnexBFileReader reader;
+    if (codec == VIDEO_CODEC_UNKNOWN || !reader.open(path)) {
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    checkH264();
+    checkH265();
+    checkFileReader();
+    for (int i = 1; i < argc; ++i) {
+        if (inspectFile(argv[i]) != 0) {
+            failures++;
+        }
+    }
+    if (failures) {
+        printf("nalParserTest: %d check(s) FAILED\n", failures);
+        return 1;
+    }
+    printf("nalParserTest: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,150 @@
+// 过载丢帧测试：负载升降级的迟滞、按 nal_ref_idc / NAL 类型丢包、离开只解码关键帧后等待关键帧
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+#include "stream/overloadShedder.hpp"
+#include "testCheck.hpp"
+
+static const int64_t kPacketUs = 40000; // 25fps，每个码流包更新一次负载
+
+// H.264：nal_ref_idc 在首字节的第 5~6 位
+static const uint8_t kH264P[] = {0, 0, 0, 1, 0x41, 0x9A, 0x02};        // P，nal_ref_idc=2
+static const uint8_t kH264B[] = {0, 0, 0, 1, 0x01, 0x9E, 0x04};        // B，nal_ref_idc=0
+static const uint8_t kH264Idr[] = {0, 0, 0, 1, 0x65, 0x88, 0x84};      // IDR
+static const uint8_t kH264Sps[] = {0, 0, 0, 1, 0x67, 0x64, 0x00, 0x28}; // SPS
+static const uint8_t kH264Sei[] = {0, 0, 0, 1, 0x06, 0x05, 0x01, 0x80}; // 只有 SEI
+static const uint8_t kH264SeiB[] = {0, 0, 0, 1, 0x06, 0x05, 0x01, 0x80, 0, 0, 1, 0x01, 0x9E, 0x04};
+static const uint8_t kH264BB[] = {0, 0, 1, 0x01, 0x9E, 0x04, 0, 0, 1, 0x01, 0x48, 0x04};   // 两个非参考切片
+static const uint8_t kH264BP[] = {0, 0, 1, 0x01, 0x9E, 0x04, 0, 0, 1, 0x21, 0x48, 0x04};   // 非参考 + 参考切片(nal_ref_idc=1)
+
+// H.265：0~14 中的偶数类型为子层非参考图像
+static const uint8_t kH265TrailN[] = {0, 0, 0, 1, 0x00, 0x01, 0xE0, 0x20}; // TRAIL_N
+static const uint8_t kH265TrailR[] = {0, 0, 0, 1, 0x02, 0x01, 0xD0, 0x10}; // TRAIL_R
+static const uint8_t kH265RaslN[] = {0, 0, 0, 1, 0x10, 0x01, 0xD0, 0x10};  // RASL_N
+static const uint8_t kH265TrailNR[] = {0, 0, 1, 0x00, 0x01, 0xE0, 0x20, 0, 0, 1, 0x02, 0x01, 0x50, 0x10};
+
+#define DROP(shedder, codec, pkt) (shedder).shouldDrop(codec, pkt, sizeof(pkt), false, false)
+
+// 以固定负载送 count 个包，返回最后的时间；first_change 回写第一次级别变化的时间，没有时不改
+static int64_t feed(OverloadShedder &shedder, int64_t now_us, double load, int count, int64_t *first_change = nullptr) {
+    for (int i = 0; i < count; ++i) {
+        now_us += kPacketUs;
+        if (shedder.update(now_us, load) && first_change != nullptr && *first_change < 0) {
+            *first_change = now_us;
+        }
+    }
+    return now_us;
+}
+
+// 从 SHED_NONE 升到 level，返回当前时间
+static int64_t raiseTo(OverloadShedder &shedder, int64_t now_us, int level) {
+    while (shedder.level() < level) {
+        now_us = feed(shedder, now_us, 1.0, 1);
+    }
+    return now_us;
+}
+
+static void checkHysteresis() {
+    OverloadShedder off;
+    int64_t now = feed(off, 10000000, 1.0, 200);
+    CHECK(off.level() == SHED_NONE && !DROP(off, VIDEO_CODEC_H264, kH264B), "max level off never sheds");
+
+    OverloadShedder shedder;
+    shedder.setMaxLevel(SHED_KEY_ONLY);
+    now = 10000000;
+    // 中等负载不升级
+    now = feed(shedder, now, 0.5, 200);
+    CHECK(shedder.level() == SHED_NONE, "load 0.5 stays at none");
+
+    // 持续过载：平均负载超过 0.7 后升一级，距上次变化超过 1s 才能再升
+    int64_t first = -1;
+    now = feed(shedder, now, 1.0, 20, &first);
+    CHECK(shedder.level() == SHED_NONREF && first > 0, "overload raises to nonref");
+    now = feed(shedder, now, 1.0, (int)((1000000 - (now - first)) / kPacketUs));
+    CHECK(shedder.level() == SHED_NONREF, "no second raise within 1s");
+    int64_t last_raise = -1;
+    now = feed(shedder, now, 1.0, 2, &last_raise);
+    CHECK(shedder.level() == SHED_KEY_ONLY && last_raise - first > 1000000, "second raise after 1s");
+    now = feed(shedder, now, 1.0, 100);
+    CHECK(shedder.level() == SHED_KEY_ONLY, "capped at max level");
+
+    // 负载降下来后降级更慢：距上次变化 3s 内保持
+    int64_t lowered = -1;
+    while (lowered < 0) {
+        now = feed(shedder, now, 0.0, 1, &lowered);
+    }
+    CHECK(lowered - last_raise > 3000000, "lower only after 3s");
+    CHECK(shedder.level() == SHED_NONREF, "one step down at a time");
+    now = feed(shedder, now, 0.0, 3000000 / kPacketUs - 1);
+    CHECK(shedder.level() == SHED_NONREF, "no second step down within 3s");
+    now = feed(shedder, now, 0.0, 2);
+    CHECK(shedder.level() == SHED_NONE, "back to none after another 3s");
+
+    // 配置上限为 nonref 时不会进入只解码关键帧
+    OverloadShedder capped;
+    capped.setMaxLevel(shedLevelFromString("nonref"));
+    feed(capped, 10000000, 1.0, 300);
+    CHECK(capped.level() == SHED_NONREF, "nonref cap respected");
+}
+
+static void checkNonRef() {
+    OverloadShedder shedder;
+    shedder.setMaxLevel(SHED_NONREF);
+    CHECK(!DROP(shedder, VIDEO_CODEC_H264, kH264B), "nothing dropped before overload");
+    raiseTo(shedder, 10000000, SHED_NONREF);
+
+    CHECK(DROP(shedder, VIDEO_CODEC_H264, kH264B), "h264 nal_ref_idc=0 dropped");
+    CHECK(!DROP(shedder, VIDEO_CODEC_H264, kH264P), "h264 reference P kept");
+    CHECK(!shedder.shouldDrop(VIDEO_CODEC_H264, kH264Idr, sizeof(kH264Idr), true, false), "h264 key kept");
+    CHECK(!shedder.shouldDrop(VIDEO_CODEC_H264, kH264Sps, sizeof(kH264Sps), false, true), "h264 config kept");
+    // 一个包里所有切片都不被参考才丢；没有切片（只有 SEI）的包保留
+    CHECK(DROP(shedder, VIDEO_CODEC_H264, kH264BB), "all slices disposable dropped");
+    CHECK(!DROP(shedder, VIDEO_CODEC_H264, kH264BP), "one reference slice keeps the packet");
+    CHECK(!DROP(shedder, VIDEO_CODEC_H264, kH264Sei), "sei-only packet kept");
+    CHECK(DROP(shedder, VIDEO_CODEC_H264, kH264SeiB), "sei + non-reference slice dropped");
+
+    CHECK(DROP(shedder, VIDEO_CODEC_H265, kH265TrailN), "h265 TRAIL_N dropped");
+    CHECK(DROP(shedder, VIDEO_CODEC_H265, kH265RaslN), "h265 RASL_N dropped");
+    CHECK(!DROP(shedder, VIDEO_CODEC_H265, kH265TrailR), "h265 TRAIL_R kept");
+    CHECK(!DROP(shedder, VIDEO_CODEC_H265, kH265TrailNR), "h265 TRAIL_N + TRAIL_R kept");
+    CHECK(shedder.dropped() == 5, "dropped counter");
+}
+
+static void checkKeyOnly() {
+    OverloadShedder shedder;
+    shedder.setMaxLevel(SHED_KEY_ONLY);
+    int64_t now = raiseTo(shedder, 10000000, SHED_KEY_ONLY);
+    CHECK(DROP(shedder, VIDEO_CODEC_H264, kH264P), "key-only drops reference P");
+    CHECK(DROP(shedder, VIDEO_CODEC_H265, kH265TrailR), "key-only drops TRAIL_R");
+    CHECK(!shedder.shouldDrop(VIDEO_CODEC_H264, kH264Idr, sizeof(kH264Idr), true, false), "key-only keeps key");
+    CHECK(DROP(shedder, VIDEO_CODEC_H264, kH264P), "P after key still dropped at key-only");
+
+    // 降到 nonref：之前丢掉的 P 被后续帧参考，一直丢到下一个关键帧
+    while (shedder.level() == SHED_KEY_ONLY) {
+        now = feed(shedder, now, 0.0, 1);
+    }
+    CHECK(shedder.level() == SHED_NONREF, "left key-only");
+    CHECK(DROP(shedder, VIDEO_CODEC_H264, kH264P), "reference P dropped until next key");
+    CHECK(!shedder.shouldDrop(VIDEO_CODEC_H264, kH264Sps, sizeof(kH264Sps), false, true), "config kept while waiting");
+    CHECK(!shedder.shouldDrop(VIDEO_CODEC_H264, kH264Idr, sizeof(kH264Idr), true, false), "next key kept");
+    CHECK(!DROP(shedder, VIDEO_CODEC_H264, kH264P), "reference P decoded after key");
+    CHECK(DROP(shedder, VIDEO_CODEC_H264, kH264B), "still nonref after key");
+
+    // 从 nonref 降到 none 不需要等关键帧
+    while (shedder.level() == SHED_NONREF) {
+        now = feed(shedder, now, 0.0, 1);
+    }
+    CHECK(!DROP(shedder, VIDEO_CODEC_H264, kH264B), "none keeps everything");
+}
+
+int main() {
+    checkHysteresis();
+    checkNonRef();
+    checkKeyOnly();
+    if (failures) {
+        printf("overloadShedderTest: %d check(s) FAILED\n", failures);
+        return 1;
+    }
+    printf("overloadShedderTest: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,163 @@
+// 输出码率自适应测试：拥塞时先降码率再降帧率、恢复的迟滞与顺序、静止画面延长 GOP、帧率下限
+#include <stdio.h>
+#include <stdint.h>
+#include "stream/rateController.hpp"
+#include "testCheck.hpp"
+
+static const int kFps = 25;
+static const int kBps = 4000000;
+
+// 送一秒的 P 帧（实际码率 measured_bps）后评估一次，返回是否调整；时间由调用方推进
+static bool second(RateController &rc, int64_t &now_us, int measured_bps, int64_t lag_ms, int backlog,
+                   RateController::Decision &decision) {
+    for (int i = 0; i < kFps; ++i) {
+        rc.addFrame(measured_bps / 8 / kFps, false);
+    }
+    now_us += 1000000;
+    return rc.evaluate(now_us, lag_ms, backlog, decision);
+}
+
+static RateController makeController(RateControlParams params, int64_t &now_us) {
+    params.adaptive = true;
+    RateController rc(params, kBps, kFps);
+    RateController::Decision decision;
+    // 第一次评估只开启窗口
+    rc.evaluate(now_us, 0, 0, decision);
+    return rc;
+}
+
+static void checkStepDown() {
+    int64_t now = 1000000;
+    RateController rc = makeController(RateControlParams(), now);
+    RateController::Decision d = {0, 0, 0};
+    CHECK(rc.bps() == kBps && rc.fps() == kFps && rc.gop() == kFps * 2, "initial parameters");
+    CHECK(!second(rc, now, kBps, 0, 0, d), "no change without congestion");
+
+    // 拥塞：实际码率用满时以目标码率为基准，每秒降到 3/4，直到下限（默认目标码率的 1/4），期间帧率不动
+    int expected_bps[] = {3000000, 2250000, 1687500, 1265625, 1000000};
+    bool bps_first = true;
+    for (int expected : expected_bps) {
+        bool changed = second(rc, now, kBps, 500, 0, d);
+        if (!changed || d.bps != expected || d.fps != kFps) {
+            printf("FAIL: expected %d bps at %d fps, got %d bps at %d fps\n", expected, kFps, d.bps, d.fps);
+            bps_first = false;
+        }
+    }
+    CHECK(bps_first, "bitrate steps down before frame rate");
+
+    // 码率到下限后再降帧率，GOP 按帧率保持 2 秒
+    CHECK(second(rc, now, rc.bps(), 0, 10, d) && d.bps == 1000000 && d.fps == 18 && d.gop == 36,
+          "backlog congestion lowers fps once bitrate is at the floor");
+    CHECK(second(rc, now, rc.bps(), 500, 0, d) && d.fps == 13, "fps steps down by 3/4");
+    CHECK(second(rc, now, rc.bps(), 500, 0, d) && d.fps == 12, "fps clamped to half the source fps");
+    CHECK(!second(rc, now, rc.bps(), 500, 0, d) && rc.fps() == 12 && rc.bps() == 1000000, "nothing below the floors");
+    CHECK(rc.adjustments() == 8, "adjustment count");
+
+    // 降码率以实际码率为基准：VBR 只用了 2Mbps 时直接降到 1.5Mbps
+    int64_t now2 = 1000000;
+    RateController vbr = makeController(RateControlParams(), now2);
+    CHECK(second(vbr, now2, 2000000, 500, 0, d) && d.bps == 1500000, "step down from the measured bitrate");
+}
+
+static void checkRecovery() {
+    int64_t now = 1000000;
+    RateController rc = makeController(RateControlParams(), now);
+    RateController::Decision d = {0, 0, 0};
+    while (rc.fps() > 12) {
+        second(rc, now, rc.bps(), 500, 0, d);
+    }
+    CHECK(rc.bps() == 1000000 && rc.fps() == 12, "setup at both floors");
+
+    // 连续 5 个无拥塞窗口才升一档，先恢复帧率
+    bool held = true;
+    for (int i = 0; i < 4; ++i) {
+        held = held && !second(rc, now, rc.bps(), 0, 0, d);
+    }
+    CHECK(held, "no recovery within 4 clear windows");
+    CHECK(second(rc, now, rc.bps(), 0, 0, d) && d.fps == 15 && d.bps == 1000000, "fifth clear window raises fps");
+
+    // 延迟介于一半阈值和阈值之间：不降档，但清零恢复计数
+    for (int i = 0; i < 4; ++i) {
+        second(rc, now, rc.bps(), 0, 0, d);
+    }
+    CHECK(!second(rc, now, rc.bps(), 150, 0, d) && rc.fps() == 15, "borderline lag neither lowers nor raises");
+    held = true;
+    for (int i = 0; i < 4; ++i) {
+        held = held && !second(rc, now, rc.bps(), 0, 0, d);
+    }
+    CHECK(held, "borderline lag restarts the clear count");
+    CHECK(second(rc, now, rc.bps(), 0, 0, d) && d.fps == 18, "recovery resumes after 5 new clear windows");
+
+    // 帧率恢复到源帧率后才升码率，每档 9/8，不超过初始码率
+    int last_fps = rc.fps();
+    bool fps_first = true;
+    for (int i = 0; i < 200; ++i) {
+        if (second(rc, now, rc.bps(), 0, 0, d) && d.bps > 1000000 && last_fps < kFps) {
+            fps_first = false;
+        }
+        last_fps = rc.fps();
+    }
+    CHECK(fps_first, "frame rate recovers before bitrate");
+    CHECK(rc.fps() == kFps && rc.bps() == kBps, "fully recovered to the initial parameters");
+}
+
+static void checkStaticScene() {
+    int64_t now = 1000000;
+    RateControlParams params;
+    params.gop = 50;
+    RateController rc = makeController(params, now);
+    RateController::Decision d = {0, 0, 0};
+
+    // P 帧不到 I 帧的 5%：画面静止，GOP 延长到 max_gop_sec
+    rc.addFrame(100000, true);
+    CHECK(second(rc, now, 400000, 0, 0, d) && d.gop == kFps * 4 && d.bps == kBps && d.fps == kFps,
+          "static scene stretches gop to 4s");
+    CHECK(!second(rc, now, 400000, 0, 0, d), "static scene holds");
+
+    // P 帧比例在 5%~10% 之间保持不变（迟滞），超过 10% 恢复配置的 GOP
+    for (int i = 0; i < 100; ++i) {
+        rc.addFrame(7000, false);
+    }
+    CHECK(!second(rc, now, 7000 * 8 * kFps, 0, 0, d) && rc.gop() == kFps * 4, "ratio inside the band keeps the long gop");
+    for (int i = 0; i < 100; ++i) {
+        rc.addFrame(20000, false);
+    }
+    CHECK(second(rc, now, 20000 * 8 * kFps, 0, 0, d) && d.gop == 50, "moving scene restores the configured gop");
+
+    // max_gop_sec 为 0 时不调整 GOP
+    int64_t now2 = 1000000;
+    params.max_gop_sec = 0;
+    RateController fixed = makeController(params, now2);
+    fixed.addFrame(100000, true);
+    CHECK(!second(fixed, now2, 400000, 0, 0, d) && fixed.gop() == 50, "max_gop_sec 0 keeps the gop");
+}
+
+static void checkFpsFloor() {
+    // 配置的帧率下限生效；高于源帧率时按源帧率
+    int64_t now = 1000000;
+    RateControlParams params;
+    params.min_fps = 20;
+    params.min_kbps = 4000;
+    RateController rc = makeController(params, now);
+    RateController::Decision d = {0, 0, 0};
+    CHECK(second(rc, now, kBps, 500, 0, d) && d.bps == kBps && d.fps == 20, "min_kbps at target goes straight to fps");
+    CHECK(!second(rc, now, kBps, 500, 0, d) && rc.fps() == 20, "configured min_fps is the floor");
+
+    int64_t now2 = 1000000;
+    params.min_fps = 60;
+    RateController high = makeController(params, now2);
+    CHECK(!second(high, now2, kBps, 500, 0, d) && high.fps() == kFps, "min_fps above source clamps to source");
+}
+
+int main() {
+    checkStepDown();
+    checkRecovery();
+    checkStaticScene();
+    checkFpsFloor();
+    if (failures) {
+        printf("rateControllerTest: %d check(s) FAILED\n", failures);
+        return 1;
+    }
+    printf("rateControllerTest: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,129 @@
+// 编码 ROI 测试：检测框按 IoU 跟随、漏检后保留 hold_frames 帧、超出上限时合并代价最小的两个区域，
+// 以及送给编码器前的宏块对齐与裁剪
+#include <stdio.h>
+#include <vector>
+#include "stream/roiSmoother.hpp"
+#include "rkmedia/utils/mpp_encoder.h"
+#include "testCheck.hpp"
+
+static const int kWidth = 1920;
+static const int kHeight = 1080;
+
+static Detection det(int x, int y, int w, int h) {
+    Detection d;
+    d.box = cv::Rect(x, y, w, h);
+    return d;
+}
+
+static RoiParams params(int max_regions, int hold_frames, int margin) {
+    RoiParams p;
+    p.enable = true;
+    p.max_regions = max_regions;
+    p.hold_frames = hold_frames;
+    p.margin = margin;
+    return p;
+}
+
+static void checkHold() {
+    RoiSmoother smoother(params(6, 2, 0));
+    std::vector<Detection> none;
+
+    auto regions = smoother.update({det(100, 100, 50, 50)}, kWidth, kHeight);
+    CHECK(regions.size() == 1 && regions[0] == cv::Rect(100, 100, 50, 50), "first detection becomes a region");
+
+    // IoU 0.82，视为同一目标：区域跟到新位置，不新增
+    regions = smoother.update({det(105, 100, 50, 50)}, kWidth, kHeight);
+    CHECK(regions.size() == 1 && regions[0] == cv::Rect(105, 100, 50, 50), "overlapping box follows the target");
+
+    // 漏检后继续保留 hold_frames 帧，之后过期
+    CHECK(smoother.update(none, kWidth, kHeight).size() == 1, "held 1 frame after a miss");
+    CHECK(smoother.update(none, kWidth, kHeight).size() == 1, "held 2 frames after a miss");
+    CHECK(smoother.update(none, kWidth, kHeight).empty(), "expired after hold_frames");
+
+    // 重新检测到时刷新保留时间
+    smoother.update({det(100, 100, 50, 50)}, kWidth, kHeight);
+    smoother.update(none, kWidth, kHeight);
+    smoother.update({det(102, 100, 50, 50)}, kWidth, kHeight);
+    smoother.update(none, kWidth, kHeight);
+    CHECK(smoother.update(none, kWidth, kHeight).size() == 1, "re-detection refreshes the ttl");
+}
+
+static void checkIou() {
+    RoiSmoother smoother(params(6, 2, 0));
+    smoother.update({det(100, 100, 50, 50)}, kWidth, kHeight);
+    // 向右移 35 像素，IoU 0.18 低于 0.3：当作新目标，旧区域仍在保留期内
+    auto regions = smoother.update({det(135, 100, 50, 50)}, kWidth, kHeight);
+    CHECK(regions.size() == 2, "low IoU starts a new region");
+    // 多个保留区域时匹配 IoU 最大的那个
+    regions = smoother.update({det(134, 100, 50, 50)}, kWidth, kHeight);
+    CHECK(regions.size() == 2 && regions[1] == cv::Rect(134, 100, 50, 50), "best IoU match is refreshed");
+    regions = smoother.update({det(134, 100, 50, 50)}, kWidth, kHeight);
+    CHECK(regions.size() == 1 && regions[0] == cv::Rect(134, 100, 50, 50), "unmatched region expires");
+}
+
+static void checkMargin() {
+    // 检测框向外扩 margin，并裁剪到画面内；完全在画面外的框忽略
+    RoiSmoother smoother(params(6, 0, 16));
+    auto regions = smoother.update({det(0, 0, 20, 20), det(500, 400, 40, 40), det(3000, 10, 20, 20)}, kWidth, kHeight);
+    CHECK(regions.size() == 2, "box outside the frame ignored");
+    CHECK(regions.size() == 2 && regions[0] == cv::Rect(0, 0, 36, 36), "margin clipped at the frame edge");
+    CHECK(regions.size() == 2 && regions[1] == cv::Rect(484, 384, 72, 72), "margin added on every side");
+}
+
+static void checkMerge() {
+    // 超出上限时合并并集面积增加最少的两个：相邻的 A/B 合并，远处的 C 保持不变
+    RoiSmoother smoother(params(2, 0, 0));
+    auto regions = smoother.update({det(0, 0, 10, 10), det(300, 300, 10, 10), det(12, 0, 10, 10)}, kWidth, kHeight);
+    CHECK(regions.size() == 2, "merged down to max_regions");
+    CHECK(regions.size() == 2 && regions[0] == cv::Rect(0, 0, 22, 10), "cheapest pair merged");
+    CHECK(regions.size() == 2 && regions[1] == cv::Rect(300, 300, 10, 10), "distant region untouched");
+
+    // 上限为 1 时所有区域合并为外接矩形；上限小于 1 时按 1
+    RoiSmoother single(params(0, 0, 0));
+    regions = single.update({det(0, 0, 10, 10), det(300, 300, 10, 10), det(12, 0, 10, 10)}, kWidth, kHeight);
+    CHECK(regions.size() == 1 && regions[0] == cv::Rect(0, 0, 310, 310), "max_regions 1 merges everything");
+
+    // 合并只影响输出，被合并的目标仍分别跟踪
+    RoiSmoother tracked(params(1, 1, 0));
+    tracked.update({det(0, 0, 10, 10), det(100, 0, 10, 10)}, kWidth, kHeight);
+    regions = tracked.update({det(101, 0, 10, 10)}, kWidth, kHeight);
+    CHECK(regions.size() == 1 && regions[0] == cv::Rect(0, 0, 111, 10), "merged targets keep separate ttl");
+}
+
+static bool alignedTo(const MppEncoderRoi &roi, int x, int y, int w, int h) {
+    return roi.x == x && roi.y == y && roi.w == w && roi.h == h;
+}
+
+static void checkAlign() {
+    MppEncoderRoi out;
+    MppEncoderRoi in = {17, 33, 10, 10, -6};
+    CHECK(MppEncoderAlignRoi(in, kWidth, kHeight, &out) && alignedTo(out, 16, 32, 16, 16) && out.qp_delta == -6,
+          "unaligned box expands to macroblocks");
+    in = {32, 48, 64, 32, -6};
+    CHECK(MppEncoderAlignRoi(in, kWidth, kHeight, &out) && alignedTo(out, 32, 48, 64, 32), "aligned box unchanged");
+    in = {-10, -5, 30, 30, -6};
+    CHECK(MppEncoderAlignRoi(in, kWidth, kHeight, &out) && alignedTo(out, 0, 0, 32, 32), "negative origin clipped");
+    // 1080 行按 16 对齐为 1088，区域可以覆盖到编码器的填充行
+    in = {1900, 1070, 100, 100, -6};
+    CHECK(MppEncoderAlignRoi(in, kWidth, kHeight, &out) && alignedTo(out, 1888, 1056, 32, 32),
+          "right and bottom clipped to the aligned frame");
+    in = {2000, 10, 10, 10, -6};
+    CHECK(!MppEncoderAlignRoi(in, kWidth, kHeight, &out), "box outside the frame rejected");
+    in = {0, 0, 16, 16, -40};
+    CHECK(MppEncoderAlignRoi(in, kWidth, kHeight, &out) && out.qp_delta == -31, "qp delta clamped to -31");
+    CHECK(MppEncoderClampRoiQp(40) == 31 && MppEncoderClampRoiQp(4) == 4, "qp clamp");
+}
+
+int main() {
+    checkHold();
+    checkIou();
+    checkMargin();
+    checkMerge();
+    checkAlign();
+    if (failures) {
+        printf("roiSmootherTest: %d check(s) FAILED\n", failures);
+        return 1;
+    }
+    printf("roiSmootherTest: all checks passed\n");
+    return 0;
+}
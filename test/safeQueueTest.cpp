@@ -75,9 +75,47 @@ int main() {
     });
     
     producer.join();
+    // 生产者丢弃过数据，剩下的不够15个，关闭队列让消费者取空后不再阻塞
+    str_queue.close();
     consumer.join();
     
     std::cout << "多线程测试完成，总丢弃数量: " << str_queue.dropped_count() << std::endl;
     
+    // 测试6：限时取数据，空队列超时返回，其他线程放入数据后及时唤醒
+    std::cout << "\n--- 测试6：限时取数据 ---" << std::endl;
+    SafeQueue<int> timed_queue(4);
+    int value = 0;
+    auto begin = std::chrono::steady_clock::now();
+    bool got = timed_queue.pop_for(value, 50);
+    auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << "空队列: " << (got ? "取到数据" : "超时") << ", 等待 " << waited << "ms" << std::endl;
+    std::thread late_producer([&timed_queue]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        timed_queue.push(42);
+    });
+    begin = std::chrono::steady_clock::now();
+    got = timed_queue.pop_for(value, 1000);
+    waited = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count();
+    late_producer.join();
+    std::cout << "等待生产者: " << (got ? "取到 " + std::to_string(value) : std::string("超时")) << ", 等待 " << waited << "ms" << std::endl;
+    if (!got || value != 42 || waited >= 1000) {
+        std::cout << "限时取数据测试失败" << std::endl;
+        return 1;
+    }
+
+    // 关闭后限时等待：剩余数据照常取出，取空后立即返回而不是等到超时
+    timed_queue.push(7);
+    timed_queue.close();
+    got = timed_queue.pop_for(value, 1000);
+    begin = std::chrono::steady_clock::now();
+    int rest = 0;
+    got = got && !timed_queue.pop_for(rest, 1000);
+    waited = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << "关闭后: " << (got ? "取空后返回" : "失败") << ", 等待 " << waited << "ms" << std::endl;
+    if (!got || value != 7 || waited >= 1000) {
+        std::cout << "关闭后限时取数据测试失败" << std::endl;
+        return 1;
+    }
+
     return 0;
 }
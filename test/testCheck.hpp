@@ -0,0 +1,17 @@
+// 单元测试公用的检查宏：条件不成立时打印并计数，main 末尾按 failures 决定返回值
+#ifndef TEST_CHECK_HPP
+#define TEST_CHECK_HPP
+
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                          \
+    do {                                          \
+        if (!(cond)) {                            \
+            printf("FAIL: %s\n", msg);            \
+            failures++;                           \
+        }                                         \
+    } while (0)
+
+#endif // TEST_CHECK_HPP
@@ -0,0 +1,97 @@
+// 时间戳平移测试：连续输入保持间隔、回退/重复/大跳变按不连续衔接、pts 缺失时退回到达时间
+#include <stdio.h>
+#include <stdint.h>
+#include "stream/timestampRebaser.hpp"
+#include "testCheck.hpp"
+
+static void checkMonotonic() {
+    // 源端 pts 从任意值开始，输出从 0 开始并保持源端帧间隔
+    TimestampRebaser rebaser;
+    bool spacing_ok = true;
+    int64_t prev = -1;
+    for (int i = 0; i < 100; ++i) {
+        int64_t out = rebaser.rebase(90000 + i * 40, 0);
+        if (i == 0) {
+            CHECK(out == 0, "first output is 0");
+        } else if (out - prev != 40) {
+            spacing_ok = false;
+        }
+        prev = out;
+    }
+    CHECK(spacing_ok, "monotonic input keeps 40ms spacing");
+    CHECK(rebaser.discontinuities() == 0, "no discontinuity on monotonic input");
+
+    // 跳变不超过阈值时如实保留
+    int64_t out = rebaser.rebase(90000 + 99 * 40 + 4000, 0);
+    CHECK(out == prev + 4000 && rebaser.discontinuities() == 0, "gap below threshold preserved");
+}
+
+static void checkBackward() {
+    // 源端重置：pts 回到 0，输出接在上一帧之后按平均帧间隔继续
+    TimestampRebaser rebaser;
+    int64_t prev = 0;
+    for (int i = 0; i < 10; ++i) {
+        prev = rebaser.rebase(5000 + i * 40, 0);
+    }
+    int64_t out = rebaser.rebase(0, 0);
+    CHECK(out == prev + 40, "backward jump continues one interval later");
+    CHECK(rebaser.discontinuities() == 1, "backward jump counted");
+    CHECK(rebaser.rebase(40, 0) == out + 40, "spacing resumes after backward jump");
+}
+
+static void checkZeroDelta() {
+    // delta <= 0 一律视为不连续：重复的 pts 不会产生相同或倒退的输出
+    TimestampRebaser rebaser;
+    int64_t a = rebaser.rebase(1000, 0);
+    int64_t b = rebaser.rebase(1040, 0);
+    int64_t c = rebaser.rebase(1040, 0);
+    CHECK(a == 0 && b == 40, "setup");
+    CHECK(c == b + 40, "duplicate pts continues one interval later");
+    CHECK(rebaser.discontinuities() == 1, "zero delta counted as discontinuity");
+    int64_t d = rebaser.rebase(1039, 0);
+    CHECK(d > c && rebaser.discontinuities() == 2, "pts one ms back is a discontinuity");
+}
+
+static void checkForwardGap() {
+    // 断流重连后 pts 向前跳 60s，超过阈值，不把空洞带到输出上
+    TimestampRebaser rebaser(5000);
+    int64_t prev = 0;
+    for (int i = 0; i < 10; ++i) {
+        prev = rebaser.rebase(i * 33, 0);
+    }
+    int64_t out = rebaser.rebase(60000, 0);
+    CHECK(rebaser.discontinuities() == 1, "forward gap over threshold counted");
+    // 平均帧间隔从默认 40ms 逐步收敛到 33ms，衔接间隔落在两者之间
+    CHECK(out - prev >= 33 && out - prev <= 40, "forward gap bridged with the average interval");
+    CHECK(rebaser.rebase(60033, 0) == out + 33, "spacing resumes after forward gap");
+}
+
+static void checkFallback() {
+    // 没有 pts 时按到达时间生成
+    TimestampRebaser rebaser;
+    CHECK(rebaser.rebase(-1, 7000) == 0, "fallback first frame");
+    CHECK(rebaser.rebase(-1, 7040) == 40, "fallback follows arrival spacing");
+    CHECK(rebaser.discontinuities() == 0, "fallback alone is continuous");
+
+    // pts 与本地时间不在同一时间轴，来回切换都按不连续衔接，输出保持递增
+    int64_t out = rebaser.rebase(123456, 7080);
+    CHECK(out == 80 && rebaser.discontinuities() == 1, "switch to pts is a discontinuity");
+    CHECK(rebaser.rebase(123496, 7120) == 120, "pts spacing after switch");
+    int64_t back = rebaser.rebase(-1, 7160);
+    CHECK(back == 160 && rebaser.discontinuities() == 2, "switch back to arrival time is a discontinuity");
+    CHECK(rebaser.rebase(-1, 7200) == 200, "arrival spacing after switch back");
+}
+
+int main() {
+    checkMonotonic();
+    checkBackward();
+    checkZeroDelta();
+    checkForwardGap();
+    checkFallback();
+    if (failures) {
+        printf("timestampRebaserTest: %d check(s) FAILED\n", failures);
+        return 1;
+    }
+    printf("timestampRebaserTest: all checks passed\n");
+    return 0;
+}